@@ -0,0 +1,64 @@
+# Asynchronous field diagnostics, compared to the same diagnostics written synchronously
+import math
+l0 = 2.0*math.pi  # wavelength in normalized units
+t0 = l0           # optical cycle in normalized units
+rest = 102.0      # nb of timestep in 1 optical cycle
+resx = 100.0      # nb cells in 1 wavelength
+
+Main(
+    geometry = "1Dcartesian",
+    interpolation_order = 2,
+    
+    cell_length = [l0/resx],
+    grid_length  = [6.0*l0],
+    
+    number_of_patches = [ 8 ],
+    
+    timestep = t0/rest,
+    simulation_time = 6.0*t0,
+    
+    EM_boundary_conditions = [ ['silver-muller'] ],
+    
+    random_seed = smilei_mpi_rank,
+    
+    print_every = int(rest/2.0)
+)
+
+Laser(
+    omega          = 1.,
+    time_envelope  = tgaussian(fwhm=1.*t0),
+    space_envelope = [1., 0.],
+)
+
+# Two asynchronous diagnostics, one of them time-averaged
+DiagFields(
+    every = int(rest/2.0),
+    fields = ['Ex','Ey','Ez','By_m','Bz_m'],
+    asynchronous = True
+)
+DiagFields(
+    every = int(rest),
+    fields = ['Ey','Bz_m'],
+    time_average = int(rest/4.0),
+    asynchronous = True
+)
+
+# The same diagnostics written synchronously
+DiagFields(
+    every = int(rest/2.0),
+    fields = ['Ex','Ey','Ez','By_m','Bz_m']
+)
+DiagFields(
+    every = int(rest),
+    fields = ['Ey','Bz_m'],
+    time_average = int(rest/4.0)
+)
+
+# Other diagnostics accessing their files while the I/O thread writes
+DiagProbe(
+    every = 5,
+    origin = [Main.grid_length[0]*0.2]
+)
+DiagScalar(
+    every = 5
+)
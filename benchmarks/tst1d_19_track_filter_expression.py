@@ -0,0 +1,73 @@
+# ----------------------------------------------------------------------------------------
+# 	Compiled filter of DiagTrackParticles, compared to the equivalent python filter
+# ----------------------------------------------------------------------------------------
+
+import math
+import numpy as np
+L  = 20.
+
+Main(
+    geometry = "1Dcartesian",
+    
+    interpolation_order = 2,
+    
+    cell_length = [0.1],
+    grid_length  = [L],
+    
+    number_of_patches = [ 8 ],
+    
+    timestep = 0.09,
+    simulation_time = 20.,
+    
+    EM_boundary_conditions = [ ['periodic'] ],
+    
+    random_seed = smilei_mpi_rank
+)
+
+Species(
+	name = "ion",
+	position_initialization = "regular",
+	momentum_initialization = "cold",
+	particles_per_cell = 8,
+	mass = 1836.0,
+	charge = 1.0,
+	number_density = 1.,
+	boundary_conditions = [
+		["periodic", "periodic"],
+	],
+	time_frozen = 10000.
+)
+
+# Two identical electron species: each particle of the first one has a twin in the second one,
+# so that both filters must select the same particles
+for name in ["eon_compiled", "eon_python"]:
+	Species(
+		name = name,
+		position_initialization = "regular",
+		momentum_initialization = "cold",
+		particles_per_cell = 4,
+		mass = 1.0,
+		charge = -1.0,
+		number_density = 0.5,
+		mean_velocity = [lambda x: 0.5*math.sin(2.*math.pi*x/L), 0., 0.],
+		boundary_conditions = [
+			["periodic", "periodic"],
+		],
+	)
+
+DiagTrackParticles(
+	species = "eon_compiled",
+	every = 20,
+	filter = "((x > 5) & (x < 15) | ~(px < 0.3) | (sqrt(px**2) > 0.45)) & (iteration >= 10)",
+	attributes = ["x", "px"]
+)
+
+def python_filter(particles):
+	return ( (particles.x>5.)*(particles.x<15.) + ~(particles.px<0.3) + (np.sqrt(particles.px**2)>0.45) ) * (Main.iteration>=10)
+
+DiagTrackParticles(
+	species = "eon_python",
+	every = 20,
+	filter = python_filter,
+	attributes = ["x", "px"]
+)
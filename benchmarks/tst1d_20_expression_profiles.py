@@ -0,0 +1,73 @@
+# ----------------------------------------------------------------------------------------
+# 	Compiled expression profiles, compared to the equivalent python profiles
+# ----------------------------------------------------------------------------------------
+
+import math
+import numpy as np
+L  = 20.
+
+Main(
+    geometry = "1Dcartesian",
+    
+    interpolation_order = 2,
+    
+    cell_length = [0.1],
+    grid_length  = [L],
+    
+    number_of_patches = [ 8 ],
+    
+    timestep = 0.095,
+    simulation_time = 30.,
+    
+    EM_boundary_conditions = [ ['silver-muller'] ],
+    solve_poisson = False,
+    
+    random_seed = smilei_mpi_rank
+)
+
+# The logical operators give 1 or 0 (not the value of one operand, like in python),
+# and `~` applies to the whole comparison that follows
+density = expression("where(x>4 & x<16, 1. + 0.5*tanh((x-10)/2)*(~ x>12 | 0.5), 0.) + 0.1*(2**-1 < x/20)")
+
+# Three frozen species with the same density: compiled, python equivalent of the
+# expression (evaluated point by point), and numpy version written by hand
+density_profiles = {
+	"eon_expression": density,
+	"eon_shim"      : lambda x: density(x),
+	"eon_numpy"     : lambda x: np.where((x>4)*(x<16), 1.+0.5*np.tanh((x-10.)/2.), 0.) + 0.1*(0.5 < x/20.),
+}
+for name, profile in density_profiles.items():
+	Species(
+		name = name,
+		position_initialization = "regular",
+		momentum_initialization = "cold",
+		particles_per_cell = 4,
+		mass = 1.0,
+		charge = -1.0,
+		number_density = profile,
+		boundary_conditions = [
+			["remove", "remove"],
+		],
+		time_frozen = 10000.
+	)
+
+# Two antennas, far apart, with the same current: compiled on the left, python on the right
+time_expression = texpression("sin(0.3*t)**2*(t<15) + (~ t<15)*exp(-(t-15)/5)")
+def time_python(t):
+	return math.sin(0.3*t)**2*(t<15) + (not t<15)*math.exp(-(t-15)/5)
+
+Antenna(
+	field = "Jz",
+	time_profile = time_expression,
+	space_profile = expression("0.1*exp(-((x-2.5)/0.3)**2)")
+)
+Antenna(
+	field = "Jz",
+	time_profile = time_python,
+	space_profile = lambda x: 0.1*np.exp(-((x-17.5)/0.3)**2)
+)
+
+DiagFields(
+	every = 40,
+	fields = ["Rho_eon_expression", "Rho_eon_shim", "Rho_eon_numpy", "Jz"]
+)
@@ -0,0 +1,57 @@
+# Field diagnostic published in shared memory, compared to the same diagnostic written in HDF5
+import math, os, sys, subprocess
+l0 = 2.0*math.pi  # wavelength in normalized units
+t0 = l0           # optical cycle in normalized units
+rest = 102.0      # nb of timestep in 1 optical cycle
+resx = 100.0      # nb cells in 1 wavelength
+
+Main(
+    geometry = "1Dcartesian",
+    interpolation_order = 2,
+    
+    cell_length = [l0/resx],
+    grid_length  = [6.0*l0],
+    
+    number_of_patches = [ 8 ],
+    
+    timestep = t0/rest,
+    simulation_time = 6.0*t0,
+    
+    EM_boundary_conditions = [ ['silver-muller'] ],
+    
+    random_seed = smilei_mpi_rank,
+    
+    print_every = int(rest/2.0)
+)
+
+Laser(
+    omega          = 1.,
+    time_envelope  = tgaussian(fwhm=1.*t0),
+    space_envelope = [1., 0.],
+)
+
+# Fewer slots than fields per output: the simulation waits for the reader
+DiagFields(
+    every = int(rest/2.0),
+    fields = ['Ex','Ey','Ez','By_m','Bz_m'],
+    output = "shared_memory",
+    shared_memory_slots = 3,
+    shared_memory_policy = "block"
+)
+
+# The same diagnostic written in HDF5
+DiagFields(
+    every = int(rest/2.0),
+    fields = ['Ex','Ey','Ez','By_m','Bz_m']
+)
+
+# Each process starts a reader of its own segment (found with the scripts of the python path)
+if not _test_mode:
+    reader = [p for p in sys.path if os.path.isfile(os.path.join(p, "scripts", "read_shared_memory.py"))]
+    if len(reader) == 0:
+        raise Exception("Cannot find scripts/read_shared_memory.py in the python path (run `make happi`)")
+    subprocess.Popen([
+        "python", os.path.join(reader[0], "scripts", "read_shared_memory.py"),
+        "smilei_%d_DiagFields0_%d" % (os.getpid(), smilei_mpi_rank),
+        os.path.abspath("shared_memory_%d.pickle" % smilei_mpi_rank)
+    ])
@@ -0,0 +1,67 @@
+# ----------------------------------------------------------------------------------------
+# 	Sparse particle binning, in both output formats, compared to the usual diagnostic
+# ----------------------------------------------------------------------------------------
+
+import math
+L  = 20.
+
+Main(
+    geometry = "1Dcartesian",
+    
+    interpolation_order = 2,
+    
+    cell_length = [0.1],
+    grid_length  = [L],
+    
+    number_of_patches = [ 8 ],
+    
+    timestep = 0.09,
+    simulation_time = 20.,
+    
+    EM_boundary_conditions = [ ['periodic'] ],
+    
+    random_seed = smilei_mpi_rank
+)
+
+Species(
+	name = "ion",
+	position_initialization = "regular",
+	momentum_initialization = "cold",
+	particles_per_cell = 8,
+	mass = 1836.0,
+	charge = 1.0,
+	number_density = 1.,
+	boundary_conditions = [
+		["periodic", "periodic"],
+	],
+	time_frozen = 10000.
+)
+Species(
+	name = "eon",
+	position_initialization = "random",
+	momentum_initialization = "maxwell-juettner",
+	particles_per_cell = 16,
+	mass = 1.0,
+	charge = -1.0,
+	number_density = 1.,
+	temperature = [0.01],
+	mean_velocity = [lambda x: 0.2*math.sin(2.*math.pi*x/L), 0., 0.],
+	boundary_conditions = [
+		["periodic", "periodic"],
+	],
+)
+
+# Many bins, mostly empty
+for sparse, sparse_output in [(False, "sparse"), (True, "sparse"), (True, "dense")]:
+	DiagParticleBinning(
+		deposited_quantity = "weight_charge",
+		every = 50,
+		species = ["eon"],
+		axes = [
+			["x" , 0. , L  , 40],
+			["px", -1., 1. , 50],
+			["py", -1., 1. , 50],
+		],
+		sparse = sparse,
+		sparse_output = sparse_output
+	)
@@ -0,0 +1,69 @@
+# ----------------------------------------------------------------------------------------
+# 	Restarts from checkpoints aggregated per node
+#
+# 	Run with restarts (e.g. `python validation.py -b tst1d_23_aggregated_checkpoint.py -r 2`).
+# 	The results do not depend on the restarts: at timestep = cell_length, the laser
+# 	propagates exactly one cell per timestep, and the tracked particles are neutral.
+# ----------------------------------------------------------------------------------------
+
+dx = 0.125
+L  = 64.
+
+Main(
+    geometry = "1Dcartesian",
+    
+    interpolation_order = 2,
+    
+    cell_length = [dx],
+    grid_length  = [L],
+    
+    number_of_patches = [ 8 ],
+    
+    timestep = dx,
+    simulation_time = 48.,
+    
+    EM_boundary_conditions = [ ['silver-muller'] ],
+    
+    solve_poisson = False,
+    
+    random_seed = smilei_mpi_rank
+)
+
+LaserPlanar1D(
+	box_side = "xmin",
+	a0 = 0.1,
+	omega = 1.,
+	polarization_phi = 0.,
+	ellipticity = 0.,
+	time_envelope = tgaussian(fwhm=8., center=12.)
+)
+
+Species(
+	name = "neutral",
+	position_initialization = "regular",
+	momentum_initialization = "cold",
+	particles_per_cell = 4,
+	mass = 1.0,
+	charge = 0.,
+	number_density = trapezoidal(1., xvacuum=8., xplateau=16.),
+	mean_velocity = [0.1, 0., 0.],
+	boundary_conditions = [
+		["remove", "remove"],
+	],
+)
+
+# The restarts read these files (the harness sets the dump steps)
+Checkpoints(
+	aggregators_per_node = 1,
+)
+
+DiagFields(
+	every = 32,
+	fields = ["Ey"]
+)
+
+DiagTrackParticles(
+	species = "neutral",
+	every = 32,
+	attributes = ["x", "px"]
+)
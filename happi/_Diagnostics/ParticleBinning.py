@@ -429,13 +429,21 @@ class ParticleBinning(Diagnostic):
 				print("Timestep "+str(t)+" not found in this diagnostic")
 				return []
 			# get data
-			B = self._np.empty(self._finalShape)
-			try:
-				self._h5items[d][index].read_direct(B, source_sel=self._selection) # get array
-			except:
-				B = self._np.squeeze(B)
-				self._h5items[d][index].read_direct(B, source_sel=self._selection) # get array
-				B = self._np.reshape(B, self._finalShape)
+			item = self._h5items[d][index]
+			if isinstance(item, self._h5py.Group):
+				# sparse output: indices and values of the non-empty bins
+				B = self._np.zeros([axis["size"] for axis in self._axes])
+				if "indices" in item:
+					B.flat[item["indices"][()]] = item["values"][()]
+				B = self._np.reshape(B[tuple(self._selection)], self._finalShape)
+			else:
+				B = self._np.empty(self._finalShape)
+				try:
+					item.read_direct(B, source_sel=self._selection) # get array
+				except:
+					B = self._np.squeeze(B)
+					item.read_direct(B, source_sel=self._selection) # get array
+					B = self._np.reshape(B, self._finalShape)
 			B[self._np.isnan(B)] = 0.
 			# Divide by the bins size
 			B *= self._bsize
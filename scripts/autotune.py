@@ -0,0 +1,255 @@
+#!/usr/bin/env python
+"""
+Startup autotuner for the patch layout of a Smilei simulation.
+
+Usage:
+    python autotune.py [options] namelist.py [other namelists or commands]
+
+A few iterations of the simulation are run for several candidate values of
+`Main.number_of_patches`, then of `Main.clrw` and `Main.cell_sorting` for the
+best patch layout. Each trial is timed with the internal timers of Smilei
+(particle dynamics, Maxwell solver, densities and synchronizations).
+The best setting is logged and written as a namelist fragment, to be added
+to the command line of the production run (or the run is started with --run).
+
+To keep the trials short, they run on a slice of the domain (a fraction 1/SLICE
+along one dimension) with SLICE times fewer processes: each process has the same
+number and size of patches as in the production run.
+
+Candidate layouts are first checked with `smilei_test` when it is available,
+so that invalid decompositions do not cost a parallel run.
+"""
+
+import argparse, os, re, shlex, shutil, subprocess, sys, tempfile
+
+# Timers accounted in the score of a trial
+scored_timers = ["Particles", "Maxwell", "Densities", "Sync Particles", "Sync Fields", "Sync Densities"]
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser(description="Find the fastest patch layout of a Smilei simulation")
+    parser.add_argument("namelists", nargs="+", help="namelist files or python commands, as given to smilei")
+    parser.add_argument("--smilei", default="./smilei", help="path to the smilei executable (default: ./smilei)")
+    parser.add_argument("--launcher", default="", help="command launching smilei, e.g. \"mpirun -np 16\"")
+    parser.add_argument("--processes", type=int, default=0,
+        help="number of MPI processes, to check the layouts with smilei_test (default: read from --launcher)")
+    parser.add_argument("--iterations", type=int, default=30, help="number of iterations of each trial (default: 30)")
+    parser.add_argument("--slice", type=int, default=4,
+        help="the trials run on 1/SLICE of the domain with SLICE times fewer processes (default: 4, or the largest power of 2 dividing the number of processes below 4; 1 for the full domain)")
+    parser.add_argument("--slice-dimension", type=int, default=-1,
+        help="dimension along which the domain is sliced, preferably one where the plasma is uniform (default: the last dimension)")
+    parser.add_argument("--trial-launcher", default=None,
+        help="command launching the trials (default: --launcher with SLICE times fewer processes)")
+    parser.add_argument("--patches", default="",
+        help="candidate patch layouts, e.g. \"16,16,8 32,16,8\" (default: the namelist layout with 4 times fewer to 4 times more patches)")
+    parser.add_argument("--clrw", default="",
+        help="candidate cluster widths, e.g. \"1 2 4\" (default: powers of 2 dividing the patch size in x)")
+    parser.add_argument("--no-sorting", action="store_true", help="do not try the cell sorting")
+    parser.add_argument("--output", default="autotune_result.py", help="namelist fragment with the best setting")
+    parser.add_argument("--run", action="store_true", help="start the simulation with the best setting")
+    parser.add_argument("--keep", action="store_true", help="keep the directories of the trials")
+    return parser.parse_args()
+
+
+def namelist_arguments(namelists):
+    # Files are given with their absolute path as trials run in their own directory
+    return [os.path.abspath(n) if os.path.isfile(n) else n for n in namelists]
+
+
+def slice_commands(args):
+    """Python commands keeping 1/args.slice of the domain along args.slice_dimension"""
+    if args.slice == 1:
+        return ""
+    return "\n".join([
+        "_k, _d = %d, %d" % (args.slice, args.slice_dimension),
+        "if Main.number_of_patches[_d] %% _k: raise Exception('autotune: number_of_patches[%d] is not a multiple of %d')" % (args.slice_dimension, args.slice),
+        "Main.number_of_patches = [n//_k if i==_d%len(Main.number_of_patches) else n for i, n in enumerate(Main.number_of_patches)]",
+        "if len(Main.grid_length): Main.grid_length = [l/_k if i==_d%len(Main.grid_length) else l for i, l in enumerate(Main.grid_length)]",
+        "if len(Main.number_of_cells): Main.number_of_cells = [n//_k if i==_d%len(Main.number_of_cells) else n for i, n in enumerate(Main.number_of_cells)]",
+    ])
+
+
+def trial_commands(args, settings):
+    """Python commands applying the settings to the namelist of a trial"""
+    return "\n".join(["Main.%s = %r" % (name, value) for name, value in settings.items()] + [slice_commands(args)])
+
+
+def run_trial(args, settings, directory):
+    """Run smilei for a few iterations with the given settings, return the output"""
+    commands = "Main.simulation_time = %d*Main.timestep\nMain.print_every = %d\n" % (args.iterations, args.iterations)
+    commands += trial_commands(args, settings)
+    command = shlex.split(args.trial_launcher) + [os.path.abspath(args.smilei)] \
+        + namelist_arguments(args.namelists) + [commands]
+    process = subprocess.Popen(command, cwd=directory, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    output = process.communicate()[0].decode("utf-8", "replace")
+    failed = process.returncode != 0 or "[ERROR]" in output
+    return output, failed
+
+
+def check_layout(args, settings, directory):
+    """Check a layout with smilei_test, return False if it is invalid"""
+    smilei_test = os.path.join(os.path.dirname(os.path.abspath(args.smilei)), "smilei_test")
+    if not os.path.isfile(smilei_test) or args.processes <= 0:
+        return True
+    commands = trial_commands(args, settings)
+    command = [smilei_test, str(args.processes // args.slice), "1"] + namelist_arguments(args.namelists) + [commands]
+    process = subprocess.Popen(command, cwd=directory, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    output = process.communicate()[0].decode("utf-8", "replace")
+    return process.returncode == 0 and "[ERROR]" not in output
+
+
+def read_timers(output):
+    """Times of the main timers printed at the end of the run"""
+    times = {}
+    for line in output.splitlines():
+        match = re.match(r"^\s*([A-Za-z][A-Za-z ]*?)\s+([0-9.]+(?:[eE][-+]?[0-9]+)?)\s+(?:<1%|[0-9.]+%)\s*$", line)
+        if match and match.group(1) in scored_timers:
+            times[match.group(1)] = float(match.group(2))
+    return times
+
+
+def read_layout(output):
+    """Number of patches, cells per patch and clrw used by a run"""
+    patches, cells = {}, {}
+    for line in output.splitlines():
+        match = re.search(r"dimension (\d) - number_of_patches : (\d+)", line)
+        if match:
+            patches[int(match.group(1))] = int(match.group(2))
+        match = re.search(r"dimension (\d) - n_space : (\d+) cells", line)
+        if match:
+            cells[int(match.group(1))] = int(match.group(2))
+    ndim = len(patches)
+    return [patches[i] for i in range(ndim)], [cells[i] for i in range(ndim)]
+
+
+def patch_candidates(patches, cells):
+    """Layouts with 4 times fewer to 4 times more patches than the namelist layout.
+    Patches are split along the dimension where they are the longest,
+    and merged along the dimension where they are the shortest."""
+    candidates = [list(patches)]
+    finer_patches, finer_cells = list(patches), list(cells)
+    coarser_patches, coarser_cells = list(patches), list(cells)
+    for step in range(2):
+        d = max(range(len(finer_cells)), key=lambda i: finer_cells[i])
+        if finer_cells[d] % 2 == 0:
+            finer_patches[d] *= 2
+            finer_cells[d] //= 2
+            candidates.append(list(finer_patches))
+        mergeable = [i for i in range(len(coarser_patches)) if coarser_patches[i] > 1]
+        if mergeable:
+            d = min(mergeable, key=lambda i: coarser_cells[i])
+            coarser_patches[d] //= 2
+            coarser_cells[d] *= 2
+            candidates.append(list(coarser_patches))
+    return candidates
+
+
+def score(times):
+    return sum(times.values())
+
+
+def main():
+    args = parse_arguments()
+    if args.processes <= 0:
+        match = re.search(r"-(?:np|n)\s+(\d+)", args.launcher)
+        args.processes = int(match.group(1)) if match else 1
+    if args.slice < 1:
+        sys.exit("--slice must be a positive integer")
+    # Powers of 2, as the patches of the Hilbert ordering
+    while args.processes % args.slice or args.slice & (args.slice - 1):
+        args.slice -= 1
+    if args.trial_launcher is None:
+        args.trial_launcher = re.sub(r"(-(?:np|n)\s+)(\d+)", lambda m: m.group(1) + str(args.processes // args.slice), args.launcher, count=1)
+        if args.slice > 1 and args.trial_launcher == args.launcher:
+            sys.exit("The number of processes is not found in --launcher: give --trial-launcher")
+
+    workdir = tempfile.mkdtemp(prefix="autotune_", dir=os.getcwd())
+    results = []
+
+    def trial(settings):
+        directory = tempfile.mkdtemp(dir=workdir)
+        if not check_layout(args, settings, directory):
+            print("  %-50s invalid layout" % settings_string(settings))
+            return None, None
+        output, failed = run_trial(args, settings, directory)
+        if failed:
+            print("  %-50s failed (see %s)" % (settings_string(settings), directory))
+            open(os.path.join(directory, "autotune.log"), "w").write(output)
+            return None, None
+        times = read_timers(output)
+        results.append((score(times), settings, times))
+        print("  %-50s %10.4f s  (%s)" % (settings_string(settings), score(times),
+            ", ".join("%s %.3f" % (name, times[name]) for name in scored_timers if name in times)))
+        sys.stdout.flush()
+        return times, output
+
+    print("Autotuning with %d iterations per trial in %s" % (args.iterations, workdir))
+    if args.slice > 1:
+        print("Trials on 1/%d of the domain along dimension %d, with %d processes"
+              % (args.slice, args.slice_dimension, args.processes // args.slice))
+
+    # Reference trial with the namelist setting
+    print("Patch layouts:")
+    times, output = trial({})
+    if times is None:
+        sys.exit("The simulation fails with the namelist setting")
+    patches, cells = read_layout(output)
+    # The layout of the production run, from the sliced one
+    patches[args.slice_dimension] *= args.slice
+
+    # Patch layouts
+    if args.patches:
+        candidates = [[int(n) for n in layout.split(",")] for layout in args.patches.split()]
+    else:
+        candidates = patch_candidates(patches, cells)[1:]
+    for layout in candidates:
+        if layout[args.slice_dimension] % args.slice:
+            print("  %-50s not sliceable in %d" % (settings_string({"number_of_patches": layout}), args.slice))
+            continue
+        trial({"number_of_patches": layout})
+    best_patches = min(results, key=lambda r: r[0])[1].get("number_of_patches", patches)
+
+    # Cluster width and cell sorting for the best patch layout
+    best_cells = [c * p // q for c, p, q in zip(cells, patches, best_patches)]
+    if args.clrw:
+        clrws = [int(c) for c in args.clrw.split()]
+    else:
+        clrws = [c for c in [1, 2, 4, 8, 16, 32, 64] if c <= best_cells[0] and best_cells[0] % c == 0]
+        if best_cells[0] not in clrws:
+            clrws.append(best_cells[0])
+    sortings = [False] if args.no_sorting else [False, True]
+    print("Cluster widths and cell sorting for number_of_patches = %s:" % best_patches)
+    for clrw in clrws:
+        for sorting in sortings:
+            trial({"number_of_patches": best_patches, "clrw": clrw, "cell_sorting": sorting})
+
+    best_score, best_settings, best_times = min(results, key=lambda r: r[0])
+    reference_score = results[0][0]
+    print("Best setting: %s" % settings_string(best_settings))
+    print("  %.4f s instead of %.4f s with the namelist setting (%.1f%%)"
+          % (best_score, reference_score, 100. * (best_score - reference_score) / reference_score))
+
+    with open(args.output, "w") as f:
+        f.write("# Setting selected by autotune.py over %d iterations (%.4f s instead of %.4f s)\n"
+                % (args.iterations, best_score, reference_score))
+        for name, value in best_settings.items():
+            f.write("Main.%s = %r\n" % (name, value))
+    print("Written in %s" % args.output)
+
+    if not args.keep:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    if args.run:
+        command = shlex.split(args.launcher) + [args.smilei] + args.namelists + [os.path.abspath(args.output)]
+        print("Running " + " ".join(command))
+        sys.exit(subprocess.call(command))
+
+
+def settings_string(settings):
+    if not settings:
+        return "namelist setting"
+    return ", ".join("%s = %s" % (name, value) for name, value in settings.items())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,130 @@
+#!/usr/bin/env python
+"""
+Reads the records that one process of a simulation publishes in shared memory
+(diagnostic option output = "shared_memory"), while the simulation runs, and stores
+them in a pickle file. The layout of the segment is described in the documentation
+of the option `output` of DiagFields.
+
+Usage:  python read_shared_memory.py <segment> <output_file>
+
+	<segment>     : name of the segment, e.g. smilei_12345_DiagFields0_0 (in /dev/shm)
+	<output_file> : the pickle file to write
+
+The reader waits for the segment, reads each record once it is complete, and increases
+the number of records read (which lets a simulation with the policy "block" proceed).
+It stops when the segment is removed or when the simulation process has terminated.
+
+The pickle file contains a dictionary with:
+	"header" : the version, policy, number of slots and size of the slots
+	"records": a list of dictionaries (sequence, timestep, name, type, shape, offset,
+	           global_shape, data), where data is the raw bytes of the array
+	"dropped": the number of records overwritten before they could be read
+	"errors" : a list of inconsistencies found in the segment (should be empty)
+"""
+
+import os, sys, time, mmap, struct, pickle
+
+HEADER_SIZE = 64
+RECORD_SIZE = 288
+TYPES = ["float64", "uint64", "int16"]
+TYPE_SIZES = [8, 8, 2]
+
+def process_is_running(pid):
+	try:
+		os.kill(pid, 0)
+	except OSError:
+		return False
+	return True
+
+def write_result(result, output_file):
+	# The file appears complete, for programs waiting for it
+	pickle.dump(result, open(output_file+".tmp", "wb"), protocol=2)
+	os.rename(output_file+".tmp", output_file)
+
+def read_shared_memory(segment, output_file, poll=0.001):
+	path = "/dev/shm/" + segment.lstrip("/")
+	pid = int(segment.lstrip("/").split("_")[1])
+	result = {"header":None, "records":[], "dropped":0, "errors":[]}
+
+	# The segment is created at the end of the first output; its magic is written last
+	shm = None
+	while shm is None:
+		if os.path.exists(path) and os.path.getsize(path) >= HEADER_SIZE:
+			f = open(path, "r+b")
+			shm = mmap.mmap(f.fileno(), 0)
+			f.close()
+			if shm[0:8] != b"SMILEIRB":
+				shm.close()
+				shm = None
+		if shm is None:
+			if not process_is_running(pid):
+				result["errors"] += ["The segment was never created"]
+				write_result(result, output_file)
+				return result
+			time.sleep(poll)
+
+	version, policy, nslots, slot_size = struct.unpack_from("<IIQQ", shm, 8)
+	result["header"] = {"version":version, "policy":["drop_oldest","block"][policy], "nslots":nslots, "slot_size":slot_size}
+	if version != 1:
+		result["errors"] += ["Unknown version %d" % version]
+	if len(shm) != HEADER_SIZE + nslots * slot_size:
+		result["errors"] += ["The segment size %d does not match its header" % len(shm)]
+
+	n = 0
+	finished = False
+	while True:
+		published = struct.unpack_from("<Q", shm, 32)[0]
+		while n < published:
+			slot = HEADER_SIZE + (n % nslots) * slot_size
+			sequence = struct.unpack_from("<Q", shm, slot)[0]
+			if sequence != 2*n+2:
+				# With "drop_oldest", the record may already be overwritten by a newer one
+				if sequence > 2*n+2 and policy == 0:
+					result["dropped"] += 1
+				else:
+					result["errors"] += ["Record %d has the sequence number %d" % (n, sequence)]
+				n += 1
+				continue
+			timestep, name, type, ndims = struct.unpack_from("<q64sII", shm, slot+8)
+			shape        = struct.unpack_from("<8Q", shm, slot+88 )[:ndims]
+			offset       = struct.unpack_from("<8Q", shm, slot+152)[:ndims]
+			global_shape = struct.unpack_from("<8Q", shm, slot+216)[:ndims]
+			nbytes = struct.unpack_from("<Q", shm, slot+280)[0]
+			data = shm[slot+RECORD_SIZE : slot+RECORD_SIZE+nbytes]
+			# The record must not have changed while it was copied
+			if struct.unpack_from("<Q", shm, slot)[0] != sequence:
+				result["dropped"] += 1
+				n += 1
+				continue
+			if type < len(TYPES):
+				size = TYPE_SIZES[type]
+				for s in shape: size *= s
+				if size != nbytes:
+					result["errors"] += ["Record %d has %d bytes for a shape %s" % (n, nbytes, str(shape))]
+			else:
+				result["errors"] += ["Record %d has the unknown type %d" % (n, type)]
+			result["records"] += [{
+				"sequence":sequence, "timestep":timestep, "name":name.rstrip(b"\0").decode(),
+				"type":TYPES[type] if type < len(TYPES) else None,
+				"shape":shape, "offset":offset, "global_shape":global_shape, "data":data,
+			}]
+			n += 1
+			# Tell the simulation that the slot can be reused
+			struct.pack_into("<Q", shm, 40, n)
+		if finished:
+			break
+		# Read the last records after the end of the simulation
+		if not os.path.exists(path) or not process_is_running(pid):
+			finished = True
+		else:
+			time.sleep(poll)
+
+	shm.close()
+	write_result(result, output_file)
+	return result
+
+if __name__ == "__main__":
+	if len(sys.argv) != 3:
+		print(__doc__)
+		sys.exit(1)
+	read_shared_memory(sys.argv[1], sys.argv[2])
@@ -8,7 +8,12 @@
 
 #include <sstream>
 #include <iomanip>
+#include <cstdio>
 #include <string>
+#include <cstring>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <mpi.h>
 
@@ -28,11 +33,13 @@
 #include "DiagnosticTrack.h"
 #include "LaserEnvelope.h"
 #include "Collisions.h"
+#include "AsyncWriter.h"
 
 using namespace std;
 
 // static varable must be defined and initialized here
 int Checkpoint::signal_received=0;
+Checkpoint *Checkpoint::memory_instance_=NULL;
 
 Checkpoint::Checkpoint( Params &params, SmileiMPI *smpi ) :
     dump_number( 0 ),
@@ -40,6 +47,7 @@ Checkpoint::Checkpoint( Params &params, SmileiMPI *smpi ) :
     exit_asap( false ),
     dump_step( 0 ),
     dump_minutes( 0.0 ),
+    memory_step( 0 ),
     exit_after_dump( true ),
     time_reference( MPI_Wtime() ),
     time_dump_step( 0 ),
@@ -47,8 +55,17 @@ Checkpoint::Checkpoint( Params &params, SmileiMPI *smpi ) :
     keep_n_dumps_max( 10000 ),
     dump_deflate( 0 ),
     dump_request( smpi->getSize() ),
-    file_grouping( 0 )
+    file_grouping( 0 ),
+    aggregators_per_node( 0 ),
+    aggregation_comm_( MPI_COMM_NULL ),
+    aggregators_comm_( MPI_COMM_NULL ),
+    restart_aggregated_( false ),
+    asynchronous_( false ),
+    memory_partner_shift_( 1 ),
+    memory_latest_( 1 )
 {
+    memory_valid_[0] = 0;
+    memory_valid_[1] = 0;
 
     if( PyTools::nComponents( "Checkpoints" ) > 0 ) {
     
@@ -85,23 +102,93 @@ Checkpoint::Checkpoint( Params &params, SmileiMPI *smpi ) :
             MESSAGE( 1, "Code will group checkpoint files by "<< file_grouping );
         }
         
+        PyTools::extract( "aggregators_per_node", aggregators_per_node, "Checkpoints" );
+        if( aggregators_per_node > 0 ) {
+            // Ranks of each node are split in groups, each sending its data to one aggregator
+            MPI_Comm node_comm;
+            MPI_Comm_split_type( MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, smpi->getRank(), MPI_INFO_NULL, &node_comm );
+            int node_rank, node_size;
+            MPI_Comm_rank( node_comm, &node_rank );
+            MPI_Comm_size( node_comm, &node_size );
+            int group = ( int )( ( ( uint64_t ) node_rank * aggregators_per_node ) / node_size );
+            MPI_Comm_split( node_comm, group, node_rank, &aggregation_comm_ );
+            MPI_Comm_free( &node_comm );
+            int aggregation_rank;
+            MPI_Comm_rank( aggregation_comm_, &aggregation_rank );
+            MPI_Comm_split( MPI_COMM_WORLD, aggregation_rank==0 ? 0 : MPI_UNDEFINED, smpi->getRank(), &aggregators_comm_ );
+            int n_aggregators = aggregation_rank==0 ? 1 : 0;
+            MPI_Allreduce( MPI_IN_PLACE, &n_aggregators, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD );
+            MESSAGE( 1, "Checkpoints aggregated in " << n_aggregators << " files (" << aggregators_per_node << " per node)" );
+        }
+        
+        PyTools::extract( "asynchronous", asynchronous_, "Checkpoints" );
+        if( asynchronous_ ) {
+            if( aggregators_per_node > 0 ) {
+                ERROR( "Checkpoints: `asynchronous` is not available with `aggregators_per_node`" );
+            }
+            MESSAGE( 1, "Checkpoints are copied in memory and written in the background" );
+        }
+        
+        PyTools::extract( "memory_step", memory_step, "Checkpoints" );
+        if( memory_step > 0 && smpi->getSize() > 1 ) {
+            // The partner is on another node if possible, so that the copy survives the loss of a node
+            MPI_Comm node_comm;
+            MPI_Comm_split_type( MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, smpi->getRank(), MPI_INFO_NULL, &node_comm );
+            MPI_Comm_size( node_comm, &memory_partner_shift_ );
+            MPI_Comm_free( &node_comm );
+            MPI_Allreduce( MPI_IN_PLACE, &memory_partner_shift_, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD );
+            if( memory_partner_shift_ % smpi->getSize() == 0 ) {
+                memory_partner_shift_ = 1;
+            }
+        }
+        if( memory_step > 0 ) {
+            int source = ( smpi->getRank() - memory_partner_shift_ + smpi->getSize() ) % smpi->getSize();
+            for( unsigned int slot=0; slot<2; slot++ ) {
+                ostringstream name( "" );
+                name << "checkpoints" << PATH_SEPARATOR << "memory" << PATH_SEPARATOR << "dump-" << setfill( '0' ) << setw( 5 ) << slot << "-" << setw( 10 ) << smpi->getRank() << ".h5";
+                memory_file_[slot] = name.str();
+                name.str( "" );
+                name << "checkpoints" << PATH_SEPARATOR << "memory" << PATH_SEPARATOR << "partner" << PATH_SEPARATOR << "dump-" << setfill( '0' ) << setw( 5 ) << slot << "-" << setw( 10 ) << source << ".h5";
+                partner_file_[slot] = name.str();
+            }
+            MESSAGE( 1, "Code will dump in memory every " << memory_step << " steps, with a copy in rank +" << memory_partner_shift_ );
+        }
+        
         if( params.restart ) {
             std::vector<std::string> restart_files;
             PyTools::extract( "restart_files", restart_files, "Checkpoints" );
             
             // This will open all dumps and pick the last one
+            vector<int> dump_steps( restart_files.size(), -1 );
+            int latest_step = -1;
             for( unsigned int num_dump=0; num_dump<restart_files.size(); num_dump++ ) {
-                string dump_name=restart_files[num_dump];
-                hid_t fid = H5Fopen( dump_name.c_str(), H5F_ACC_RDWR, H5P_DEFAULT );
+                hid_t fid = H5Fopen( restart_files[num_dump].c_str(), H5F_ACC_RDONLY, H5P_DEFAULT );
+                if( fid < 0 ) {
+                    WARNING( restart_files[num_dump] << " is not a valid HDF5 file" );
+                    continue;
+                }
                 unsigned int stepStartTmp=0;
                 H5::getAttr( fid, "dump_step", stepStartTmp );
-                if( stepStartTmp>this_run_start_step ) {
-                    this_run_start_step=stepStartTmp;
+                dump_steps[num_dump] = stepStartTmp;
+                latest_step = max( latest_step, dump_steps[num_dump] );
+                H5Fclose( fid );
+            }
+            
+            // Some dumps (in memory) may be missing or older in some ranks: restart all ranks from the same step
+            MPI_Allreduce( MPI_IN_PLACE, &latest_step, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD );
+            
+            for( unsigned int num_dump=0; num_dump<restart_files.size(); num_dump++ ) {
+                if( latest_step > 0 && dump_steps[num_dump] == latest_step ) {
+                    string dump_name=restart_files[num_dump];
+                    hid_t fid = H5Fopen( dump_name.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT );
+                    this_run_start_step=latest_step;
                     restart_file=dump_name;
                     dump_number=num_dump;
                     H5::getAttr( fid, "dump_number", dump_number );
+                    restart_aggregated_ = H5::hasAttr( fid, "aggregated_files" );
+                    H5Fclose( fid );
+                    break;
                 }
-                H5Fclose( fid );
             }
             
             if( restart_file.empty() ) {
@@ -142,10 +229,33 @@ Checkpoint::Checkpoint( Params &params, SmileiMPI *smpi ) :
     if( SIG_ERR == signal( SIGUSR2, Checkpoint::signal_callback_handler ) ) {
         WARNING( "Cannot catch signal SIGUSR2" );
     }
+    if( memory_step > 0 ) {
+        memory_instance_ = this;
+        if( SIG_ERR == signal( SIGTERM, Checkpoint::memory_signal_handler ) ) {
+            WARNING( "Cannot catch signal SIGTERM: in-memory dumps will not be written" );
+        }
+    }
     
     nDim_particle=params.nDim_particle;
 }
 
+Checkpoint::~Checkpoint()
+{
+    // The program exit waits for the last dump
+    waitAsynchronousDump();
+    if( aggregation_comm_ != MPI_COMM_NULL ) {
+        MPI_Comm_free( &aggregation_comm_ );
+    }
+    if( aggregators_comm_ != MPI_COMM_NULL ) {
+        MPI_Comm_free( &aggregators_comm_ );
+    }
+    if( memory_instance_ == this ) {
+        memory_valid_[0] = 0;
+        memory_valid_[1] = 0;
+        memory_instance_ = NULL;
+    }
+}
+
 void Checkpoint::dump( VectorPatch &vecPatches, unsigned int itime, SmileiMPI *smpi, SimWindow *simWindow, Params &params )
 {
 
@@ -181,13 +291,23 @@ void Checkpoint::dump( VectorPatch &vecPatches, unsigned int itime, SmileiMPI *s
         signal_received=0;
         time_dump_step=0;
         time_reference = MPI_Wtime();
+    } else if( memory_step != 0 && ( itime-this_run_start_step ) % memory_step == 0 && itime != this_run_start_step ) {
+        dumpMemory( vecPatches, itime, smpi, simWindow, params );
     }
 }
 
 void Checkpoint::dumpAll( VectorPatch &vecPatches, unsigned int itime,  SmileiMPI *smpi, SimWindow *simWin,  Params &params )
 {
+    // No file access while the I/O thread writes diagnostics
+    AsyncWriter::wait();
+    
     unsigned int num_dump=dump_number % keep_n_dumps;
     
+    if( aggregators_per_node > 0 ) {
+        dumpAggregated( vecPatches, itime, smpi, simWin, params, num_dump );
+        return;
+    }
+    
     ostringstream nameDumpTmp( "" );
     nameDumpTmp << "checkpoints" << PATH_SEPARATOR;
     if( file_grouping>0 ) {
@@ -198,7 +318,18 @@ void Checkpoint::dumpAll( VectorPatch &vecPatches, unsigned int itime,  SmileiMP
     std::string dumpName=nameDumpTmp.str();
     
     
-    hid_t fid = H5Fcreate( dumpName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
+    // Asynchronous dumps are first built in memory (HDF5 core driver without backing store)
+    hid_t fapl = H5P_DEFAULT;
+    if( asynchronous_ ) {
+        waitAsynchronousDump();
+        fapl = H5Pcreate( H5P_FILE_ACCESS );
+        H5Pset_fapl_core( fapl, 64<<20, 0 );
+    }
+    
+    hid_t fid = H5Fcreate( dumpName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl );
+    if( asynchronous_ ) {
+        H5Pclose( fapl );
+    }
     if (fid<0) {
         ERROR("Can't open file for writing checkpoint " << dumpName.c_str())
     } else {
@@ -212,6 +343,212 @@ void Checkpoint::dumpAll( VectorPatch &vecPatches, unsigned int itime,  SmileiMP
 #endif
     
     
+    dumpGlobalData( fid, vecPatches, itime, smpi, simWin, params );
+    
+    dumpPatches( fid, vecPatches, params );
+    
+    // Keep a copy of the in-memory file
+    if( asynchronous_ ) {
+        H5Fflush( fid, H5F_SCOPE_LOCAL );
+        ssize_t size = H5Fget_file_image( fid, NULL, 0 );
+        if( size < 0 ) {
+            ERROR( "Can't get the memory image of checkpoint " << dumpName.c_str() );
+        }
+        dump_image_.resize( size );
+        H5Fget_file_image( fid, &dump_image_[0], size );
+    }
+    
+    herr_t tclose = H5Fclose( fid );
+    if (tclose < 0) {
+        ERROR("Can't close file " << dumpName.c_str())
+    }
+    
+    // The background thread writes the file while the simulation continues.
+    // A temporary name ensures that an incomplete file is never taken for a valid dump.
+    if( asynchronous_ ) {
+        dump_thread_ = std::thread( [this, dumpName]() {
+            string tmpName = dumpName + ".tmp";
+            FILE *f = fopen( tmpName.c_str(), "wb" );
+            if( ! f ) {
+                dump_error_ = "Can't open file for writing checkpoint " + tmpName;
+                return;
+            }
+            size_t written = fwrite( &dump_image_[0], 1, dump_image_.size(), f );
+            if( fclose( f ) != 0 || written != dump_image_.size() ) {
+                dump_error_ = "Can't write checkpoint " + tmpName;
+                return;
+            }
+            if( rename( tmpName.c_str(), dumpName.c_str() ) != 0 ) {
+                dump_error_ = "Can't rename checkpoint " + tmpName;
+            }
+            vector<char>().swap( dump_image_ );
+        } );
+    }
+    
+}
+
+void Checkpoint::dumpPatches( hid_t fid, VectorPatch &vecPatches, Params &params )
+{
+    // Write all the patch data
+    for( unsigned int ipatch=0 ; ipatch<vecPatches.size(); ipatch++ ) {
+    
+        // Open a group
+        ostringstream patch_name( "" );
+        patch_name << setfill( '0' ) << setw( 6 ) << vecPatches( ipatch )->Hindex();
+        string patchName=Tools::merge( "patch-", patch_name.str() );
+        hid_t patch_gid = H5::group( fid, patchName.c_str() );
+        
+        dumpPatch( vecPatches( ipatch )->EMfields, vecPatches( ipatch )->vecSpecies, vecPatches( ipatch )->vecCollisions, params, patch_gid );
+        
+        // Random number generator state
+        H5::attr( patch_gid, "xorshift32_state", vecPatches( ipatch )->xorshift32_state );
+        
+        // Close a group
+        H5Gclose( patch_gid );
+        
+    }
+    
+    // Write the latest Id that the MPI processes have given to each species
+    for( unsigned int idiag=0; idiag<vecPatches.localDiags.size(); idiag++ ) {
+        if( DiagnosticTrack *track = dynamic_cast<DiagnosticTrack *>( vecPatches.localDiags[idiag] ) ) {
+            ostringstream n( "" );
+            n<< "latest_ID_" << vecPatches( 0 )->vecSpecies[track->speciesId_]->name_;
+            H5::attr( fid, n.str().c_str(), track->latest_Id, H5T_NATIVE_UINT64 );
+        }
+    }
+}
+
+void Checkpoint::waitAsynchronousDump()
+{
+    if( dump_thread_.joinable() ) {
+        dump_thread_.join();
+    }
+    if( ! dump_error_.empty() ) {
+        ERROR( dump_error_ );
+    }
+}
+
+void Checkpoint::dumpMemory( VectorPatch &vecPatches, unsigned int itime, SmileiMPI *smpi, SimWindow *simWin, Params &params )
+{
+    // No file access while the I/O thread writes diagnostics
+    AsyncWriter::wait();
+    
+    // The oldest copies are replaced, while the latest ones remain valid
+    unsigned int slot = 1 - memory_latest_;
+    memory_valid_[slot] = 0;
+    atomic_signal_fence( memory_order_seq_cst );
+    vector<char> &memory_image = memory_image_[slot];
+    vector<char> &partner_image = partner_image_[slot];
+    
+    // Same content as a file per processor, built in memory only
+    hid_t fapl = H5Pcreate( H5P_FILE_ACCESS );
+    H5Pset_fapl_core( fapl, 64<<20, 0 );
+    hid_t fid = H5Fcreate( memory_file_[slot].c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl );
+    H5Pclose( fapl );
+    if( fid<0 ) {
+        ERROR( "Can't create the in-memory checkpoint" );
+    }
+    
+    dumpGlobalData( fid, vecPatches, itime, smpi, simWin, params );
+    dumpPatches( fid, vecPatches, params );
+    
+    H5Fflush( fid, H5F_SCOPE_LOCAL );
+    ssize_t size = H5Fget_file_image( fid, NULL, 0 );
+    if( size < 0 ) {
+        ERROR( "Can't get the memory image of the in-memory checkpoint" );
+    }
+    memory_image.resize( size );
+    H5Fget_file_image( fid, &memory_image[0], size );
+    H5Fclose( fid );
+    
+    // Each rank keeps a copy of the dump of the rank memory_partner_shift_ below
+    if( smpi->getSize() > 1 ) {
+        int dest   = ( smpi->getRank() + memory_partner_shift_ ) % smpi->getSize();
+        int source = ( smpi->getRank() - memory_partner_shift_ + smpi->getSize() ) % smpi->getSize();
+        uint64_t send_size = memory_image.size(), recv_size;
+        MPI_Sendrecv( &send_size, 1, MPI_UNSIGNED_LONG_LONG, dest, SMILEI_COMM_DUMP_DATA,
+                      &recv_size, 1, MPI_UNSIGNED_LONG_LONG, source, SMILEI_COMM_DUMP_DATA,
+                      smpi->SMILEI_COMM_WORLD, MPI_STATUS_IGNORE );
+        partner_image.resize( recv_size );
+        // Messages smaller than 1 GB
+        const uint64_t message_size = 1<<30;
+        vector<MPI_Request> requests;
+        for( uint64_t offset=0; offset<recv_size; offset+=message_size ) {
+            requests.push_back( MPI_REQUEST_NULL );
+            MPI_Irecv( &partner_image[offset], min( message_size, recv_size-offset ), MPI_BYTE, source, SMILEI_COMM_DUMP_DATA, smpi->SMILEI_COMM_WORLD, &requests.back() );
+        }
+        for( uint64_t offset=0; offset<send_size; offset+=message_size ) {
+            requests.push_back( MPI_REQUEST_NULL );
+            MPI_Isend( &memory_image[offset], min( message_size, send_size-offset ), MPI_BYTE, dest, SMILEI_COMM_DUMP_DATA, smpi->SMILEI_COMM_WORLD, &requests.back() );
+        }
+        MPI_Waitall( requests.size(), requests.data(), MPI_STATUSES_IGNORE );
+    }
+    
+    // The signal handler sees this copy only once it is complete
+    atomic_signal_fence( memory_order_seq_cst );
+    memory_valid_[slot] = 1;
+    memory_latest_ = slot;
+    
+#ifdef  __DEBUG
+    MESSAGEALL( "Step " << itime << " : DUMP fields and particles in memory (" << memory_image.size() << " bytes)" );
+#endif
+}
+
+// Write a file image with async-signal-safe functions only
+static void writeImageOnSignal( const string &name, const vector<char> &image )
+{
+    if( image.size() == 0 ) {
+        return;
+    }
+    string::size_type length = name.size();
+    char tmp_name[4096];
+    if( length + 5 > sizeof( tmp_name ) ) {
+        return;
+    }
+    memcpy( tmp_name, name.c_str(), length );
+    memcpy( tmp_name + length, ".tmp", 5 );
+    int fd = open( tmp_name, O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+    if( fd < 0 ) {
+        return;
+    }
+    const char *data = &image[0];
+    size_t remaining = image.size();
+    while( remaining > 0 ) {
+        ssize_t written = write( fd, data, remaining );
+        if( written <= 0 ) {
+            close( fd );
+            return;
+        }
+        data += written;
+        remaining -= written;
+    }
+    if( close( fd ) == 0 ) {
+        rename( tmp_name, name.c_str() );
+    }
+}
+
+void Checkpoint::memory_signal_handler( int signum )
+{
+    // When a rank fails, the job manager terminates the others: their in-memory dumps
+    // (their own and their partner's) are enough to rebuild a complete checkpoint.
+    // Both complete dumps are written: a rank may be building the latest one, and the
+    // restart then uses the previous one in all ranks
+    Checkpoint *checkpoint = memory_instance_;
+    if( checkpoint ) {
+        for( unsigned int slot=0; slot<2; slot++ ) {
+            if( checkpoint->memory_valid_[slot] ) {
+                checkpoint->memory_valid_[slot] = 0;
+                writeImageOnSignal( checkpoint->memory_file_[slot], checkpoint->memory_image_[slot] );
+                writeImageOnSignal( checkpoint->partner_file_[slot], checkpoint->partner_image_[slot] );
+            }
+        }
+    }
+    signal( signum, SIG_DFL );
+    raise( signum );
+}
+
+void Checkpoint::dumpGlobalData( hid_t fid, VectorPatch &vecPatches, unsigned int itime, SmileiMPI *smpi, SimWindow *simWin, Params &params )
+{
     // Write basic attributes
     H5::attr( fid, "Version", string( __VERSION ) );
     
@@ -245,6 +582,7 @@ void Checkpoint::dumpAll( VectorPatch &vecPatches, unsigned int itime,  SmileiMP
     if( smpi->isMaster() ) {
         for( unsigned int idiag=0; idiag<vecPatches.globalDiags.size(); idiag++ ) {
             if( DiagnosticScreen *screen = dynamic_cast<DiagnosticScreen *>( vecPatches.globalDiags[idiag] ) ) {
+                screen->gatherThreads();
                 diagName.str( "" );
                 diagName << "DiagScreen" << screen->screen_id;
                 H5::vect( fid, diagName.str(), screen->data_sum );
@@ -252,44 +590,216 @@ void Checkpoint::dumpAll( VectorPatch &vecPatches, unsigned int itime,  SmileiMP
         }
     }
     
-    // Write all the patch data
-    for( unsigned int ipatch=0 ; ipatch<vecPatches.size(); ipatch++ ) {
+    // Write the moving window status
+    if( simWin!=NULL ) {
+        dumpMovingWindow( fid, simWin );
+    }
+}
+
+// Data exchanged with the aggregators is split in messages smaller than 1 GB
+static const uint64_t aggregation_message_size = 1<<30;
+
+void Checkpoint::dumpAggregated( VectorPatch &vecPatches, unsigned int itime, SmileiMPI *smpi, SimWindow *simWin, Params &params, unsigned int num_dump )
+{
+    // Serialize the patches of this rank in memory
+    unsigned int npatches = vecPatches.size();
+    vector<char> data;
+    vector<uint64_t> patch_info( 2*npatches ); // hindex and size of each patch
+    for( unsigned int ipatch=0 ; ipatch<npatches; ipatch++ ) {
+        uint64_t start = data.size();
+        dumpPatchImage( vecPatches( ipatch ), params, data );
+        patch_info[2*ipatch  ] = vecPatches( ipatch )->Hindex();
+        patch_info[2*ipatch+1] = data.size() - start;
+    }
     
-        // Open a group
-        ostringstream patch_name( "" );
-        patch_name << setfill( '0' ) << setw( 6 ) << vecPatches( ipatch )->Hindex();
-        string patchName=Tools::merge( "patch-", patch_name.str() );
-        hid_t patch_gid = H5::group( fid, patchName.c_str() );
-        
-        dumpPatch( vecPatches( ipatch )->EMfields, vecPatches( ipatch )->vecSpecies, vecPatches( ipatch )->vecCollisions, params, patch_gid );
-        
-        // Random number generator state
-        H5::attr( patch_gid, "xorshift32_state", vecPatches( ipatch )->xorshift32_state );
-        
-        // Close a group
-        H5Gclose( patch_gid );
+    // The aggregator receives the sizes and the patch tables of its group
+    int aggregation_rank, aggregation_size;
+    MPI_Comm_rank( aggregation_comm_, &aggregation_rank );
+    MPI_Comm_size( aggregation_comm_, &aggregation_size );
+    uint64_t data_size = data.size();
+    vector<uint64_t> member_data_size( aggregation_size );
+    MPI_Gather( &data_size, 1, MPI_UNSIGNED_LONG_LONG, &member_data_size[0], 1, MPI_UNSIGNED_LONG_LONG, 0, aggregation_comm_ );
+    int info_size = patch_info.size();
+    vector<int> member_info_size( aggregation_size ), member_info_disp( aggregation_size, 0 );
+    MPI_Gather( &info_size, 1, MPI_INT, &member_info_size[0], 1, MPI_INT, 0, aggregation_comm_ );
+    for( int i=1; i<aggregation_size; i++ ) {
+        member_info_disp[i] = member_info_disp[i-1] + member_info_size[i-1];
+    }
+    vector<uint64_t> group_info( aggregation_rank==0 ? member_info_disp.back() + member_info_size.back() : 0 );
+    MPI_Gatherv( patch_info.data(), info_size, MPI_UNSIGNED_LONG_LONG, group_info.data(), &member_info_size[0], &member_info_disp[0], MPI_UNSIGNED_LONG_LONG, 0, aggregation_comm_ );
+    
+    // Other ranks only send their data to the aggregator
+    if( aggregation_rank != 0 ) {
+        dump_number++;
+        for( uint64_t offset=0; offset<data_size; offset+=aggregation_message_size ) {
+            int count = min( aggregation_message_size, data_size-offset );
+            MPI_Send( &data[offset], count, MPI_BYTE, 0, SMILEI_COMM_DUMP_DATA, aggregation_comm_ );
+        }
+        // Contribute to the global table of the first file
+        dumpAggregatedTables( vecPatches, smpi, group_info, 0, -1 );
+        return;
+    }
+    
+    int ifile;
+    MPI_Comm_rank( aggregators_comm_, &ifile );
+    ostringstream nameDumpTmp( "" );
+    nameDumpTmp << "checkpoints" << PATH_SEPARATOR << "dump-" << setfill( '0' ) << setw( 5 ) << num_dump << "-aggregated-" << setfill( '0' ) << setw( 5 ) << ifile << ".h5" ;
+    string dumpName=nameDumpTmp.str();
+    
+    hid_t fid = H5Fcreate( dumpName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
+    if( fid<0 ) {
+        ERROR( "Can't open file for writing checkpoint " << dumpName.c_str() )
+    } else {
+        dump_number++;
+    }
+    
+    MESSAGE( "Step " << itime << " : DUMP fields and particles " << num_dump << " (aggregated)" );
+    
+    dumpGlobalData( fid, vecPatches, itime, smpi, simWin, params );
+    
+    // All patch images are written contiguously in a single dataset
+    uint64_t total_size = 0;
+    for( int i=0; i<aggregation_size; i++ ) {
+        total_size += member_data_size[i];
+    }
+    hsize_t dims = total_size;
+    hid_t filespace = H5Screate_simple( 1, &dims, NULL );
+    hid_t plist = H5Pcreate( H5P_DATASET_CREATE );
+    H5Pset_alloc_time( plist, H5D_ALLOC_TIME_EARLY );
+    H5Pset_fill_time( plist, H5D_FILL_TIME_NEVER );
+    hid_t did = H5Dcreate( fid, "patches", H5T_NATIVE_UCHAR, filespace, H5P_DEFAULT, plist, H5P_DEFAULT );
+    H5Pclose( plist );
+    vector<char> buffer;
+    uint64_t file_offset = 0;
+    for( int member=0; member<aggregation_size; member++ ) {
+        for( uint64_t offset=0; offset<member_data_size[member]; offset+=aggregation_message_size ) {
+            hsize_t count = min( aggregation_message_size, member_data_size[member]-offset );
+            char *message;
+            if( member == 0 ) {
+                message = &data[offset];
+            } else {
+                buffer.resize( count );
+                MPI_Recv( &buffer[0], count, MPI_BYTE, member, SMILEI_COMM_DUMP_DATA, aggregation_comm_, MPI_STATUS_IGNORE );
+                message = &buffer[0];
+            }
+            hsize_t start = file_offset + offset;
+            H5Sselect_hyperslab( filespace, H5S_SELECT_SET, &start, NULL, &count, NULL );
+            hid_t memspace = H5Screate_simple( 1, &count, NULL );
+            H5Dwrite( did, H5T_NATIVE_UCHAR, memspace, filespace, H5P_DEFAULT, message );
+            H5Sclose( memspace );
+        }
+        file_offset += member_data_size[member];
+    }
+    H5Dclose( did );
+    H5Sclose( filespace );
+    
+    dumpAggregatedTables( vecPatches, smpi, group_info, fid, ifile );
+    
+    herr_t tclose = H5Fclose( fid );
+    if( tclose < 0 ) {
+        ERROR( "Can't close file " << dumpName.c_str() )
+    }
+}
+
+// The first file holds the location of all patches (file, offset, size) and the latest Ids of all ranks
+void Checkpoint::dumpAggregatedTables( VectorPatch &vecPatches, SmileiMPI *smpi, vector<uint64_t> &group_info, hid_t fid, int ifile )
+{
+    // Each aggregator sends, for each of its patches, the hindex, the file and the offset in the file
+    if( ifile >= 0 ) {
+        unsigned int n = group_info.size()/2;
+        vector<uint64_t> table( 4*n );
+        uint64_t offset = 0;
+        for( unsigned int i=0; i<n; i++ ) {
+            table[4*i  ] = group_info[2*i];
+            table[4*i+1] = ifile;
+            table[4*i+2] = offset;
+            table[4*i+3] = group_info[2*i+1];
+            offset += group_info[2*i+1];
+        }
+        int aggregators_rank, aggregators_size, table_size = table.size();
+        MPI_Comm_rank( aggregators_comm_, &aggregators_rank );
+        MPI_Comm_size( aggregators_comm_, &aggregators_size );
+        vector<int> table_sizes( aggregators_size ), table_disp( aggregators_size, 0 );
+        MPI_Gather( &table_size, 1, MPI_INT, &table_sizes[0], 1, MPI_INT, 0, aggregators_comm_ );
+        for( int i=1; i<aggregators_size; i++ ) {
+            table_disp[i] = table_disp[i-1] + table_sizes[i-1];
+        }
+        vector<uint64_t> all_tables( aggregators_rank==0 ? table_disp.back() + table_sizes.back() : 0 );
+        MPI_Gatherv( table.data(), table_size, MPI_UNSIGNED_LONG_LONG, all_tables.data(), &table_sizes[0], &table_disp[0], MPI_UNSIGNED_LONG_LONG, 0, aggregators_comm_ );
         
+        if( aggregators_rank == 0 ) {
+            // Tables ordered by hindex
+            unsigned int npatches = all_tables.size()/4;
+            vector<unsigned int> patch_file( npatches );
+            vector<uint64_t> patch_offset( npatches ), patch_size( npatches );
+            for( unsigned int i=0; i<npatches; i++ ) {
+                uint64_t hindex = all_tables[4*i];
+                patch_file  [hindex] = all_tables[4*i+1];
+                patch_offset[hindex] = all_tables[4*i+2];
+                patch_size  [hindex] = all_tables[4*i+3];
+            }
+            H5::attr( fid, "aggregated_files", ( unsigned int ) aggregators_size );
+            H5::vect( fid, "patch_file", patch_file );
+            H5::vect( fid, "patch_offset", patch_offset, H5T_NATIVE_UINT64 );
+            H5::vect( fid, "patch_size", patch_size, H5T_NATIVE_UINT64 );
+        }
     }
     
-    // Write the latest Id that the MPI processes have given to each species
+    // The latest Id that each MPI process has given to each species
     for( unsigned int idiag=0; idiag<vecPatches.localDiags.size(); idiag++ ) {
         if( DiagnosticTrack *track = dynamic_cast<DiagnosticTrack *>( vecPatches.localDiags[idiag] ) ) {
-            ostringstream n( "" );
-            n<< "latest_ID_" << vecPatches( 0 )->vecSpecies[track->speciesId_]->name_;
-            H5::attr( fid, n.str().c_str(), track->latest_Id, H5T_NATIVE_UINT64 );
+            vector<uint64_t> latest_Id( smpi->isMaster() ? smpi->getSize() : 0 );
+            MPI_Gather( &track->latest_Id, 1, MPI_UNSIGNED_LONG_LONG, latest_Id.data(), 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD );
+            if( smpi->isMaster() ) {
+                ostringstream n( "" );
+                n<< "latest_ID_" << vecPatches( 0 )->vecSpecies[track->speciesId_]->name_;
+                H5::vect( fid, n.str(), latest_Id, H5T_NATIVE_UINT64 );
+            }
         }
     }
+}
+
+void Checkpoint::dumpPatchImage( Patch *patch, Params &params, vector<char> &image )
+{
+    // HDF5 file in memory only
+    ostringstream patch_name( "" );
+    patch_name << "patch-" << setfill( '0' ) << setw( 6 ) << patch->Hindex();
+    hid_t fapl = H5Pcreate( H5P_FILE_ACCESS );
+    H5Pset_fapl_core( fapl, 1<<20, 0 );
+    hid_t fid = H5Fcreate( patch_name.str().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, fapl );
+    H5Pclose( fapl );
     
-    // Write the moving window status
-    if( simWin!=NULL ) {
-        dumpMovingWindow( fid, simWin );
-    }
+    dumpPatch( patch->EMfields, patch->vecSpecies, patch->vecCollisions, params, fid );
+    H5::attr( fid, "xorshift32_state", patch->xorshift32_state );
     
-    herr_t tclose = H5Fclose( fid );
-    if (tclose < 0) {
-        ERROR("Can't close file " << dumpName.c_str())
+    H5Fflush( fid, H5F_SCOPE_LOCAL );
+    ssize_t size = H5Fget_file_image( fid, NULL, 0 );
+    if( size < 0 ) {
+        ERROR( "Can't get the checkpoint image of " << patch_name.str() );
+    }
+    uint64_t start = image.size();
+    image.resize( start + size );
+    H5Fget_file_image( fid, &image[start], size );
+    H5Fclose( fid );
+}
+
+void Checkpoint::restartPatchImage( Patch *patch, Params &params, char *image, uint64_t size )
+{
+    ostringstream patch_name( "" );
+    patch_name << "patch-" << setfill( '0' ) << setw( 6 ) << patch->Hindex();
+    hid_t fapl = H5Pcreate( H5P_FILE_ACCESS );
+    H5Pset_fapl_core( fapl, 1<<20, 0 );
+    H5Pset_file_image( fapl, image, size );
+    hid_t fid = H5Fopen( patch_name.str().c_str(), H5F_ACC_RDONLY, fapl );
+    H5Pclose( fapl );
+    if( fid < 0 ) {
+        ERROR( "Can't read the checkpoint image of " << patch_name.str() );
     }
     
+    restartPatch( patch->EMfields, patch->vecSpecies, patch->vecCollisions, params, fid );
+    H5::getAttr( fid, "xorshift32_state", patch->xorshift32_state );
+    
+    H5Fclose( fid );
 }
 
 void Checkpoint::dumpPatch( ElectroMagn *EMfields, std::vector<Species *> vecSpecies, std::vector<Collisions *> &vecCollisions, Params &params, hid_t patch_gid )
@@ -491,7 +1001,7 @@ void Checkpoint::dumpPatch( ElectroMagn *EMfields, std::vector<Species *> vecSpe
 
 void Checkpoint::readPatchDistribution( SmileiMPI *smpi, SimWindow *simWin )
 {
-    hid_t fid = H5Fopen( restart_file.c_str(), H5F_ACC_RDWR, H5P_DEFAULT );
+    hid_t fid = H5Fopen( restart_file.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT );
     if( fid < 0 ) {
         ERROR( restart_file << " is not a valid HDF5 file" );
     }
@@ -509,7 +1019,21 @@ void Checkpoint::readPatchDistribution( SmileiMPI *smpi, SimWindow *simWin )
     }
     
     vector<int> patch_count( smpi->getSize() );
-    H5::getVect( fid, "patch_count", patch_count );
+    if( restart_aggregated_ && H5::getVectSize( fid, "patch_count" ) != smpi->getSize() ) {
+        // Aggregated dumps may be restarted with a different number of ranks: patches are evenly distributed
+        H5::getVect( fid, "patch_count", patch_count, true );
+        int npatches = 0;
+        for( unsigned int i=0; i<patch_count.size(); i++ ) {
+            npatches += patch_count[i];
+        }
+        MESSAGE( 1, "Patches of the " << patch_count.size() << " dumped ranks are redistributed over " << smpi->getSize() << " ranks" );
+        patch_count.resize( smpi->getSize() );
+        for( int rk=0; rk<smpi->getSize(); rk++ ) {
+            patch_count[rk] = npatches / smpi->getSize() + ( rk < npatches % smpi->getSize() ? 1 : 0 );
+        }
+    } else {
+        H5::getVect( fid, "patch_count", patch_count );
+    }
     smpi->patch_count = patch_count;
     
     smpi->patch_refHindexes.resize( smpi->patch_count.size(), 0 );
@@ -529,7 +1053,7 @@ void Checkpoint::restartAll( VectorPatch &vecPatches,  SmileiMPI *smpi, SimWindo
 {
     MESSAGE( 1, "READING fields and particles for restart" );
     
-    hid_t fid = H5Fopen( restart_file.c_str(), H5F_ACC_RDWR, H5P_DEFAULT );
+    hid_t fid = H5Fopen( restart_file.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT );
     if( fid < 0 ) {
         ERROR( restart_file << " is not a valid HDF5 file" );
     }
@@ -575,6 +1099,12 @@ void Checkpoint::restartAll( VectorPatch &vecPatches,  SmileiMPI *smpi, SimWindo
         }
     }
     
+    if( restart_aggregated_ ) {
+        restartAggregated( fid, vecPatches, smpi, params );
+        H5Fclose( fid );
+        return;
+    }
+    
     // Read all the patch data
     for( unsigned int ipatch=0 ; ipatch<vecPatches.size(); ipatch++ ) {
     
@@ -610,6 +1140,99 @@ void Checkpoint::restartAll( VectorPatch &vecPatches,  SmileiMPI *smpi, SimWindo
 }
 
 
+void Checkpoint::restartAggregated( hid_t fid, VectorPatch &vecPatches, SmileiMPI *smpi, Params &params )
+{
+    // The master reads the location of all patches, and the latest Ids, then broadcasts them
+    unsigned int npatches = 0, nranks = 0;
+    vector<unsigned int> patch_file;
+    vector<uint64_t> patch_offset, patch_size;
+    vector<vector<uint64_t> > latest_Id( vecPatches.localDiags.size() );
+    if( smpi->isMaster() ) {
+        H5::getVect( fid, "patch_file", patch_file, true );
+        H5::getVect( fid, "patch_offset", patch_offset, H5T_NATIVE_UINT64, true );
+        H5::getVect( fid, "patch_size", patch_size, H5T_NATIVE_UINT64, true );
+        npatches = patch_file.size();
+        nranks = H5::getVectSize( fid, "patch_count" );
+    }
+    MPI_Bcast( &npatches, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD );
+    MPI_Bcast( &nranks, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD );
+    patch_file.resize( npatches );
+    patch_offset.resize( npatches );
+    patch_size.resize( npatches );
+    MPI_Bcast( patch_file.data(), npatches, MPI_UNSIGNED, 0, MPI_COMM_WORLD );
+    MPI_Bcast( patch_offset.data(), npatches, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD );
+    MPI_Bcast( patch_size.data(), npatches, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD );
+    
+    // Read the patches, opening each file once ("...-aggregated-00000.h5" is replaced by the file number)
+    string prefix = restart_file.substr( 0, restart_file.size()-8 );
+    int current_file = -1;
+    hid_t file_id = -1, did = -1, filespace = -1;
+    vector<char> image;
+    for( unsigned int ipatch=0 ; ipatch<vecPatches.size(); ipatch++ ) {
+        unsigned int hindex = vecPatches( ipatch )->Hindex();
+        if( hindex >= npatches ) {
+            ERROR( "Patch " << hindex << " not found in the aggregated checkpoint" );
+        }
+        if( ( int ) patch_file[hindex] != current_file ) {
+            if( current_file >= 0 ) {
+                H5Sclose( filespace );
+                H5Dclose( did );
+                H5Fclose( file_id );
+            }
+            current_file = patch_file[hindex];
+            ostringstream name( "" );
+            name << prefix << setfill( '0' ) << setw( 5 ) << current_file << ".h5";
+            file_id = H5Fopen( name.str().c_str(), H5F_ACC_RDONLY, H5P_DEFAULT );
+            if( file_id < 0 ) {
+                ERROR( name.str() << " is not a valid HDF5 file" );
+            }
+            did = H5Dopen( file_id, "patches", H5P_DEFAULT );
+            filespace = H5Dget_space( did );
+        }
+        hsize_t start = patch_offset[hindex], count = patch_size[hindex];
+        image.resize( count );
+        H5Sselect_hyperslab( filespace, H5S_SELECT_SET, &start, NULL, &count, NULL );
+        hid_t memspace = H5Screate_simple( 1, &count, NULL );
+        H5Dread( did, H5T_NATIVE_UCHAR, memspace, filespace, H5P_DEFAULT, &image[0] );
+        H5Sclose( memspace );
+        
+        restartPatchImage( vecPatches( ipatch ), params, &image[0], count );
+    }
+    if( current_file >= 0 ) {
+        H5Sclose( filespace );
+        H5Dclose( did );
+        H5Fclose( file_id );
+    }
+    
+    // Read the latest Id that the MPI processes have given to each species.
+    // Ranks that did not exist in the dump start a new range of Ids.
+    for( unsigned int idiag=0; idiag<vecPatches.localDiags.size(); idiag++ ) {
+        if( DiagnosticTrack *track = dynamic_cast<DiagnosticTrack *>( vecPatches.localDiags[idiag] ) ) {
+            ostringstream n( "" );
+            n<< "latest_ID_" << vecPatches( 0 )->vecSpecies[track->speciesId_]->name_;
+            int found = 0;
+            vector<uint64_t> latest_Id;
+            if( smpi->isMaster() && H5Lexists( fid, n.str().c_str(), H5P_DEFAULT ) > 0 ) {
+                H5::getVect( fid, n.str(), latest_Id, H5T_NATIVE_UINT64, true );
+                found = 1;
+            }
+            MPI_Bcast( &found, 1, MPI_INT, 0, MPI_COMM_WORLD );
+            if( ! found ) {
+                track->IDs_done=false;
+                continue;
+            }
+            latest_Id.resize( nranks );
+            MPI_Bcast( latest_Id.data(), nranks, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD );
+            if( ( unsigned int ) smpi->getRank() < nranks ) {
+                track->latest_Id = latest_Id[smpi->getRank()];
+            } else {
+                track->latest_Id = smpi->getRank() * 4294967296; // 2^32
+            }
+        }
+    }
+}
+
+
 void Checkpoint::restartPatch( ElectroMagn *EMfields, std::vector<Species *> &vecSpecies, std::vector<Collisions *> &vecCollisions, Params &params, hid_t patch_gid )
 {
     if ( params.geometry != "AMcylindrical" ) {
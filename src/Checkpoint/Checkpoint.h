@@ -9,6 +9,8 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
+#include <thread>
 
 #include <hdf5.h>
 #include <Tools.h>
@@ -35,7 +37,7 @@ class Checkpoint
 public:
     Checkpoint( Params &params, SmileiMPI *smpi );
     //! Destructor for Checkpoint
-    virtual ~Checkpoint() {};
+    virtual ~Checkpoint();
     
     //! Space dimension of a particle
     unsigned int nDim_particle;
@@ -61,6 +63,11 @@ public:
     void dumpAll( VectorPatch &vecPatches, unsigned int itime,  SmileiMPI *smpi, SimWindow *simWin, Params &params );
     void dumpPatch( ElectroMagn *EMfields, std::vector<Species *> vecSpecies, std::vector<Collisions *> &vecCollisions, Params &params, hid_t patch_gid );
     
+    //! dump one patch as an HDF5 file image in memory, appended to `image`
+    void dumpPatchImage( Patch *patch, Params &params, std::vector<char> &image );
+    //! restart one patch from an HDF5 file image in memory
+    void restartPatchImage( Patch *patch, Params &params, char *image, uint64_t size );
+    
     //! incremental number of times we've done a dump
     unsigned int dump_number;
     
@@ -94,6 +101,9 @@ public:
     //! Human minutes to dump everything
     double dump_minutes;
     
+    //! Timestep to dump everything in memory, with a copy in a partner rank (0 for none)
+    unsigned int memory_step;
+    
     //! exit once dump done
     bool exit_after_dump;
     
@@ -109,6 +119,18 @@ private:
     //! dump moving window parameters
     void dumpMovingWindow( hid_t fid, SimWindow *simWindow );
     
+    //! dump the data that is not specific to patches
+    void dumpGlobalData( hid_t fid, VectorPatch &vecPatches, unsigned int itime, SmileiMPI *smpi, SimWindow *simWin, Params &params );
+    
+    //! dump everything in a few files written by aggregator ranks
+    void dumpAggregated( VectorPatch &vecPatches, unsigned int itime, SmileiMPI *smpi, SimWindow *simWin, Params &params, unsigned int num_dump );
+    
+    //! dump the tables locating the patches and the latest Ids in the first aggregated file
+    void dumpAggregatedTables( VectorPatch &vecPatches, SmileiMPI *smpi, std::vector<uint64_t> &group_info, hid_t fid, int ifile );
+    
+    //! restart everything from files written by aggregator ranks
+    void restartAggregated( hid_t fid, VectorPatch &vecPatches, SmileiMPI *smpi, Params &params );
+    
     //! function that returns elapsed time from creator (uses private var time_reference)
     //double time_seconds();
     
@@ -142,6 +164,57 @@ private:
     //! restart file
     std::string restart_file;
     
+    //! Number of aggregator ranks per node (0 for one file per rank)
+    unsigned int aggregators_per_node;
+    
+    //! Ranks sending their data to the same aggregator (which has rank 0)
+    MPI_Comm aggregation_comm_;
+    
+    //! All the aggregators (MPI_COMM_NULL on other ranks)
+    MPI_Comm aggregators_comm_;
+    
+    //! Whether the restart file was written by aggregators
+    bool restart_aggregated_;
+    
+    //! Whether the dump is built in memory, then written to disk by a background thread
+    bool asynchronous_;
+    
+    //! Background thread writing the last dump, its in-memory file and a possible error
+    std::thread dump_thread_;
+    std::vector<char> dump_image_;
+    std::string dump_error_;
+    
+    //! Wait for the background write of the previous dump
+    void waitAsynchronousDump();
+    
+    //! dump the patches and the latest Ids of this rank
+    void dumpPatches( hid_t fid, VectorPatch &vecPatches, Params &params );
+    
+    //! dump everything in memory, and exchange the copies with the partner ranks
+    void dumpMemory( VectorPatch &vecPatches, unsigned int itime, SmileiMPI *smpi, SimWindow *simWin, Params &params );
+    
+    //! Distance to the rank which keeps a copy of the in-memory dump of this rank
+    int memory_partner_shift_;
+    
+    //! Two last in-memory dumps of this rank, and those of the rank memory_partner_shift_ below:
+    //! a new dump replaces the oldest one, so that the latest one remains valid while it is built
+    std::vector<char> memory_image_[2], partner_image_[2];
+    
+    //! Files where the in-memory dumps are written if the job is terminated
+    std::string memory_file_[2], partner_file_[2];
+    
+    //! Whether each pair of in-memory dumps is complete (cleared while it is built)
+    volatile sig_atomic_t memory_valid_[2];
+    
+    //! Index of the latest complete in-memory dump
+    unsigned int memory_latest_;
+    
+    //! Instance used by the SIGTERM handler
+    static Checkpoint *memory_instance_;
+    
+    //! this function catches the SIGTERM signal, writes the in-memory dumps to files, and terminates
+    static void memory_signal_handler( int signum );
+    
 };
 
 #endif /* CHECKPOINT_H_ */
@@ -4,12 +4,12 @@
 #include "H5.h"
 #include "Patch.h"
 #include "Timers.h"
+#include "TimeSelection.h"
 
 class Params;
 class OpenPMDparams;
 class SmileiMPI;
 class VectorPatch;
-class TimeSelection;
 
 class Diagnostic
 {
@@ -37,6 +37,9 @@ public :
     //! Runs the diag for all patches for local diags.
     virtual void run( SmileiMPI *smpi, VectorPatch &vecPatches, int timestep, SimWindow *simWindow, Timers &timers ) {};
     
+    //! Sums the contributions of the threads after running global diags. Called by all threads.
+    virtual void reduceThreads() {};
+    
     //! Writes out a global diag diag.
     virtual void write( int timestep, SmileiMPI *smpi ) {};
     
@@ -46,6 +49,18 @@ public :
         return false;
     };
     
+    //! Tells whether the diag accesses its HDF5 file at this timestep, so that the pending asynchronous writes must be done first
+    virtual bool writesNow( int timestep )
+    {
+        return timeSelection->isSelected( timestep );
+    };
+    
+    //! Tells whether the diag writes its file with the I/O thread, so that it only waits for its own pending writes
+    virtual bool writesAsynchronously()
+    {
+        return false;
+    };
+    
     //! Time selection for writing the diagnostic
     TimeSelection *timeSelection;
     
@@ -3,6 +3,7 @@
 
 #include "DiagnosticFields.h"
 #include "VectorPatch.h"
+#include "AsyncWriter.h"
 
 using namespace std;
 
@@ -131,10 +132,38 @@ DiagnosticFields::DiagnosticFields( Params &params, SmileiMPI *smpi, VectorPatch
         }
     }
     
+    // Write with the I/O thread
+    asynchronous_ = false;
+    PyTools::extract( "asynchronous", asynchronous_, "DiagFields", ndiag );
+    if( asynchronous_ && params.geometry == "AMcylindrical" ) {
+        WARNING( "Diagnostic Fields #"<<ndiag<<" `asynchronous` not available in AMcylindrical geometry" );
+        asynchronous_ = false;
+    }
+    // The I/O thread calls MPI while the main thread does
+    int mpi_provided;
+    MPI_Query_thread( &mpi_provided );
+    if( asynchronous_ && mpi_provided != MPI_THREAD_MULTIPLE ) {
+        WARNING( "Diagnostic Fields #"<<ndiag<<" `asynchronous` requires MPI_THREAD_MULTIPLE" );
+        asynchronous_ = false;
+    }
+    
+    // Chunks, filters and precision
+    ostringstream diag_name( "" );
+    diag_name << "Diagnostic Fields #" << ndiag;
+    compression_.extract( "DiagFields", ndiag, diag_name.str() );
+    
+    // Publish in shared memory instead of the file (the load balancing changes the size of the arrays)
+    ring_ = SharedMemoryRing::create( "DiagFields", ndiag, smpi->getRank(), diag_name.str(), ! params.has_load_balancing );
+    if( ring_ && params.geometry == "AMcylindrical" ) {
+        WARNING( "Diagnostic Fields #"<<ndiag<<" `output = \"shared_memory\"` not available in AMcylindrical geometry" );
+        delete ring_;
+        ring_ = NULL;
+    }
+    
     // Some output
     ostringstream p( "" );
     p << "(time average = " << time_average << ")";
-    MESSAGE( 1, "Diagnostic Fields #"<<ndiag<<" "<<( time_average>1?p.str():"" )<<" :" );
+    MESSAGE( 1, "Diagnostic Fields #"<<ndiag<<" "<<( time_average>1?p.str():"" )<<( asynchronous_?" (asynchronous)":"" )<<( ring_?" (shared memory)":"" )<<compression_.info()<<" :" );
     MESSAGE( 2, ss.str() );
     
     // Create new fields in each patch, for time-average storage
@@ -195,6 +224,7 @@ DiagnosticFields::~DiagnosticFields()
     
     delete timeSelection;
     delete flush_timeSelection;
+    delete ring_;
 }
 
 
@@ -245,6 +275,9 @@ void DiagnosticFields::openFile( Params &params, SmileiMPI *smpi, bool newfile )
 
 void DiagnosticFields::closeFile()
 {
+    // The I/O thread may still be writing in the file
+    AsyncWriter::wait();
+    
     if( filespace_firstwrite>0 ) {
         H5Sclose( filespace_firstwrite );
     }
@@ -318,28 +351,22 @@ void DiagnosticFields::run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime,
         return;
     }
     
+    if( ring_ ) {
+        publishFields( smpi, vecPatches, itime );
+        return;
+    }
+    
+    if( asynchronous_ ) {
+        writeAsynchronously( smpi, vecPatches, itime, simWindow );
+        return;
+    }
+    
     #pragma omp master
     {
         // Calculate the structure of the file depending on 1D, 2D, ...
         refHindex = ( unsigned int )( vecPatches.refHindex_ );
-        setFileSplitting( smpi, vecPatches );
-        
-        // Create group for this iteration
-        ostringstream name_t;
-        name_t.str( "" );
-        name_t << setfill( '0' ) << setw( 10 ) << itime;
-        status = H5Lexists( data_group_id, name_t.str().c_str(), H5P_DEFAULT );
-        if( status==0 ) {
-            iteration_group_id = H5::group( data_group_id, name_t.str().c_str() );
-        }
-        // Warning if file unreachable
-        if( status < 0 ) {
-            WARNING( "Fields diagnostics could not write" );
-        }
-        // Add openPMD attributes ( "basePath" )
-        openPMD_->writeBasePathAttributes( iteration_group_id, itime );
-        // Add openPMD attributes ( "meshesPath" )
-        openPMD_->writeMeshesAttributes( iteration_group_id );
+        setFileSplitting( smpi, vecPatches.size(), true );
+        openIteration( itime );
     }
     #pragma omp barrier
     
@@ -360,40 +387,152 @@ void DiagnosticFields::run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime,
             getField( vecPatches( ipatch ), ifield );
         }
         
+        #pragma omp master
+        writeFieldDataset( ifield, itime );
+    }
+    
+    #pragma omp master
+    closeIteration( simWindow ? simWindow->getXmoved() : 0., flush_timeSelection->theTimeIsNow( itime ) );
+}
+
+// The fields are gathered in the write buffers, then the I/O thread does all the accesses to the file,
+// so that the simulation only waits for the previous write of this diagnostic
+void DiagnosticFields::writeAsynchronously( SmileiMPI *smpi, VectorPatch &vecPatches, int itime, SimWindow *simWindow )
+{
+    unsigned int nPatches( vecPatches.size() );
+    
+    #pragma omp master
+    {
+        refHindex = ( unsigned int )( vecPatches.refHindex_ );
+        setFileSplitting( smpi, nPatches, false );
+        write_buffers_.resize( fields_indexes.size() );
+    }
+    
+    for( unsigned int ifield=0; ifield < fields_indexes.size(); ifield++ ) {
+    
+        // Copy the patch field to the buffer
+        #pragma omp barrier
+        #pragma omp for schedule(static)
+        for( unsigned int ipatch=0 ; ipatch<nPatches ; ipatch++ ) {
+            getField( vecPatches( ipatch ), ifield );
+        }
+        
+        // Keep the field until the I/O thread writes it, and gather the next one in another buffer
         #pragma omp master
         {
-            // Create field dataset in HDF5
-            hid_t dset_id  = H5Dcreate( iteration_group_id, fields_names[ifield].c_str(), H5T_NATIVE_DOUBLE, filespace, H5P_DEFAULT, dcreate, H5P_DEFAULT );
-            
-            // Write
-            writeField( dset_id, itime );
-            
-            // Attributes for openPMD
-            openPMD_->writeFieldAttributes( dset_id, subgrid_start_, subgrid_step_ );
-            openPMD_->writeRecordAttributes( dset_id, field_type[ifield] );
-            openPMD_->writeFieldRecordAttributes( dset_id );
-            openPMD_->writeComponentAttributes( dset_id, field_type[ifield] );
-            
-            // Close dataset
-            H5Dclose( dset_id );
+            write_buffers_[ifield].swap( data );
+            data.resize( write_buffers_[ifield].size() );
         }
     }
     
     #pragma omp master
     {
-        // write x_moved
         double x_moved = simWindow ? simWindow->getXmoved() : 0.;
-        H5::attr( iteration_group_id, "x_moved", x_moved );
-        
-        H5Gclose( iteration_group_id );
-        if( tmp_dset_id>0 ) {
-            H5Dclose( tmp_dset_id );
+        bool flush = flush_timeSelection->theTimeIsNow( itime );
+        AsyncWriter::submit( static_cast<Diagnostic *>( this ), [this, smpi, nPatches, itime, x_moved, flush]() {
+            setFileSplitting( smpi, nPatches, true );
+            if( ! openIteration( itime ) ) {
+                return;
+            }
+            for( unsigned int ifield=0; ifield < fields_indexes.size(); ifield++ ) {
+                data.swap( write_buffers_[ifield] );
+                writeFieldDataset( ifield, itime );
+                data.swap( write_buffers_[ifield] );
+            }
+            closeIteration( x_moved, flush );
+        } );
+    }
+}
+
+bool DiagnosticFields::openIteration( int itime )
+{
+    // Create group for this iteration
+    ostringstream name_t;
+    name_t.str( "" );
+    name_t << setfill( '0' ) << setw( 10 ) << itime;
+    status = H5Lexists( data_group_id, name_t.str().c_str(), H5P_DEFAULT );
+    if( status==0 ) {
+        iteration_group_id = H5::group( data_group_id, name_t.str().c_str() );
+    }
+    // Warning if file unreachable
+    if( status < 0 ) {
+        WARNING( "Fields diagnostics could not write" );
+    }
+    // Add openPMD attributes ( "basePath" )
+    openPMD_->writeBasePathAttributes( iteration_group_id, itime );
+    // Add openPMD attributes ( "meshesPath" )
+    openPMD_->writeMeshesAttributes( iteration_group_id );
+    
+    return status == 0;
+}
+
+void DiagnosticFields::writeFieldDataset( unsigned int ifield, int itime )
+{
+    // Create field dataset in HDF5
+    hid_t dset_id  = H5Dcreate( iteration_group_id, fields_names[ifield].c_str(), compression_.fileType(), filespace, H5P_DEFAULT, dcreate, H5P_DEFAULT );
+    
+    // Write
+    writeField( dset_id, itime );
+    
+    // Attributes for openPMD
+    openPMD_->writeFieldAttributes( dset_id, subgrid_start_, subgrid_step_ );
+    openPMD_->writeRecordAttributes( dset_id, field_type[ifield] );
+    openPMD_->writeFieldRecordAttributes( dset_id );
+    openPMD_->writeComponentAttributes( dset_id, field_type[ifield] );
+    
+    // Close dataset
+    H5Dclose( dset_id );
+}
+
+void DiagnosticFields::publishFields( SmileiMPI *smpi, VectorPatch &vecPatches, int itime )
+{
+    // The file is not accessed
+    #pragma omp master
+    {
+        refHindex = ( unsigned int )( vecPatches.refHindex_ );
+        setFileSplitting( smpi, vecPatches.size(), false );
+    }
+    
+    unsigned int nPatches( vecPatches.size() );
+    for( unsigned int ifield=0; ifield < fields_indexes.size(); ifield++ ) {
+        #pragma omp barrier
+        #pragma omp for schedule(static)
+        for( unsigned int ipatch=0 ; ipatch<nPatches ; ipatch++ ) {
+            getField( vecPatches( ipatch ), ifield );
         }
-        tmp_dset_id=0;
-        if( flush_timeSelection->theTimeIsNow( itime ) ) {
-            H5Fflush( fileId_, H5F_SCOPE_GLOBAL );
+        #pragma omp master
+        {
+            vector<uint64_t> shape, offset, global_shape;
+            getBufferLayout( shape, offset, global_shape );
+            ring_->publish( itime, fields_names[ifield], data.data(), shape, offset, global_shape );
         }
     }
+    #pragma omp master
+    ring_->endDump();
+    #pragma omp barrier
+}
+
+void DiagnosticFields::getBufferLayout( vector<uint64_t> &shape, vector<uint64_t> &offset, vector<uint64_t> &global_shape )
+{
+    // One block per patch, in the order of the Hilbert curve
+    shape = { one_patch_buffer_size > 0 ? data.size() / one_patch_buffer_size : 0, one_patch_buffer_size };
+    offset = { refHindex, 0 };
+    global_shape = { ( uint64_t )tot_number_of_patches, one_patch_buffer_size };
+}
+
+void DiagnosticFields::closeIteration( double x_moved, bool flush )
+{
+    // write x_moved
+    H5::attr( iteration_group_id, "x_moved", x_moved );
+    
+    H5Gclose( iteration_group_id );
+    if( tmp_dset_id>0 ) {
+        H5Dclose( tmp_dset_id );
+    }
+    tmp_dset_id=0;
+    if( flush ) {
+        H5Fflush( fileId_, H5F_SCOPE_GLOBAL );
+    }
 }
 
 bool DiagnosticFields::needsRhoJs( int itime )
@@ -420,7 +559,7 @@ uint64_t DiagnosticFields::getDiskFootPrint( int istart, int istop, Patch *patch
     footprint += ndumps * nfields * 1200;
     
     // Add size of each field
-    footprint += ndumps * nfields * ( uint64_t )( total_dataset_size * 8 );
+    footprint += ndumps * nfields * ( uint64_t )( ( uint64_t )total_dataset_size * 8 * compression_.estimatedRatio() );
     
     return footprint;
 }
@@ -2,6 +2,8 @@
 #define DIAGNOSTICFIELDS_H
 
 #include "Diagnostic.h"
+#include "H5Compression.h"
+#include "SharedMemoryRing.h"
 
 class DiagnosticFields  : public Diagnostic
 {
@@ -19,7 +21,8 @@ public :
     
     virtual bool prepare( int itime ) override;
     
-    virtual void setFileSplitting( SmileiMPI *smpi, VectorPatch &vecPatches ) = 0;
+    //! Resize the "data" buffer for the `npatches` patches of this process and, if `select_in_file`, select where it goes in the file
+    virtual void setFileSplitting( SmileiMPI *smpi, unsigned int npatches, bool select_in_file ) = 0;
     
     virtual void run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime, SimWindow *simWindow, Timers &timers ) override;
     
@@ -27,6 +30,17 @@ public :
     
     virtual bool needsRhoJs( int itime ) override;
     
+    //! The file is written at the last timestep of the time average, unless the fields are published in shared memory
+    bool writesNow( int itime ) override
+    {
+        return ! ring_ && itime - timeSelection->previousTime( itime ) == time_average-1;
+    };
+    
+    bool writesAsynchronously() override
+    {
+        return asynchronous_;
+    };
+    
     bool hasField( std::string field_name, std::vector<std::string> fieldsToDump );
     
     void findSubgridIntersection( unsigned int subgrid_start,
@@ -41,7 +55,12 @@ public :
     //! Get memory footprint of current diagnostic
     int getMemFootPrint() override
     {
-        return 0;
+        // The I/O thread swaps "data" with the write buffers, which does not change the total
+        size_t size = data.capacity() + data_reread.capacity() + data_rewrite.capacity();
+        for( unsigned int i=0; i<write_buffers_.size(); i++ ) {
+            size += write_buffers_[i].capacity();
+        }
+        return size*sizeof( double );
     };
     
     //! Get disk footprint of current diagnostic
@@ -101,11 +120,35 @@ protected :
     //! Dataset creation property list
     hid_t dcreate, dcreate_firstwrite;
     
+    //! Chunks, filters and precision of the field datasets
+    H5Compression compression_;
+    
     //! True if this diagnostic requires the pre-calculation of the particle J & Rho
     bool hasRhoJs;
     
     //! Save the field type (needed for OpenPMD units dimensionality)
     std::vector<unsigned int> field_type;
+    
+    //! True if the files are written by the I/O thread while the simulation goes on
+    bool asynchronous_;
+    //! Gathered fields waiting to be written by the I/O thread
+    std::vector<std::vector<double> > write_buffers_;
+    
+    //! Gather all fields and submit their output to the I/O thread
+    void writeAsynchronously( SmileiMPI *smpi, VectorPatch &vecPatches, int itime, SimWindow *simWindow );
+    //! Create the group of one iteration, returns false if it exists already or if the file is unreachable
+    bool openIteration( int itime );
+    //! Create the dataset of one field and write the current "data" buffer
+    void writeFieldDataset( unsigned int ifield, int itime );
+    //! Finish the output of one iteration
+    void closeIteration( double x_moved, bool flush );
+    
+    //! Shared-memory ring where the fields are published instead of the file (NULL for HDF5 output)
+    SharedMemoryRing *ring_;
+    //! Gather and publish all fields in the shared-memory ring
+    void publishFields( SmileiMPI *smpi, VectorPatch &vecPatches, int itime );
+    //! Shape of the "data" buffer of this process, and its position in the array of all processes
+    virtual void getBufferLayout( std::vector<uint64_t> &shape, std::vector<uint64_t> &offset, std::vector<uint64_t> &global_shape );
 };
 
 #endif
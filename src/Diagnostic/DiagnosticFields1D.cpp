@@ -33,16 +33,20 @@ DiagnosticFields1D::DiagnosticFields1D( Params &params, SmileiMPI *smpi, VectorP
     total_dataset_size = nsteps;
     filespace = H5Screate_simple( 1, &file_size, NULL );
     memspace  = H5Screate_simple( 1, &file_size, NULL );
+    
+    // Chunks and filters, starting from chunks of the patch size
+    hsize_t chunk_size = params.n_space[0] / subgrid_step_[0];
+    compression_.setDatasetCreation( dcreate, 1, &file_size, &chunk_size );
 }
 
 DiagnosticFields1D::~DiagnosticFields1D()
 {
 }
 
-void DiagnosticFields1D::setFileSplitting( SmileiMPI *smpi, VectorPatch &vecPatches )
+void DiagnosticFields1D::setFileSplitting( SmileiMPI *smpi, unsigned int npatches, bool select_in_file )
 {
     // Calculate the total size of the array in this proc
-    unsigned int total_vecPatches_size = total_patch_size * vecPatches.size();
+    unsigned int total_vecPatches_size = total_patch_size * npatches;
     // One more cell on the left
     if( smpi->isMaster() ) {
         total_vecPatches_size++;
@@ -61,9 +65,12 @@ void DiagnosticFields1D::setFileSplitting( SmileiMPI *smpi, VectorPatch &vecPatc
         istart_in_MPI, MPI_start_in_file, nsteps
     );
     
+    data.resize( nsteps );
+    if( ! select_in_file ) {
+        return;
+    }
+    
     if( nsteps > 0 ) {
-        data.resize( nsteps );
-        
         // Define offset and size for HDF5 file
         hsize_t offset[1], block[1], count[1];
         offset[0] = MPI_start_in_file;
@@ -76,7 +83,6 @@ void DiagnosticFields1D::setFileSplitting( SmileiMPI *smpi, VectorPatch &vecPatc
         offset[0] = 0;
         H5Sselect_hyperslab( memspace, H5S_SELECT_SET, offset, NULL, count, block );
     } else {
-        data.resize( 0 );
         H5Sselect_none( filespace );
         H5Sselect_none( memspace );
     }
@@ -130,7 +136,16 @@ void DiagnosticFields1D::getField( Patch *patch, unsigned int ifield )
 void DiagnosticFields1D::writeField( hid_t dset_id, int itime )
 {
 
+    compression_.truncate( &data[0], data.size() );
     H5Dwrite( dset_id, H5T_NATIVE_DOUBLE, memspace, filespace, write_plist, &( data[0] ) );
     
 }
 
+
+// Segment of the x axis held by this process
+void DiagnosticFields1D::getBufferLayout( vector<uint64_t> &shape, vector<uint64_t> &offset, vector<uint64_t> &global_shape )
+{
+    shape = { data.size() };
+    offset = { data.size() > 0 ? MPI_start_in_file : 0 };
+    global_shape = { total_dataset_size };
+}
@@ -14,12 +14,14 @@ public:
     DiagnosticFields1D( Params &params, SmileiMPI *smpi, VectorPatch &vecPatches, int, OpenPMDparams & );
     ~DiagnosticFields1D();
     
-    void setFileSplitting( SmileiMPI *smpi, VectorPatch &vecPatches ) override;
+    void setFileSplitting( SmileiMPI *smpi, unsigned int npatches, bool select_in_file ) override;
     
     //! Copy patch field to current "data" buffer
     void getField( Patch *patch, unsigned int ) override;
     
     void writeField( hid_t, int ) override;
+    
+    void getBufferLayout( std::vector<uint64_t> &shape, std::vector<uint64_t> &offset, std::vector<uint64_t> &global_shape ) override;
 private:
     unsigned int MPI_start_in_file, total_patch_size;
 };
@@ -167,6 +167,13 @@ DiagnosticFields2D::DiagnosticFields2D( Params &params, SmileiMPI *smpi, VectorP
         H5Pset_chunk( dcreate, 2, chunk_size );
     }
     
+    // Chunks and filters, starting from chunks of the patch size
+    hsize_t patch_chunk_size[2];
+    for( unsigned int i=0; i<2; i++ ) {
+        patch_chunk_size[i] = params.n_space[i] / subgrid_step_[i];
+    }
+    compression_.setDatasetCreation( dcreate, 2, final_array_size, patch_chunk_size );
+    
     tmp_dset_id=0;
 }
 
@@ -176,13 +183,16 @@ DiagnosticFields2D::~DiagnosticFields2D()
 }
 
 
-void DiagnosticFields2D::setFileSplitting( SmileiMPI *smpi, VectorPatch &vecPatches )
+void DiagnosticFields2D::setFileSplitting( SmileiMPI *smpi, unsigned int npatches, bool select_in_file )
 {
     // Calculate the total size of the array in this proc
-    unsigned int buffer_size = one_patch_buffer_size * vecPatches.size();
+    unsigned int buffer_size = one_patch_buffer_size * npatches;
     
     // Resize the data
     data.resize( buffer_size );
+    if( ! select_in_file ) {
+        return;
+    }
     
     // Define offset and size for HDF5 file
     hsize_t offset = one_patch_buffer_size * refHindex;
@@ -297,6 +307,7 @@ void DiagnosticFields2D::writeField( hid_t dset_id, int itime )
     }
     
     // Rewrite the file with the previously defined partition
+    compression_.truncate( &data_rewrite[0], data_rewrite.size() );
     H5Dwrite( dset_id, H5T_NATIVE_DOUBLE, memspace, filespace, write_plist, &( data_rewrite[0] ) );
     
 }
@@ -183,6 +183,13 @@ DiagnosticFields3D::DiagnosticFields3D( Params &params, SmileiMPI *smpi, VectorP
         H5Pset_chunk( dcreate, 3, chunk_size );
     }
     
+    // Chunks and filters, starting from chunks of the patch size
+    hsize_t patch_chunk_size[3];
+    for( unsigned int i=0; i<3; i++ ) {
+        patch_chunk_size[i] = params.n_space[i] / subgrid_step_[i];
+    }
+    compression_.setDatasetCreation( dcreate, 3, final_array_size, patch_chunk_size );
+    
     tmp_dset_id=0;
 }
 
@@ -192,13 +199,16 @@ DiagnosticFields3D::~DiagnosticFields3D()
 }
 
 
-void DiagnosticFields3D::setFileSplitting( SmileiMPI *smpi, VectorPatch &vecPatches )
+void DiagnosticFields3D::setFileSplitting( SmileiMPI *smpi, unsigned int npatches, bool select_in_file )
 {
     // Calculate the total size of the array in this proc
-    unsigned int buffer_size = one_patch_buffer_size * vecPatches.size();
+    unsigned int buffer_size = one_patch_buffer_size * npatches;
     
     // Resize the data
     data.resize( buffer_size );
+    if( ! select_in_file ) {
+        return;
+    }
     
     // Define offset and size for HDF5 file
     hsize_t offset = one_patch_buffer_size * refHindex;
@@ -318,6 +328,7 @@ void DiagnosticFields3D::writeField( hid_t dset_id, int itime )
     }
     
     // Rewrite the file with the previously defined partition
+    compression_.truncate( &data_rewrite[0], data_rewrite.size() );
     H5Dwrite( dset_id, H5T_NATIVE_DOUBLE, memspace, filespace, write_plist, &( data_rewrite[0] ) );
     
 }
@@ -140,6 +140,11 @@ DiagnosticFieldsAM::DiagnosticFieldsAM( Params &params, SmileiMPI *smpi, VectorP
     count2 [0] = 1;
     count2 [1] = 1;
     H5Sselect_hyperslab( filespace, H5S_SELECT_SET, ioffset2, NULL, count2, iblock2 );
+    // Chunks and filters, starting from chunks of the patch size
+    hsize_t patch_chunk_size[2];
+    patch_chunk_size[0] = params.n_space[0];
+    patch_chunk_size[1] = factor_ * params.n_space[1];
+    compression_.setDatasetCreation( dcreate, 2, ifinal_array_size, patch_chunk_size );
     // Define space in memory for re-writing
     memspace = H5Screate_simple( 2, iblock2, NULL );
     if (factor_==2)
@@ -155,16 +160,19 @@ DiagnosticFieldsAM::~DiagnosticFieldsAM()
 }
 
 
-void DiagnosticFieldsAM::setFileSplitting( SmileiMPI *smpi, VectorPatch &vecPatches )
+void DiagnosticFieldsAM::setFileSplitting( SmileiMPI *smpi, unsigned int npatches, bool select_in_file )
 {
     // Calculate the total size of the array in this proc
-    unsigned int total_vecPatches_size = one_patch_buffer_size * vecPatches.size();
+    unsigned int total_vecPatches_size = one_patch_buffer_size * npatches;
     
     // Resize the data
     if (factor_==2)
         idata.resize( total_vecPatches_size );
     else if (factor_==1)
         data.resize( total_vecPatches_size );
+    if( ! select_in_file ) {
+        return;
+    }
     
     // Define offset and size for HDF5 file
     hsize_t offset[1], block[1], count[1];
@@ -307,6 +315,7 @@ void DiagnosticFieldsAM::writeField( hid_t dset_id, int itime, F& linearized_dat
     }
 
     // Rewrite the file with the previously defined partition
+    compression_.truncate( reinterpret_cast<double *>( &final_data[0] ), factor_ * final_data.size() );
     H5Dwrite( dset_id, H5T_NATIVE_DOUBLE, memspace, filespace, write_plist, &( final_data[0] ) );
     
 }
@@ -14,7 +14,7 @@ public:
     DiagnosticFieldsAM( Params &params, SmileiMPI *smpi, VectorPatch &vecPatches, int, OpenPMDparams & );
     ~DiagnosticFieldsAM();
     
-    void setFileSplitting( SmileiMPI *smpi, VectorPatch &vecPatches ) override;
+    void setFileSplitting( SmileiMPI *smpi, unsigned int npatches, bool select_in_file ) override;
     
     //! Copy patch field to current "data" buffer
     void getField( Patch *patch, unsigned int ) override;
@@ -4,6 +4,10 @@
 #include "DiagnosticParticleBinning.h"
 #include "HistogramFactory.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 using namespace std;
 
@@ -94,6 +98,21 @@ DiagnosticParticleBinning::DiagnosticParticleBinning( Params &params, SmileiMPI
     }
     output_size = ( unsigned int ) total_size;
     
+    // get parameter "sparse" that stores only the non-empty bins
+    sparse_ = false;
+    PyTools::extract( "sparse", sparse_, "DiagParticleBinning", n_diag_particles );
+    sparse_output_ = "sparse";
+    PyTools::extract( "sparse_output", sparse_output_, "DiagParticleBinning", n_diag_particles );
+    if( sparse_output_ != "sparse" && sparse_output_ != "dense" ) {
+        ERROR( errorPrefix << ": `sparse_output` must be \"sparse\" or \"dense\"" );
+    }
+    
+    // The array may be published in shared memory instead of the file
+    ring_ = SharedMemoryRing::create( "DiagParticleBinning", n_diag_particles, smpi->getRank(), errorPrefix, true );
+    if( ring_ && histogram->axes.size() > 8 ) {
+        ERROR( errorPrefix << ": `output = \"shared_memory\"` supports at most 8 axes" );
+    }
+    
     // Output info on diagnostics
     if( smpi->isMaster() ) {
         ostringstream mystream( "" );
@@ -102,7 +121,9 @@ DiagnosticParticleBinning::DiagnosticParticleBinning( Params &params, SmileiMPI
         for( unsigned int i=1; i<species_names.size(); i++ ) {
             mystream << "," << species_names[i];
         }
-        MESSAGE( 1, "Created ParticleBinning diagnostic #" << n_diag_particles << ": species " << mystream.str() );
+        MESSAGE( 1, "Created ParticleBinning diagnostic #" << n_diag_particles << ": species " << mystream.str()
+                 << ( sparse_ ? " [SPARSE, output "+sparse_output_+"]" : "" )
+                 << ( ring_ ? " [SHARED MEMORY "+ring_->name_+"]" : "" ) );
         for( unsigned int i=0; i<histogram->axes.size(); i++ ) {
             HistogramAxis *axis = histogram->axes[i];
             mystream.str( "" );
@@ -129,6 +150,7 @@ DiagnosticParticleBinning::~DiagnosticParticleBinning()
 {
     delete timeSelection;
     delete flush_timeSelection;
+    delete ring_;
 } // END DiagnosticParticleBinning::~DiagnosticParticleBinning
 
 
@@ -201,6 +223,19 @@ bool DiagnosticParticleBinning::prepare( int timestep )
         return false;
     }
     
+    if( sparse_ ) {
+        // if first time, erase the non-empty bins
+        if( timestep == previousTime ) {
+            sparse_sum_.clear();
+        }
+#ifdef _OPENMP
+        thread_sparse_sums_.resize( omp_get_num_threads() );
+#else
+        thread_sparse_sums_.resize( 1 );
+#endif
+        return true;
+    }
+    
     // Allocate memory for the output array (already done if time-averaging)
     data_sum.resize( output_size );
     
@@ -209,6 +244,8 @@ bool DiagnosticParticleBinning::prepare( int timestep )
         fill( data_sum.begin(), data_sum.end(), 0. );
     }
     
+    histogram->prepareThreadSums( output_size );
+    
     return true;
     
 } // END prepare
@@ -250,13 +287,38 @@ void DiagnosticParticleBinning::run( Patch *patch, int timestep, SimWindow *simW
         
         histogram->digitize( s, double_buffer, int_buffer, simWindow );
         histogram->valuate( s, double_buffer, int_buffer );
-        histogram->distribute( double_buffer, int_buffer, data_sum );
+        if( sparse_ ) {
+#ifdef _OPENMP
+            histogram->distributeSparse( double_buffer, int_buffer, thread_sparse_sums_[omp_get_thread_num()] );
+#else
+            histogram->distributeSparse( double_buffer, int_buffer, thread_sparse_sums_[0] );
+#endif
+        } else {
+            histogram->distribute( double_buffer, int_buffer, data_sum );
+        }
         
     }
     
 } // END run
 
 
+void DiagnosticParticleBinning::reduceThreads()
+{
+    if( sparse_ ) {
+        // Merge the non-empty bins of all threads
+        #pragma omp single
+        for( unsigned int ithread=0; ithread<thread_sparse_sums_.size(); ithread++ ) {
+            for( auto &bin : thread_sparse_sums_[ithread] ) {
+                sparse_sum_[bin.first] += bin.second;
+            }
+            thread_sparse_sums_[ithread].clear();
+        }
+    } else {
+        histogram->reduceThreadSums( data_sum );
+    }
+}
+
+
 // Now the data_sum has been filled
 // if needed now, store result to hdf file
 void DiagnosticParticleBinning::write( int timestep, SmileiMPI *smpi )
@@ -269,6 +331,46 @@ void DiagnosticParticleBinning::write( int timestep, SmileiMPI *smpi )
         return;
     }
     
+    // make name of the array
+    ostringstream mystream( "" );
+    mystream.str( "" );
+    mystream << "timestep" << setw( 8 ) << setfill( '0' ) << timestep;
+    
+    // Publish the array in shared memory instead of the file
+    if( ring_ ) {
+        vector<uint64_t> dims( histogram->axes.size() );
+        for( unsigned int iaxis=0; iaxis<dims.size(); iaxis++ ) {
+            dims[iaxis] = histogram->axes[iaxis]->nbins;
+        }
+        double coeff = 1./( ( double )time_average );
+        if( sparse_ ) {
+            vector<double> dense( output_size, 0. );
+            for( auto &bin : sparse_sum_ ) {
+                dense[bin.first] = bin.second * coeff;
+            }
+            ring_->publish( timestep, "data", &dense[0], dims, {}, dims );
+        } else {
+            for( unsigned int i=0; i<output_size; i++ ) {
+                data_sum[i] *= coeff;
+            }
+            ring_->publish( timestep, "data", &data_sum[0], dims, {}, dims );
+        }
+        ring_->endDump();
+        clear();
+        return;
+    }
+    
+    if( sparse_ ) {
+        if( ! H5Lexists( fileId_, mystream.str().c_str(), H5P_DEFAULT ) ) {
+            writeSparse( mystream.str() );
+        }
+        if( flush_timeSelection->theTimeIsNow( timestep ) ) {
+            H5Fflush( fileId_, H5F_SCOPE_GLOBAL );
+        }
+        clear();
+        return;
+    }
+    
     double coeff;
     // if time_average, then we need to divide by the number of timesteps
     if( time_average > 1 ) {
@@ -278,16 +380,11 @@ void DiagnosticParticleBinning::write( int timestep, SmileiMPI *smpi )
         }
     }
     
-    // make name of the array
-    ostringstream mystream( "" );
-    mystream.str( "" );
-    mystream << "timestep" << setw( 8 ) << setfill( '0' ) << timestep;
-    
     // write the array if it does not exist already
     if( ! H5Lexists( fileId_, mystream.str().c_str(), H5P_DEFAULT ) ) {
         // Prepare array dimensions
         unsigned int naxes = histogram->axes.size();
-        hsize_t dims[naxes];
+        vector<hsize_t> dims( naxes );
         for( unsigned int iaxis=0; iaxis<naxes; iaxis++ ) {
             dims[iaxis] = histogram->axes[iaxis]->nbins;
         }
@@ -314,9 +411,63 @@ void DiagnosticParticleBinning::write( int timestep, SmileiMPI *smpi )
 } // END write
 
 
+//! Write the non-empty bins, either as a group of indices and values, or as a compressed dense array
+void DiagnosticParticleBinning::writeSparse( string name )
+{
+    double coeff = 1./( ( double )time_average );
+    
+    if( sparse_output_ == "sparse" ) {
+        // Indices in the flattened array, sorted
+        vector<unsigned int> indices;
+        indices.reserve( sparse_sum_.size() );
+        for( auto &bin : sparse_sum_ ) {
+            indices.push_back( bin.first );
+        }
+        sort( indices.begin(), indices.end() );
+        vector<double> values( indices.size() );
+        for( unsigned int i=0; i<indices.size(); i++ ) {
+            values[i] = sparse_sum_[indices[i]] * coeff;
+        }
+        hid_t gid = H5::group( fileId_, name );
+        H5::attr( gid, "sparse", 1 );
+        // An empty histogram is a group without datasets
+        if( indices.size() > 0 ) {
+            H5::vect( gid, "indices", indices );
+            H5::vect( gid, "values", values );
+        }
+        H5Gclose( gid );
+    } else {
+        // Dense array, chunked along the first axes so that empty chunks compress well
+        unsigned int naxes = histogram->axes.size();
+        vector<hsize_t> dims( naxes ), chunk( naxes );
+        hsize_t chunk_size = 1;
+        for( int iaxis=naxes-1; iaxis>=0; iaxis-- ) {
+            dims[iaxis] = histogram->axes[iaxis]->nbins;
+            chunk[iaxis] = min( dims[iaxis], max( ( hsize_t )1, ( ( hsize_t )1<<20 ) / chunk_size ) );
+            chunk_size *= chunk[iaxis];
+        }
+        vector<double> dense( output_size, 0. );
+        for( auto &bin : sparse_sum_ ) {
+            dense[bin.first] = bin.second * coeff;
+        }
+        hid_t sid = H5Screate_simple( naxes, &dims[0], NULL );
+        hid_t pid = H5Pcreate( H5P_DATASET_CREATE );
+        H5Pset_chunk( pid, naxes, &chunk[0] );
+        H5Pset_shuffle( pid );
+        H5Pset_deflate( pid, 4 );
+        hid_t did = H5Dcreate( fileId_, name.c_str(), H5T_NATIVE_DOUBLE, sid, H5P_DEFAULT, pid, H5P_DEFAULT );
+        H5Dwrite( did, H5T_NATIVE_DOUBLE, sid, sid, H5P_DEFAULT, &dense[0] );
+        H5Dclose( did );
+        H5Pclose( pid );
+        H5Sclose( sid );
+    }
+}
+
+
 //! Clear the array
 void DiagnosticParticleBinning::clear()
 {
+    sparse_sum_.clear();
     data_sum.resize( 0 );
     vector<double>().swap( data_sum );
 }
@@ -336,8 +487,13 @@ uint64_t DiagnosticParticleBinning::getDiskFootPrint( int istart, int istop, Pat
     // Add necessary timestep headers approximately
     footprint += ndumps * 640;
     
-    // Add size of each dump
-    footprint += ndumps * ( uint64_t )( output_size ) * 8;
+    // Add size of each dump. The number of non-empty bins is not known before the run, so that
+    // the sparse output is bounded by all bins being filled (4-byte index and 8-byte value each)
+    if( sparse_ && sparse_output_ == "sparse" ) {
+        footprint += ndumps * ( uint64_t )( output_size ) * 12;
+    } else {
+        footprint += ndumps * ( uint64_t )( output_size ) * 8;
+    }
     
     return footprint;
 }
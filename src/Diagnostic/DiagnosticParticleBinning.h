@@ -4,6 +4,7 @@
 #include "Diagnostic.h"
 
 #include "Histogram.h"
+#include "SharedMemoryRing.h"
 
 class DiagnosticParticleBinning : public Diagnostic
 {
@@ -26,14 +27,26 @@ public :
     
     void run( Patch *patch, int timestep, SimWindow *simWindow ) override;
     
+    void reduceThreads() override;
+    
     void write( int timestep, SmileiMPI *smpi ) override;
     
+    //! The file is written at the last timestep of the time average
+    bool writesNow( int timestep ) override
+    {
+        return timestep - timeSelection->previousTime( timestep ) == time_average-1;
+    };
+    
     //! Clear the array
     void clear();
     
     //! Get memory footprint of current diagnostic
     int getMemFootPrint() override
     {
+        if( sparse_ ) {
+            // Approximate size of a hash map node
+            return sparse_sum_.size()*( sizeof( unsigned int )+sizeof( double )+2*sizeof( void * ) );
+        }
         int size = output_size*sizeof( double );
         // + data_array + index_array +  axis_array
         // + nparts_max * (sizeof(double)+sizeof(int)+sizeof(double))
@@ -61,6 +74,24 @@ private :
     
     //! Minimum and maximum spatial coordinates that are useful for this diag
     std::vector<double> spatial_min, spatial_max;
+    
+    //! True if only the non-empty bins are stored, in sparse_sum_ instead of data_sum
+    bool sparse_;
+    
+    //! Output of the sparse mode: "sparse" (indices and values of non-empty bins) or "dense" (compressed array)
+    std::string sparse_output_;
+    
+    //! Non-empty bins of the sparse mode, for saving the output for time-averaging
+    std::unordered_map<unsigned int, double> sparse_sum_;
+    
+    //! Thread-private non-empty bins of the sparse mode
+    std::vector<std::unordered_map<unsigned int, double> > thread_sparse_sums_;
+    
+    //! Write the sparse output
+    void writeSparse( std::string name );
+    
+    //! Shared-memory ring where the array is published instead of the file (NULL for HDF5 output)
+    SharedMemoryRing *ring_;
 };
 
 #endif
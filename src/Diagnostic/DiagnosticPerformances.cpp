@@ -2,13 +2,29 @@
 #include <iomanip>
 
 #include "DiagnosticPerformances.h"
+#include "HardwareCounters.h"
+#include "Tracer.h"
 
 
 using namespace std;
 
-const unsigned int n_quantities_double = 14;
+const unsigned int n_quantities_double = 26;
 const unsigned int n_quantities_uint   = 4;
 
+// Operators timed in each species of each patch (see Species::operator_cycles_)
+const unsigned int n_operators = 7;
+const char *operator_names[n_operators] = {
+    "timer_interpolator", "timer_pusher", "timer_projector", "timer_cell_keys",
+    "timer_ionization", "timer_radiation", "timer_multiphoton_Breit_Wheeler"
+};
+
+// Timers for which the hardware counters are written
+const unsigned int n_hardware_timers = 10;
+const char *hardware_timer_names[n_hardware_timers] = {
+    "particles", "maxwell", "densities", "collisions", "movWindow",
+    "loadBal", "syncPart", "syncField", "syncDens", "diags"
+};
+
 // Constructor
 DiagnosticPerformances::DiagnosticPerformances( Params &params, SmileiMPI *smpi )
 {
@@ -37,6 +53,24 @@ DiagnosticPerformances::DiagnosticPerformances( Params &params, SmileiMPI *smpi
     // Get patch information flag
     PyTools::extract( "patch_information", patch_information, "DiagPerformances" );
     
+    // Get hardware counters flag
+    PyTools::extract( "hardware_counters", hardware_counters, "DiagPerformances" );
+    if( hardware_counters ) {
+        HardwareCounters::enable();
+    }
+    
+    // Get the window of timesteps of the timeline trace
+    vector<int> trace;
+    PyTools::extract( "trace", trace, "DiagPerformances" );
+    if( trace.size() > 0 ) {
+        if( trace.size() != 2 || trace[0] > trace[1] ) {
+            ERROR( errorPrefix << ": `trace` must be a list of two timesteps [first, last]" );
+        }
+        unsigned int trace_events = 0;
+        PyTools::extract( "trace_events", trace_events, "DiagPerformances" );
+        Tracer::init( smpi, trace[0], trace[1], trace_events );
+    }
+    
     // Output info on diagnostics
     if( smpi->isMaster() ) {
         MESSAGE( 1, "Created performances diagnostic" );
@@ -51,6 +85,7 @@ DiagnosticPerformances::DiagnosticPerformances( Params &params, SmileiMPI *smpi
     // Define the HDF5 file and memory spaces
     setHDF5spaces( filespace_double, memspace_double, n_quantities_double, mpi_size, mpi_rank_ );
     setHDF5spaces( filespace_uint, memspace_uint, n_quantities_uint, mpi_size, mpi_rank_ );
+    setHDF5spaces( filespace_hardware, memspace_hardware, n_hardware_timers * HardwareCounters::N_EVENTS, mpi_size, mpi_rank_ );
     
     // Define HDF5 file access
     write_plist = H5Pcreate( H5P_DATASET_XFER );
@@ -68,6 +103,9 @@ DiagnosticPerformances::DiagnosticPerformances( Params &params, SmileiMPI *smpi
 DiagnosticPerformances::~DiagnosticPerformances()
 {
     H5Pclose( write_plist );
+    if( hardware_counters ) {
+        HardwareCounters::close();
+    }
     delete timeSelection;
     delete flush_timeSelection;
 } // END DiagnosticPerformances::~DiagnosticPerformances
@@ -89,6 +127,13 @@ void DiagnosticPerformances::openFile( Params &params, SmileiMPI *smpi, bool new
         // write all parameters as HDF5 attributes
         H5::attr( fileId_, "MPI_SIZE", smpi->getSize() );
         H5::attr( fileId_, "patch_arrangement", params.patch_arrangement );
+        // parameters needed to replay the load balancing offline
+        H5::attr( fileId_, "number_of_patches", params.number_of_patches );
+        H5::attr( fileId_, "n_space", params.n_space );
+        H5::attr( fileId_, "oversize", params.oversize );
+        H5::attr( fileId_, "cell_load", params.cell_load );
+        H5::attr( fileId_, "frozen_particle_load", params.frozen_particle_load );
+        H5::attr( fileId_, "timestep", params.timestep );
         
         vector<string> quantities_uint( n_quantities_uint );
         quantities_uint[0] = "hindex"                    ;
@@ -112,8 +157,25 @@ void DiagnosticPerformances::openFile( Params &params, SmileiMPI *smpi, bool new
         quantities_double[11] = "timer_diags"     ;
         quantities_double[12] = "timer_total"     ;
         quantities_double[13] = "memory_total"     ;
+        quantities_double[14] = "timer_thread_imbalance";
+        for( unsigned int i = 0; i < VectorPatch::MEMORY_TOTAL; i++ ) {
+            quantities_double[15+i] = string( "memory_" ) + VectorPatch::memory_subsystems_[i];
+        }
+        for( unsigned int i = 0; i < VectorPatch::N_MEMORY_SUBSYSTEMS; i++ ) {
+            quantities_double[20+i] = string( "memory_" ) + VectorPatch::memory_subsystems_[i] + "_peak";
+        }
         H5::attr( fileId_, "quantities_double", quantities_double );
         
+        if( hardware_counters ) {
+            vector<string> quantities_hardware;
+            for( unsigned int itimer = 0; itimer < n_hardware_timers; itimer++ ) {
+                for( unsigned int ievent = 0; ievent < HardwareCounters::N_EVENTS; ievent++ ) {
+                    quantities_hardware.push_back( string( hardware_timer_names[itimer] ) + "_" + HardwareCounters::names[ievent] );
+                }
+            }
+            H5::attr( fileId_, "quantities_hardware", quantities_hardware );
+        }
+        
     } else {
         // Open the existing file
         hid_t pid = H5Pcreate( H5P_FILE_ACCESS );
@@ -138,6 +200,12 @@ void DiagnosticPerformances::closeFile()
     if( memspace_double >0 ) {
         H5Sclose( memspace_double );
     }
+    if( filespace_hardware>0 ) {
+        H5Sclose( filespace_hardware );
+    }
+    if( memspace_hardware >0 ) {
+        H5Sclose( memspace_hardware );
+    }
     if( fileId_  >0 ) {
         H5Fclose( fileId_ );
     }
@@ -253,11 +321,40 @@ void DiagnosticPerformances::run( SmileiMPI *smpi, VectorPatch &vecPatches, int
         
         quantities_double[13] = Tools::getMemFootPrint();
         
+        // Time lost by the threads waiting for the slowest one in the particle dynamics
+        quantities_double[14] = vecPatches.patch_scheduler_.imbalance_time_;
+        
+        // Memory of each subsystem, and high-water marks
+        if( vecPatches.memory_current_.size() == 0 ) {
+            vecPatches.accountMemory( smpi );
+        }
+        for( unsigned int i = 0; i < VectorPatch::MEMORY_TOTAL; i++ ) {
+            quantities_double[15+i] = vecPatches.memory_current_[i];
+        }
+        for( unsigned int i = 0; i < VectorPatch::N_MEMORY_SUBSYSTEMS; i++ ) {
+            quantities_double[20+i] = vecPatches.memory_peak_[i];
+        }
+        
         // Write doubles to file
         hid_t dset_double  = H5Dcreate( iteration_group_id, "quantities_double", H5T_NATIVE_DOUBLE, filespace_double, H5P_DEFAULT, create_plist, H5P_DEFAULT );
         H5Dwrite( dset_double, H5T_NATIVE_DOUBLE, memspace_double, filespace_double, write_plist, &quantities_double[0] );
         H5Dclose( dset_double );
         
+        // Hardware counters of the main timers, summed over the threads
+        if( hardware_counters ) {
+            Timer *hardware_timers[n_hardware_timers] = {
+                &timers.particles, &timers.maxwell, &timers.densities, &timers.collisions, &timers.movWindow,
+                &timers.loadBal, &timers.syncPart, &timers.syncField, &timers.syncDens, &timers.diags
+            };
+            vector<double> quantities_hardware;
+            for( unsigned int itimer = 0; itimer < n_hardware_timers; itimer++ ) {
+                quantities_hardware.insert( quantities_hardware.end(), hardware_timers[itimer]->counters_acc_.begin(), hardware_timers[itimer]->counters_acc_.end() );
+            }
+            hid_t dset_hardware  = H5Dcreate( iteration_group_id, "hardware_counters", H5T_NATIVE_DOUBLE, filespace_hardware, H5P_DEFAULT, create_plist, H5P_DEFAULT );
+            H5Dwrite( dset_hardware, H5T_NATIVE_DOUBLE, memspace_hardware, filespace_hardware, write_plist, &quantities_hardware[0] );
+            H5Dclose( dset_hardware );
+        }
+        
         // Patch information
         if( patch_information ) {
         
@@ -317,6 +414,37 @@ void DiagnosticPerformances::run( SmileiMPI *smpi, VectorPatch &vecPatches, int
             H5Dwrite( dset_patches, H5T_NATIVE_UINT, memspace_patches, filespace_patches, write_plist, &buffer[0] );
             H5Dclose( dset_patches );
             
+            // Gather the number of particles and frozen particles of each patch in buffers
+            vector <unsigned int> buffer_frozen( number_of_patches );
+            for( unsigned int ipatch=0; ipatch < number_of_patches; ipatch++ ) {
+                buffer[ipatch] = 0;
+                buffer_frozen[ipatch] = 0;
+                for( unsigned int ispecies = 0; ispecies < number_of_species; ispecies++ ) {
+                    if( time < vecPatches( ipatch )->vecSpecies[ispecies]->time_frozen_ ) {
+                        buffer_frozen[ipatch] += vecPatches( ipatch )->vecSpecies[ispecies]->getNbrOfParticles();
+                    } else {
+                        buffer[ipatch] += vecPatches( ipatch )->vecSpecies[ispecies]->getNbrOfParticles();
+                    }
+                }
+            }
+            // Write the number of particles to file
+            dset_patches  = H5Dcreate( patch_group, "number_of_particles", H5T_NATIVE_UINT, filespace_patches, H5P_DEFAULT, create_plist, H5P_DEFAULT );
+            H5Dwrite( dset_patches, H5T_NATIVE_UINT, memspace_patches, filespace_patches, write_plist, &buffer[0] );
+            H5Dclose( dset_patches );
+            dset_patches  = H5Dcreate( patch_group, "number_of_frozen_particles", H5T_NATIVE_UINT, filespace_patches, H5P_DEFAULT, create_plist, H5P_DEFAULT );
+            H5Dwrite( dset_patches, H5T_NATIVE_UINT, memspace_patches, filespace_patches, write_plist, &buffer_frozen[0] );
+            H5Dclose( dset_patches );
+            
+            // Gather the compute time per iteration measured in each patch (averaged over LoadBalancing.load_smoothing)
+            vector <double> buffer_time( number_of_patches );
+            for( unsigned int ipatch=0; ipatch < number_of_patches; ipatch++ ) {
+                buffer_time[ipatch] = vecPatches( ipatch )->measuredLoad();
+            }
+            // Write the compute time to file
+            dset_patches  = H5Dcreate( patch_group, "compute_time", H5T_NATIVE_DOUBLE, filespace_patches, H5P_DEFAULT, create_plist, H5P_DEFAULT );
+            H5Dwrite( dset_patches, H5T_NATIVE_DOUBLE, memspace_patches, filespace_patches, write_plist, &buffer_time[0] );
+            H5Dclose( dset_patches );
+            
             // Creation and treatment of the species groups
             hid_t species_group;
             for( unsigned int ispecies = 0; ispecies < number_of_species; ispecies++ ) {
@@ -334,6 +462,18 @@ void DiagnosticPerformances::run( SmileiMPI *smpi, VectorPatch &vecPatches, int
                     H5Dclose( dset_patches );
                 }
                 
+                // Time spent in each operator since the previous output
+                for( unsigned int iop = 0; iop < n_operators; iop++ ) {
+                    for( unsigned int ipatch=0; ipatch < number_of_patches; ipatch++ ) {
+                        uint64_t &cycles = vecPatches( ipatch )->vecSpecies[ispecies]->operator_cycles_[iop];
+                        buffer_time[ipatch] = CycleCounter::seconds( cycles );
+                        cycles = 0;
+                    }
+                    dset_patches  = H5Dcreate( species_group, operator_names[iop], H5T_NATIVE_DOUBLE, filespace_patches, H5P_DEFAULT, create_plist, H5P_DEFAULT );
+                    H5Dwrite( dset_patches, H5T_NATIVE_DOUBLE, memspace_patches, filespace_patches, write_plist, &buffer_time[0] );
+                    H5Dclose( dset_patches );
+                }
+                
                 // Close patch group
                 H5Gclose( species_group );
             }
@@ -47,6 +47,8 @@ private :
     hid_t filespace_uint, memspace_uint  ;
     //! HDF5 shapes of patch datasets
     hid_t filespace_patches, memspace_patches;
+    //! HDF5 shapes of the hardware counters datasets
+    hid_t filespace_hardware, memspace_hardware;
     
     //! Total number of patches
     unsigned int tot_number_of_patches;
@@ -72,6 +74,9 @@ private :
     //! Whether to output patch information
     bool patch_information;
     
+    //! Whether to measure and output the hardware counters of the main timers
+    bool hardware_counters;
+    
     //! Number of cells per patch
     unsigned int ncells_per_patch;
     
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <vector>
 #include <limits>
+#include <cmath>
 
 #include "DiagnosticProbes.h"
 
@@ -295,8 +296,18 @@ DiagnosticProbes::DiagnosticProbes( Params &params, SmileiMPI *smpi, VectorPatch
     mystream << "Probes" << n_probe << ".h5";
     filename = mystream.str();
 
+    // Chunks, filters and precision
+    compression_.extract( "DiagProbe", n_probe, name.str() );
+
+    // The interpolation stencils are cached for the 2nd order cartesian interpolators
+    cached_stencils_ = geometry != "AMcylindrical" && params.interpolation_order == 2;
+    cell_length_inv_.resize( nDim_field );
+    for( unsigned int k=0; k<nDim_field; k++ ) {
+        cell_length_inv_[k] = 1. / params.cell_length[k];
+    }
+
     // Display info
-    MESSAGE( 1, "Probe diagnostic #"<<n_probe<<" created" );
+    MESSAGE( 1, "Probe diagnostic #"<<n_probe<<" created"<<compression_.info() );
 
     ostringstream t( "" );
     t << vecNumber[0];
@@ -490,6 +501,7 @@ void DiagnosticProbes::createPoints( SmileiMPI *smpi, VectorPatch &vecPatches, b
         // Initialize the list of "fake" particles (points) just as actual macro-particles
         Particles *particles = &( vecPatches( ipatch )->probes[probe_n]->particles );
         particles->initialize( ntot, nDim_particle );
+        vecPatches( ipatch )->probes[probe_n]->clearStencils();
         // In AM, redefine patchmin as rmin and not -rmax anymore
         if( geometry == "AMcylindrical" ) {
             patchMin[1] = patchMax[1] - ( double )patch_size[1];
@@ -566,6 +578,97 @@ void DiagnosticProbes::createPoints( SmileiMPI *smpi, VectorPatch &vecPatches, b
 }
 
 
+// Compute the 2nd order interpolation stencils of all the points of one patch (same as the 2nd order interpolators)
+void DiagnosticProbes::computeStencils( ProbeParticles *probe, Patch *patch )
+{
+    unsigned int npart = probe->particles.size();
+    if( npart == 0 ) {
+        return;
+    }
+    for( unsigned int idim=0; idim<nDim_field; idim++ ) {
+        int domain_begin = patch->getCellStartingGlobalIndex( idim );
+        double *position = &( probe->particles.position( idim, 0 ) );
+        for( unsigned int g=0; g<2; g++ ) {
+            probe->stencil_index[idim][g].resize( npart );
+            probe->stencil_weight[idim][g].resize( 3*npart );
+            int *index = &( probe->stencil_index[idim][g][0] );
+            double *weight = &( probe->stencil_weight[idim][g][0] );
+            double shift = 0.5*g;
+            for( unsigned int ip=0; ip<npart; ip++ ) {
+                double xpn = position[ip] * cell_length_inv_[idim];
+                int i = round( xpn + shift );
+                double delta = xpn - ( double )i + shift;
+                double delta2 = delta*delta;
+                weight[ip        ] = 0.5 * ( delta2-delta+0.25 );
+                weight[ip+  npart] = 0.75 - delta2;
+                weight[ip+2*npart] = 0.5 * ( delta2+delta+0.25 );
+                index[ip] = i - domain_begin;
+            }
+        }
+    }
+}
+
+// Interpolate one field at all the points of one patch from the cached stencils
+void DiagnosticProbes::interpolateCached( ProbeParticles *probe, Field *field, double *FieldLoc )
+{
+    unsigned int npart = probe->particles.size();
+    if( npart == 0 ) {
+        return;
+    }
+    double *data = field->data_;
+
+    if( nDim_field == 1 ) {
+        const int *ix = &( probe->stencil_index[0][field->isDual( 0 )][0] );
+        const double *wx = &( probe->stencil_weight[0][field->isDual( 0 )][0] );
+        #pragma omp simd
+        for( unsigned int ip=0; ip<npart; ip++ ) {
+            const double *f = &data[ix[ip]];
+            FieldLoc[ip] = wx[ip]*f[-1] + wx[ip+npart]*f[0] + wx[ip+2*npart]*f[1];
+        }
+
+    } else if( nDim_field == 2 ) {
+        const int *ix = &( probe->stencil_index[0][field->isDual( 0 )][0] );
+        const int *iy = &( probe->stencil_index[1][field->isDual( 1 )][0] );
+        const double *wx = &( probe->stencil_weight[0][field->isDual( 0 )][0] );
+        const double *wy = &( probe->stencil_weight[1][field->isDual( 1 )][0] );
+        const int ny = field->dims_[1];
+        #pragma omp simd
+        for( unsigned int ip=0; ip<npart; ip++ ) {
+            const double *f = &data[ix[ip]*ny + iy[ip]];
+            double result = 0.;
+            for( int i=-1; i<2; i++ ) {
+                double line = wy[ip]*f[i*ny-1] + wy[ip+npart]*f[i*ny] + wy[ip+2*npart]*f[i*ny+1];
+                result += wx[ip+( i+1 )*npart] * line;
+            }
+            FieldLoc[ip] = result;
+        }
+
+    } else {
+        const int *ix = &( probe->stencil_index[0][field->isDual( 0 )][0] );
+        const int *iy = &( probe->stencil_index[1][field->isDual( 1 )][0] );
+        const int *iz = &( probe->stencil_index[2][field->isDual( 2 )][0] );
+        const double *wx = &( probe->stencil_weight[0][field->isDual( 0 )][0] );
+        const double *wy = &( probe->stencil_weight[1][field->isDual( 1 )][0] );
+        const double *wz = &( probe->stencil_weight[2][field->isDual( 2 )][0] );
+        const int nz = field->dims_[2];
+        const int nyz = field->dims_[1]*nz;
+        #pragma omp simd
+        for( unsigned int ip=0; ip<npart; ip++ ) {
+            const double *f = &data[ix[ip]*nyz + iy[ip]*nz + iz[ip]];
+            double result = 0.;
+            for( int i=-1; i<2; i++ ) {
+                for( int j=-1; j<2; j++ ) {
+                    const double *g = f + i*nyz + j*nz;
+                    double line = wz[ip]*g[-1] + wz[ip+npart]*g[0] + wz[ip+2*npart]*g[1];
+                    result += wx[ip+( i+1 )*npart] * wy[ip+( j+1 )*npart] * line;
+                }
+            }
+            FieldLoc[ip] = result;
+        }
+    }
+}
+
+
 
 void DiagnosticProbes::run( SmileiMPI *smpi, VectorPatch &vecPatches, int timestep, SimWindow *simWindow, Timers &timers )
 {
@@ -681,41 +784,67 @@ void DiagnosticProbes::run( SmileiMPI *smpi, VectorPatch &vecPatches, int timest
         ithread = omp_get_thread_num();
 #endif
 
-        // Interpolate all usual fields
-        smpi->dynamics_resize( ithread, nDim_particle, npart, false );
-        for( unsigned int ipart=0; ipart<npart; ipart++ ) {
-            int iparticle( ipart ); // Compatibility
-            int false_idx( 0 );   // Use in classical interp for now, not for probes
-            vecPatches( ipatch )->probesInterp->fieldsAndCurrents(
-                vecPatches( ipatch )->EMfields,
-                vecPatches( ipatch )->probes[probe_n]->particles, smpi,
-                &iparticle, &false_idx, ithread,
-                &Jloc_fields, &Rloc_fields
-            );
-            //! here we fill the probe data!!!
-            ( *probesArray )( fieldlocation[0], iPart_MPI )=smpi->dynamics_Epart[ithread][ipart+0*npart];
-            ( *probesArray )( fieldlocation[1], iPart_MPI )=smpi->dynamics_Epart[ithread][ipart+1*npart];
-            ( *probesArray )( fieldlocation[2], iPart_MPI )=smpi->dynamics_Epart[ithread][ipart+2*npart];
-            ( *probesArray )( fieldlocation[3], iPart_MPI )=smpi->dynamics_Bpart[ithread][ipart+0*npart];
-            ( *probesArray )( fieldlocation[4], iPart_MPI )=smpi->dynamics_Bpart[ithread][ipart+1*npart];
-            ( *probesArray )( fieldlocation[5], iPart_MPI )=smpi->dynamics_Bpart[ithread][ipart+2*npart];
-            ( *probesArray )( fieldlocation[6], iPart_MPI )=Jloc_fields.x;
-            ( *probesArray )( fieldlocation[7], iPart_MPI )=Jloc_fields.y;
-            ( *probesArray )( fieldlocation[8], iPart_MPI )=Jloc_fields.z;
-            ( *probesArray )( fieldlocation[9], iPart_MPI )=Rloc_fields;
-            iPart_MPI++;
-        }
+        if( cached_stencils_ ) {
+            // A patch without points has no column in probesArray
+            if( npart == 0 ) {
+                continue;
+            }
+            ProbeParticles *probe = vecPatches( ipatch )->probes[probe_n];
+            if( probe->stencil_index[0][0].size() != npart ) {
+                computeStencils( probe, vecPatches( ipatch ) );
+            }
+            // Interpolate the requested fields only, each in one vectorized pass
+            ElectroMagn *EMfields = vecPatches( ipatch )->EMfields;
+            Field *fields[10] = {
+                EMfields->Ex_, EMfields->Ey_, EMfields->Ez_,
+                EMfields->Bx_m, EMfields->By_m, EMfields->Bz_m,
+                EMfields->Jx_, EMfields->Jy_, EMfields->Jz_, EMfields->rho_
+            };
+            for( unsigned int ifield=0; ifield<10; ifield++ ) {
+                if( fieldlocation[ifield] < ( unsigned int ) nFields ) {
+                    interpolateCached( probe, fields[ifield], &( ( *probesArray )( fieldlocation[ifield], iPart_MPI ) ) );
+                }
+            }
+            for( unsigned int ifield=0; ifield<fieldindex.size(); ifield++ ) {
+                interpolateCached( probe, EMfields->allFields[fieldindex[ifield]], &( ( *probesArray )( fieldlocation[13+ifield], iPart_MPI ) ) );
+            }
+        } else {
+            // Interpolate all usual fields
+            smpi->dynamics_resize( ithread, nDim_particle, npart, false );
+            for( unsigned int ipart=0; ipart<npart; ipart++ ) {
+                int iparticle( ipart ); // Compatibility
+                int false_idx( 0 );   // Use in classical interp for now, not for probes
+                vecPatches( ipatch )->probesInterp->fieldsAndCurrents(
+                    vecPatches( ipatch )->EMfields,
+                    vecPatches( ipatch )->probes[probe_n]->particles, smpi,
+                    &iparticle, &false_idx, ithread,
+                    &Jloc_fields, &Rloc_fields
+                );
+                //! here we fill the probe data!!!
+                ( *probesArray )( fieldlocation[0], iPart_MPI )=smpi->dynamics_Epart[ithread][ipart+0*npart];
+                ( *probesArray )( fieldlocation[1], iPart_MPI )=smpi->dynamics_Epart[ithread][ipart+1*npart];
+                ( *probesArray )( fieldlocation[2], iPart_MPI )=smpi->dynamics_Epart[ithread][ipart+2*npart];
+                ( *probesArray )( fieldlocation[3], iPart_MPI )=smpi->dynamics_Bpart[ithread][ipart+0*npart];
+                ( *probesArray )( fieldlocation[4], iPart_MPI )=smpi->dynamics_Bpart[ithread][ipart+1*npart];
+                ( *probesArray )( fieldlocation[5], iPart_MPI )=smpi->dynamics_Bpart[ithread][ipart+2*npart];
+                ( *probesArray )( fieldlocation[6], iPart_MPI )=Jloc_fields.x;
+                ( *probesArray )( fieldlocation[7], iPart_MPI )=Jloc_fields.y;
+                ( *probesArray )( fieldlocation[8], iPart_MPI )=Jloc_fields.z;
+                ( *probesArray )( fieldlocation[9], iPart_MPI )=Rloc_fields;
+                iPart_MPI++;
+            }
 
-        // Interpolate the species-related fields
-        for( unsigned int ifield=0; ifield<fieldindex.size(); ifield++ ) {
-            int istart( 0 ), iend( npart );
-            double *FieldLoc = &( ( *probesArray )( fieldlocation[13+ifield], offset_in_MPI[ipatch] ) );
-            vecPatches( ipatch )->probesInterp->oneField(
-                vecPatches( ipatch )->EMfields->allFields[fieldindex[ifield]],
-                vecPatches( ipatch )->probes[probe_n]->particles,
-                &istart, &iend,
-                FieldLoc
-            );
+            // Interpolate the species-related fields
+            for( unsigned int ifield=0; ifield<fieldindex.size(); ifield++ ) {
+                int istart( 0 ), iend( npart );
+                double *FieldLoc = &( ( *probesArray )( fieldlocation[13+ifield], offset_in_MPI[ipatch] ) );
+                vecPatches( ipatch )->probesInterp->oneField(
+                    vecPatches( ipatch )->EMfields->allFields[fieldindex[ifield]],
+                    vecPatches( ipatch )->probes[probe_n]->particles,
+                    &istart, &iend,
+                    FieldLoc
+                );
+            }
         }
 
         // Probes for envelope
@@ -765,12 +894,16 @@ void DiagnosticProbes::run( SmileiMPI *smpi, VectorPatch &vecPatches, int timest
         // Create new dataset for this timestep
         hid_t plist_id = H5Pcreate( H5P_DATASET_CREATE );
         H5Pset_alloc_time( plist_id, H5D_ALLOC_TIME_EARLY );
-        hid_t dset_id  = H5Dcreate( fileId_, name_t.str().c_str(), H5T_NATIVE_DOUBLE, filespace, H5P_DEFAULT, plist_id, H5P_DEFAULT );
+        // Chunks contain all fields for a range of points
+        hsize_t chunk_size[2] = { dimsf[0], 1 };
+        compression_.setDatasetCreation( plist_id, 2, dimsf, chunk_size );
+        hid_t dset_id  = H5Dcreate( fileId_, name_t.str().c_str(), compression_.fileType(), filespace, H5P_DEFAULT, plist_id, H5P_DEFAULT );
         H5Pclose( plist_id );
-        // Define transfer
+        // Define transfer (filtered datasets require collective writes)
         hid_t transfer = H5Pcreate( H5P_DATASET_XFER );
-        H5Pset_dxpl_mpio( transfer, H5FD_MPIO_INDEPENDENT );
+        H5Pset_dxpl_mpio( transfer, compression_.filtered() ? H5FD_MPIO_COLLECTIVE : H5FD_MPIO_INDEPENDENT );
         // Write
+        compression_.truncate( probesArray->data_, ( uint64_t )nFields * nPart_MPI );
         H5Dwrite( dset_id, H5T_NATIVE_DOUBLE, memspace, filespace, transfer, probesArray->data_ );
 
         // Write x_moved
@@ -816,7 +949,7 @@ uint64_t DiagnosticProbes::getDiskFootPrint( int istart, int istop, Patch *patch
     footprint += ndumps * ( uint64_t )( 480 + nFields * 6 );
 
     // Add size of each field
-    footprint += ndumps * ( uint64_t )( nFields * nPart_total ) * 8;
+    footprint += ndumps * ( uint64_t )( ( uint64_t )( nFields * nPart_total ) * 8 * compression_.estimatedRatio() );
 
     return footprint;
 }
@@ -2,9 +2,11 @@
 #define DIAGNOSTICPROBES_H
 
 #include "Diagnostic.h"
+#include "H5Compression.h"
 
 #include "Field2D.h"
 
+class ProbeParticles;
 
 class DiagnosticProbes : public Diagnostic
 {
@@ -40,6 +42,8 @@ public :
                    ( nDim_particle+3+1 )*sizeof( double ) + sizeof( short )
                    // eval probesArray (even if temporary)
                    + 10*sizeof( double )
+                   // cached interpolation stencils
+                   + ( cached_stencils_ ? 2*nDim_field*( sizeof( int )+3*sizeof( double ) ) : 0 )
                );
     }
     
@@ -89,6 +93,9 @@ private :
     //! Number of fields to save
     int nFields;
     
+    //! Chunks, filters and precision of the datasets
+    H5Compression compression_;
+    
     //! List of fields to save
     std::vector<std::string> fieldname;
     
@@ -121,6 +128,18 @@ private :
     
     //! patch size
     std::vector<double> patch_size;
+    
+    //! Whether the interpolation stencils of the points are cached (2nd order, cartesian geometries)
+    bool cached_stencils_;
+    
+    //! Inverse of the cell lengths
+    std::vector<double> cell_length_inv_;
+    
+    //! Compute the interpolation stencils of the points of one patch
+    void computeStencils( ProbeParticles *probe, Patch *patch );
+    
+    //! Interpolate one field at all the points of one patch, using the cached stencils
+    void interpolateCached( ProbeParticles *probe, Field *field, double *FieldLoc );
 };
 
 
@@ -137,6 +156,22 @@ public :
     
     Particles particles;
     int offset_in_file;
+    
+    //! Cached interpolation stencils, for each dimension and each grid (0: primal, 1: dual):
+    //! index of the central node of each point, and the 3 weights (by blocks of the number of points).
+    //! They are cleared when the points are re-created.
+    std::vector<int> stencil_index[3][2];
+    std::vector<double> stencil_weight[3][2];
+    
+    void clearStencils()
+    {
+        for( unsigned int i=0; i<3; i++ ) {
+            for( unsigned int g=0; g<2; g++ ) {
+                stencil_index[i][g].clear();
+                stencil_weight[i][g].clear();
+            }
+        }
+    }
 };
 
 
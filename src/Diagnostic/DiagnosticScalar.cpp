@@ -222,6 +222,7 @@ void DiagnosticScalar::init( Params &params, SmileiMPI *smpi, VectorPatch &vecPa
     // Poynting flux
     unsigned int npoy  = EMfields->poynting[0].size() * EMfields->poynting[1].size();
     necessary_poy.resize( npoy );
+    necessary_poy_any = false;
     string poy_name;
     unsigned int k = 0;
     for( unsigned int j=0; j<2; j++ ) {
@@ -231,9 +232,15 @@ void DiagnosticScalar::init( Params &params, SmileiMPI *smpi, VectorPatch &vecPa
             //else if(i==2) poy_name = (j==0?"PoyZmin":"PoyZmax");
             poy_name = Tools::merge( "Poy", Tools::xyz[i], j==0?"min":"max" );
             necessary_poy[k] = necessary_Uelm_BC || allowedKey( poy_name ) || allowedKey( poy_name+"Inst" );
+            if( necessary_poy[k] ) {
+                necessary_poy_any = true;
+            }
             k++;
         }
     }
+    if( PyTools::nComponents( "DiagScalar" ) == 0 ) {
+        necessary_poy_any = false;
+    }
     
     // 2 - Prepare the Scalar* objects that will contain the data
     // ----------------------------------------------------------
@@ -335,8 +342,10 @@ bool DiagnosticScalar::prepare( int timestep )
 void DiagnosticScalar::run( Patch *patch, int timestep, SimWindow *simWindow )
 {
 
-    // Must keep track of Poynting flux even without diag
-    patch->EMfields->computePoynting();
+    // Must keep track of Poynting flux between the diag timesteps, unless no scalar needs it
+    if( necessary_poy_any ) {
+        patch->EMfields->computePoynting();
+    }
     
     // Compute all scalars when needed
     if( timeSelection->theTimeIsNow( timestep ) && timestep>latest_timestep ) {
@@ -432,23 +441,32 @@ void DiagnosticScalar::compute( Patch *patch, int timestep )
             
             unsigned int nPart=vecSpecies[ispec]->getNbrOfParticles(); // number of particles
             
-            if( vecSpecies[ispec]->mass_ > 0 ) {
-            
+            if( vecSpecies[ispec]->scalars_ready_ ) {
+                // Sums already accumulated during the particle push
+                density  = vecSpecies[ispec]->scalars_density_;
+                charge   = vecSpecies[ispec]->scalars_charge_;
+                ener_tot = vecSpecies[ispec]->scalars_energy_;
+                if( vecSpecies[ispec]->mass_ > 0 ) {
+                    ener_tot *= vecSpecies[ispec]->mass_;
+                }
+            } else if( vecSpecies[ispec]->mass_ > 0 ) {
+                const double *gamma = vecSpecies[ispec]->diagLorentzFactors();
                 for( unsigned int iPart=0 ; iPart<nPart; iPart++ ) {
                 
                     density  += vecSpecies[ispec]->particles->weight( iPart );
                     charge   += vecSpecies[ispec]->particles->weight( iPart )
                                 * ( double )vecSpecies[ispec]->particles->charge( iPart );
                     ener_tot += vecSpecies[ispec]->particles->weight( iPart )
-                                * ( vecSpecies[ispec]->particles->LorentzFactor( iPart )-1.0 );
+                                * ( gamma[iPart]-1.0 );
                 }
                 ener_tot *= vecSpecies[ispec]->mass_;
             } else if( vecSpecies[ispec]->mass_ == 0 ) {
+                const double *gamma = vecSpecies[ispec]->diagLorentzFactors();
                 for( unsigned int iPart=0 ; iPart<nPart; iPart++ ) {
                 
                     density  += vecSpecies[ispec]->particles->weight( iPart );
                     ener_tot += vecSpecies[ispec]->particles->weight( iPart )
-                                * ( vecSpecies[ispec]->particles->momentumNorm( iPart ) );
+                                * gamma[iPart];
                 }
             }
             
@@ -125,6 +125,18 @@ public :
     
     virtual bool needsRhoJs( int timestep ) override;
     
+    //! The scalars are written in a text file
+    bool writesNow( int timestep ) override
+    {
+        return false;
+    };
+    
+    //! Whether the species sums are computed at this timestep (they may be accumulated during the particle push)
+    bool needsSpeciesSums( int timestep )
+    {
+        return timeSelection->theTimeIsNow( timestep ) && timestep>latest_timestep;
+    }
+    
     //! get a particular scalar
     double getScalar( std::string name );
     
@@ -222,6 +234,8 @@ private :
     bool necessary_UmBWpairs;
     bool necessary_fieldMinMax_any;
     std::vector<bool> necessary_species, necessary_fieldUelm, necessary_fieldMinMax, necessary_poy;
+    // Whether any scalar requires the Poynting flux through the boundaries
+    bool necessary_poy_any;
 };
 
 #endif
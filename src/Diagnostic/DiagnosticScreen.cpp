@@ -182,6 +182,7 @@ DiagnosticScreen::DiagnosticScreen( Params &params, SmileiMPI *smpi, Patch *patc
     }
     output_size = ( unsigned int ) total_size;
     data_sum.resize( output_size, 0. );
+    output_now_ = false;
     
     // Output info on diagnostics
     if( smpi->isMaster() ) {
@@ -283,6 +284,8 @@ bool DiagnosticScreen::prepare( int timestep )
 {
 
     // This diag always runs, but the output is not done at every timestep
+    histogram->prepareThreadSums( output_size );
+    output_now_ = timeSelection->isSelected( timestep );
     return true;
     
 } // END prepare
@@ -328,12 +331,15 @@ void DiagnosticScreen::run( Patch *patch, int timestep, SimWindow *simWindow )
         double_buffer.resize( npart );
         opposite     .resize( npart, false );
         
+        // Lorentz factors shared with the other diagnostics (photons keep the previous expression)
+        const double *gamma = s->mass_ > 0 ? s->diagLorentzFactors() : NULL;
+        
         // Fill the int_buffer with -1 (not crossing screen) and 0 (crossing screen)
         if( screen_type == 0 ) { // plane
             for( ipart=0; ipart<npart; ipart++ ) {
                 side = 0.;
                 side_old = 0.;
-                dtg = dt * pow( 1. + pow( s->particles->Momentum[0][ipart], 2 )
+                dtg = gamma ? dt / gamma[ipart] : dt * pow( 1. + pow( s->particles->Momentum[0][ipart], 2 )
                                 + pow( s->particles->Momentum[1][ipart], 2 )
                                 + pow( s->particles->Momentum[2][ipart], 2 )
                                 , -0.5 );
@@ -355,7 +361,7 @@ void DiagnosticScreen::run( Patch *patch, int timestep, SimWindow *simWindow )
             for( ipart=0; ipart<npart; ipart++ ) {
                 side = 0.;
                 side_old = 0.;
-                dtg = dt * pow( 1. + pow( s->particles->Momentum[0][ipart], 2 )
+                dtg = gamma ? dt / gamma[ipart] : dt * pow( 1. + pow( s->particles->Momentum[0][ipart], 2 )
                                 + pow( s->particles->Momentum[1][ipart], 2 )
                                 + pow( s->particles->Momentum[2][ipart], 2 )
                                 , -0.5 );
@@ -408,6 +414,19 @@ void DiagnosticScreen::run( Patch *patch, int timestep, SimWindow *simWindow )
 } // END run
 
 
+void DiagnosticScreen::reduceThreads()
+{
+    if( output_now_ ) {
+        histogram->reduceThreadSums( data_sum );
+    }
+}
+
+void DiagnosticScreen::gatherThreads()
+{
+    histogram->gatherThreadSums( data_sum );
+}
+
+
 // if needed now, store result to hdf file
 void DiagnosticScreen::write( int timestep, SmileiMPI *smpi )
 {
@@ -30,11 +30,16 @@ public :
     
     void run( Patch *patch, int timestep, SimWindow *simWindow ) override;
     
+    void reduceThreads() override;
+    
     void write( int timestep, SmileiMPI *smpi ) override;
     
     //! Clear the array
     void clear();
     
+    //! Add the contributions still held by the threads to the array (called by one thread)
+    void gatherThreads();
+    
     //! Get memory footprint of current diagnostic
     int getMemFootPrint() override
     {
@@ -63,6 +68,9 @@ private :
     
     unsigned int output_size;
     
+    //! Whether the array is output at the current timestep (the threads keep their contributions until then)
+    bool output_now_;
+    
     std::string screen_shape;
     //! Relates to the shape of the screen (plane=0, sphere=1)
     int screen_type;
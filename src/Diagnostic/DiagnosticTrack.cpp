@@ -14,7 +14,8 @@ using namespace std;
 DiagnosticTrack::DiagnosticTrack( Params &params, SmileiMPI *smpi, VectorPatch &vecPatches, unsigned int iDiagTrackParticles, unsigned int idiag, OpenPMDparams &oPMD ) :
     Diagnostic( oPMD ),
     IDs_done( params.restart ),
-    nDim_particle( params.nDim_particle )
+    nDim_particle( params.nDim_particle ),
+    filter_expression_( NULL )
 {
 
     // Extract the species
@@ -50,10 +51,22 @@ DiagnosticTrack::DiagnosticTrack( Params &params, SmileiMPI *smpi, VectorPatch &
         vecPatches( ipatch )->vecSpecies[speciesId_]->tracking_diagnostic = idiag;
     }
     
-    // Get parameter "filter" which gives a python function to select particles
+    // Get parameter "filter" which gives a python function, or an expression, to select particles
     filter = PyTools::extract_py( "filter", "DiagTrackParticles", iDiagTrackParticles );
     has_filter = ( filter != Py_None );
-    if( has_filter ) {
+    string filter_string;
+    if( has_filter && PyTools::convert( filter, filter_string ) ) {
+        // The expression is compiled, and evaluated without python
+        // Quantities that do not exist for this species are removed
+        vector<string> variables = {"x", "y", "z", "px", "py", "pz", "weight", "charge", "chi", "id"};
+        for( unsigned int i=nDim_particle; i<3; i++ ) {
+            variables[i] = "";
+        }
+        if( ! vecPatches( 0 )->vecSpecies[speciesId_]->particles->isQuantumParameter ) {
+            variables[8] = "";
+        }
+        filter_expression_ = new Expression( filter_string, variables, {"iteration"}, name.str() + " filter" );
+    } else if( has_filter ) {
 #ifdef SMILEI_USE_NUMPY
         PyTools::setIteration( 0 );
         // Test the filter with temporary, "fake" particles
@@ -146,9 +159,17 @@ DiagnosticTrack::DiagnosticTrack( Params &params, SmileiMPI *smpi, VectorPatch &
     hdf_filename << "TrackParticlesDisordered_" << species_name  << ".h5" ;
     filename = hdf_filename.str();
     
+    // Chunks, filters and precision
+    ostringstream diag_name( "" );
+    diag_name << "DiagTrackParticles #" << iDiagTrackParticles;
+    compression_.extract( "DiagTrackParticles", iDiagTrackParticles, diag_name.str() );
+    
+    // Publish in shared memory instead of the file (the number of particles changes between outputs)
+    ring_ = SharedMemoryRing::create( "DiagTrackParticles", iDiagTrackParticles, smpi->getRank(), diag_name.str(), false );
+    
     // Print some info
     if( smpi->isMaster() ) {
-        MESSAGE( 1, "Created TrackParticles #" << iDiagTrackParticles << ": species " << species_name );
+        MESSAGE( 1, "Created TrackParticles #" << iDiagTrackParticles << ": species " << species_name << compression_.info() << ( ring_ ? " (shared memory)" : "" ) );
         MESSAGE( 2, attr_list.str() );
     }
     
@@ -167,6 +188,8 @@ DiagnosticTrack::~DiagnosticTrack()
     delete flush_timeSelection;
     H5Pclose( transfer );
     Py_DECREF( filter );
+    delete filter_expression_;
+    delete ring_;
 }
 
 
@@ -240,13 +263,37 @@ void DiagnosticTrack::run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime,
     
     hid_t momentum_group=0, position_group=0, iteration_group=0, particles_group=0, species_group=0;
     hid_t plist=0, file_space=0, mem_space=0;
+    
+    // A compiled filter is evaluated in parallel over patches
+    if( filter_expression_ ) {
+        #pragma omp single
+        patch_selection.resize( vecPatches.size() );
+        #pragma omp for schedule(runtime)
+        for( unsigned int ipatch=0 ; ipatch<vecPatches.size() ; ipatch++ ) {
+            selectParticles( vecPatches( ipatch )->vecSpecies[speciesId_]->particles, itime, patch_selection[ipatch] );
+        }
+    }
+    
     #pragma omp master
     {
         // Obtain the particle partition of all the patches in this MPI
         nParticles_local = 0;
         patch_start.resize( vecPatches.size() );
         
-        if( has_filter ) {
+        if( filter_expression_ ) {
+            for( unsigned int ipatch=0 ; ipatch<vecPatches.size() ; ipatch++ ) {
+                // If particle not tracked before (ID==0), then set its ID
+                Particles *p = vecPatches( ipatch )->vecSpecies[speciesId_]->particles;
+                for( unsigned int i=0; i<patch_selection[ipatch].size(); i++ ) {
+                    if( p->id( patch_selection[ipatch][i] ) == 0 ) {
+                        p->id( patch_selection[ipatch][i] ) = ++latest_Id;
+                    }
+                }
+                patch_start[ipatch] = nParticles_local;
+                nParticles_local += patch_selection[ipatch].size();
+            }
+            
+        } else if( has_filter ) {
         
 #ifdef SMILEI_USE_NUMPY
             // Set a python variable "Main.iteration" to itime so that it can be accessed in the filter
@@ -295,93 +342,102 @@ void DiagnosticTrack::run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime,
             }
         }
         
-        // Specify the memory dataspace (the size of the local buffer)
-        hsize_t count_ = nParticles_local;
-        mem_space = H5Screate_simple( 1, &count_, NULL );
-        
         // Get the number of offset for this MPI rank
         uint64_t np_local = nParticles_local, offset;
         MPI_Scan( &np_local, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD );
         nParticles_global = offset;
         offset -= np_local;
         MPI_Bcast( &nParticles_global, 1, MPI_UNSIGNED_LONG_LONG, smpi->getSize()-1, MPI_COMM_WORLD );
+        timestep_ = itime;
+        particles_offset_ = offset;
         
-        // Make a new group for this iteration
-        ostringstream t( "" );
-        t << setfill( '0' ) << setw( 10 ) << itime;
-        iteration_group = H5::group( data_group_id, t.str().c_str() );
-        particles_group = H5::group( iteration_group, "particles" );
-        species_group = H5::group( particles_group, vecPatches( 0 )->vecSpecies[speciesId_]->name_.c_str() );
-        
-        // Add openPMD attributes ( "basePath" )
-        openPMD_->writeBasePathAttributes( iteration_group, itime );
-        // Add openPMD attributes ( "particles" )
-        openPMD_->writeParticlesAttributes( particles_group );
-        // Add openPMD attributes ( path of a given species )
-        openPMD_->writeSpeciesAttributes( species_group );
-        
-        // Write x_moved
-        H5::attr( iteration_group, "x_moved", simWindow ? simWindow->getXmoved() : 0. );
-        
-        // Set the dataset parameters
-        plist = H5Pcreate( H5P_DATASET_CREATE );
-        H5Pset_alloc_time( plist, H5D_ALLOC_TIME_EARLY ); // necessary for collective dump
-        
-        if( nParticles_global>0 ) {
-            // Set the chunk size
-            unsigned int maximum_chunk_size = 100000000;
-            unsigned int number_of_chunks = nParticles_global/maximum_chunk_size;
-            if( nParticles_global%maximum_chunk_size != 0 ) {
-                number_of_chunks++;
-            }
-            if( number_of_chunks==0 ) {
-                number_of_chunks = 1;
-            }
-            unsigned int chunk_size = nParticles_global/number_of_chunks;
-            if( nParticles_global%number_of_chunks != 0 ) {
-                chunk_size++;
+        // Without HDF5 output, the arrays are only published in shared memory
+        if( ! ring_ ) {
+            
+            // Specify the memory dataspace (the size of the local buffer)
+            hsize_t count_ = nParticles_local;
+            mem_space = H5Screate_simple( 1, &count_, NULL );
+            
+            // Make a new group for this iteration
+            ostringstream t( "" );
+            t << setfill( '0' ) << setw( 10 ) << itime;
+            iteration_group = H5::group( data_group_id, t.str().c_str() );
+            particles_group = H5::group( iteration_group, "particles" );
+            species_group = H5::group( particles_group, vecPatches( 0 )->vecSpecies[speciesId_]->name_.c_str() );
+            
+            // Add openPMD attributes ( "basePath" )
+            openPMD_->writeBasePathAttributes( iteration_group, itime );
+            // Add openPMD attributes ( "particles" )
+            openPMD_->writeParticlesAttributes( particles_group );
+            // Add openPMD attributes ( path of a given species )
+            openPMD_->writeSpeciesAttributes( species_group );
+            
+            // Write x_moved
+            H5::attr( iteration_group, "x_moved", simWindow ? simWindow->getXmoved() : 0. );
+            
+            // Set the dataset parameters
+            plist = H5Pcreate( H5P_DATASET_CREATE );
+            H5Pset_alloc_time( plist, H5D_ALLOC_TIME_EARLY ); // necessary for collective dump
+            
+            if( nParticles_global>0 ) {
+                // Set the chunk size
+                unsigned int maximum_chunk_size = 100000000;
+                unsigned int number_of_chunks = nParticles_global/maximum_chunk_size;
+                if( nParticles_global%maximum_chunk_size != 0 ) {
+                    number_of_chunks++;
+                }
+                if( number_of_chunks==0 ) {
+                    number_of_chunks = 1;
+                }
+                unsigned int chunk_size = nParticles_global/number_of_chunks;
+                if( nParticles_global%number_of_chunks != 0 ) {
+                    chunk_size++;
+                }
+                hsize_t chunk_dims = chunk_size;
+                if( number_of_chunks > 1 ) {
+                    H5Pset_layout( plist, H5D_CHUNKED );
+                    H5Pset_chunk( plist, 1, &chunk_dims );
+                }
             }
-            hsize_t chunk_dims = chunk_size;
-            if( number_of_chunks > 1 ) {
-                H5Pset_layout( plist, H5D_CHUNKED );
-                H5Pset_chunk( plist, 1, &chunk_dims );
+            
+            // Define maximum size
+            hsize_t dims = nParticles_global;
+            file_space = H5Screate_simple( 1, &dims, NULL );
+            
+            // Chunks and filters
+            compression_.setDatasetCreation( plist, 1, &dims );
+            
+            // Select locations that this proc will write
+            if( nParticles_local>0 ) {
+                hsize_t start=offset, count=1, block=nParticles_local;
+                H5Sselect_hyperslab( file_space, H5S_SELECT_SET, &start, NULL, &count, &block );
+            } else {
+                H5Sselect_none( file_space );
             }
+            
+            // Create the "latest_IDs" dataset
+            // Create file space and select one element for each proc
+            hsize_t numel = smpi->getSize();
+            hid_t filespace = H5Screate_simple( 1, &numel, NULL );
+            hsize_t offset_ = smpi->getRank(), count=1;
+            H5Sselect_hyperslab( filespace, H5S_SELECT_SET, &offset_, NULL, &count, NULL );
+            // Create dataset
+            hid_t plist_id = H5Pcreate( H5P_DATASET_CREATE );
+            hid_t dset_id  = H5Dcreate( iteration_group, "latest_IDs", H5T_NATIVE_UINT64, filespace, H5P_DEFAULT, plist_id, H5P_DEFAULT );
+            // Create memory space
+            hsize_t size_in_memory = 1;
+            hid_t memspace  = H5Screate_simple( 1, &size_in_memory, NULL );
+            // Parallel write
+            hid_t write_plist = H5Pcreate( H5P_DATASET_XFER );
+            H5Pset_dxpl_mpio( write_plist, H5FD_MPIO_COLLECTIVE );
+            H5Dwrite( dset_id, H5T_NATIVE_UINT64, memspace, filespace, write_plist, &latest_Id );
+            // Close all
+            H5Pclose( write_plist );
+            H5Pclose( plist_id );
+            H5Dclose( dset_id );
+            H5Sclose( filespace );
+            H5Sclose( memspace );
         }
-        
-        // Define maximum size
-        hsize_t dims = nParticles_global;
-        file_space = H5Screate_simple( 1, &dims, NULL );
-        
-        // Select locations that this proc will write
-        if( nParticles_local>0 ) {
-            hsize_t start=offset, count=1, block=nParticles_local;
-            H5Sselect_hyperslab( file_space, H5S_SELECT_SET, &start, NULL, &count, &block );
-        } else {
-            H5Sselect_none( file_space );
-        }
-        
-        // Create the "latest_IDs" dataset
-        // Create file space and select one element for each proc
-        hsize_t numel = smpi->getSize();
-        hid_t filespace = H5Screate_simple( 1, &numel, NULL );
-        hsize_t offset_ = smpi->getRank(), count=1;
-        H5Sselect_hyperslab( filespace, H5S_SELECT_SET, &offset_, NULL, &count, NULL );
-        // Create dataset
-        hid_t plist_id = H5Pcreate( H5P_DATASET_CREATE );
-        hid_t dset_id  = H5Dcreate( iteration_group, "latest_IDs", H5T_NATIVE_UINT64, filespace, H5P_DEFAULT, plist_id, H5P_DEFAULT );
-        // Create memory space
-        hsize_t size_in_memory = 1;
-        hid_t memspace  = H5Screate_simple( 1, &size_in_memory, NULL );
-        // Parallel write
-        hid_t write_plist = H5Pcreate( H5P_DATASET_XFER );
-        H5Pset_dxpl_mpio( write_plist, H5FD_MPIO_COLLECTIVE );
-        H5Dwrite( dset_id, H5T_NATIVE_UINT64, memspace, filespace, write_plist, &latest_Id );
-        // Close all
-        H5Pclose( write_plist );
-        H5Pclose( plist_id );
-        H5Dclose( dset_id );
-        H5Sclose( filespace );
-        H5Sclose( memspace );
     }
     
     // Id
@@ -422,7 +478,7 @@ void DiagnosticTrack::run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime,
     // Momentum
     if( write_any_momentum ) {
         #pragma omp master
-        {
+        if( ! ring_ ) {
             momentum_group = H5::group( species_group, "momentum" );
             openPMD_->writeRecordAttributes( momentum_group, SMILEI_UNIT_MOMENTUM );
         }
@@ -439,18 +495,20 @@ void DiagnosticTrack::run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime,
                             data_double[ip] *= vecPatches( 0 )->vecSpecies[speciesId_]->mass_;
                         }
                     }
-                    write_component( momentum_group, xyz.substr( idim, 1 ).c_str(), data_double[0], H5T_NATIVE_DOUBLE, file_space, mem_space, plist, SMILEI_UNIT_MOMENTUM, nParticles_global );
+                    write_component( species_group, "momentum/" + xyz.substr( idim, 1 ), data_double[0], H5T_NATIVE_DOUBLE, file_space, mem_space, plist, SMILEI_UNIT_MOMENTUM, nParticles_global );
                 }
             }
         }
         #pragma omp master
-        H5Gclose( momentum_group );
+        if( ! ring_ ) {
+            H5Gclose( momentum_group );
+        }
     }
     
     // Position
     if( write_any_position ) {
         #pragma omp master
-        {
+        if( ! ring_ ) {
             position_group = H5::group( species_group, "position" );
             openPMD_->writeRecordAttributes( position_group, SMILEI_UNIT_POSITION );
         }
@@ -459,11 +517,13 @@ void DiagnosticTrack::run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime,
                 #pragma omp barrier
                 fill_buffer( vecPatches, idim, data_double );
                 #pragma omp master
-                write_component( position_group, xyz.substr( idim, 1 ).c_str(), data_double[0], H5T_NATIVE_DOUBLE, file_space, mem_space, plist, SMILEI_UNIT_POSITION, nParticles_global );
+                write_component( species_group, "position/" + xyz.substr( idim, 1 ), data_double[0], H5T_NATIVE_DOUBLE, file_space, mem_space, plist, SMILEI_UNIT_POSITION, nParticles_global );
             }
         }
         #pragma omp master
-        H5Gclose( position_group );
+        if( ! ring_ ) {
+            H5Gclose( position_group );
+        }
     }
     
     // Chi - quantum parameter
@@ -522,25 +582,35 @@ void DiagnosticTrack::run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime,
         #pragma omp master
         {
             if( write_any_E ) {
-                hid_t Efield_group = H5::group( species_group, "E" );
-                openPMD_->writeRecordAttributes( Efield_group, SMILEI_UNIT_EFIELD );
+                hid_t Efield_group = 0;
+                if( ! ring_ ) {
+                    Efield_group = H5::group( species_group, "E" );
+                    openPMD_->writeRecordAttributes( Efield_group, SMILEI_UNIT_EFIELD );
+                }
                 for( unsigned int idim=0; idim<3; idim++ ) {
                     if( write_E[idim] ) {
-                        write_component( Efield_group, xyz.substr( idim, 1 ).c_str(), data_double[idim*nParticles_local], H5T_NATIVE_DOUBLE, file_space, mem_space, plist, SMILEI_UNIT_EFIELD, nParticles_global );
+                        write_component( species_group, "E/" + xyz.substr( idim, 1 ), data_double[idim*nParticles_local], H5T_NATIVE_DOUBLE, file_space, mem_space, plist, SMILEI_UNIT_EFIELD, nParticles_global );
                     }
                 }
-                H5Gclose( Efield_group );
+                if( ! ring_ ) {
+                    H5Gclose( Efield_group );
+                }
             }
             
             if( write_any_B ) {
-                hid_t Bfield_group = H5::group( species_group, "B" );
-                openPMD_->writeRecordAttributes( Bfield_group, SMILEI_UNIT_BFIELD );
+                hid_t Bfield_group = 0;
+                if( ! ring_ ) {
+                    Bfield_group = H5::group( species_group, "B" );
+                    openPMD_->writeRecordAttributes( Bfield_group, SMILEI_UNIT_BFIELD );
+                }
                 for( unsigned int idim=0; idim<3; idim++ ) {
                     if( write_B[idim] ) {
-                        write_component( Bfield_group, xyz.substr( idim, 1 ).c_str(), data_double[( 3+idim )*nParticles_local], H5T_NATIVE_DOUBLE, file_space, mem_space, plist, SMILEI_UNIT_BFIELD, nParticles_global );
+                        write_component( species_group, "B/" + xyz.substr( idim, 1 ), data_double[( 3+idim )*nParticles_local], H5T_NATIVE_DOUBLE, file_space, mem_space, plist, SMILEI_UNIT_BFIELD, nParticles_global );
                     }
                 }
-                H5Gclose( Bfield_group );
+                if( ! ring_ ) {
+                    H5Gclose( Bfield_group );
+                }
             }
         }
     } // END if interpolate
@@ -548,38 +618,83 @@ void DiagnosticTrack::run( SmileiMPI *smpi, VectorPatch &vecPatches, int itime,
     #pragma omp master
     {
         data_double.resize( 0 );
-        
-        // PositionOffset (for OpenPMD)
-        hid_t positionoffset_group = H5::group( species_group, "positionOffset" );
-        openPMD_->writeRecordAttributes( positionoffset_group, SMILEI_UNIT_POSITION );
-        vector<uint64_t> np = {nParticles_global};
-        for( unsigned int idim=0; idim<nDim_particle; idim++ ) {
-            hid_t xyz_group = H5::group( positionoffset_group, xyz.substr( idim, 1 ) );
-            openPMD_->writeComponentAttributes( xyz_group, SMILEI_UNIT_POSITION );
-            H5::attr( xyz_group, "value", 0. );
-            H5::attr( xyz_group, "shape", np, H5T_NATIVE_UINT64 );
-            H5Gclose( xyz_group );
-        }
-        H5Gclose( positionoffset_group );
-        
-        // Close and flush
         patch_selection.resize( 0 );
         
-        H5Pclose( plist );
-        H5Sclose( file_space );
-        H5Sclose( mem_space );
-        H5Gclose( species_group );
-        H5Gclose( particles_group );
-        H5Gclose( iteration_group );
-        
-        if( flush_timeSelection->theTimeIsNow( itime ) ) {
-            H5Fflush( fileId_, H5F_SCOPE_GLOBAL );
+        if( ring_ ) {
+            ring_->endDump();
+        } else {
+            // PositionOffset (for OpenPMD)
+            hid_t positionoffset_group = H5::group( species_group, "positionOffset" );
+            openPMD_->writeRecordAttributes( positionoffset_group, SMILEI_UNIT_POSITION );
+            vector<uint64_t> np = {nParticles_global};
+            for( unsigned int idim=0; idim<nDim_particle; idim++ ) {
+                hid_t xyz_group = H5::group( positionoffset_group, xyz.substr( idim, 1 ) );
+                openPMD_->writeComponentAttributes( xyz_group, SMILEI_UNIT_POSITION );
+                H5::attr( xyz_group, "value", 0. );
+                H5::attr( xyz_group, "shape", np, H5T_NATIVE_UINT64 );
+                H5Gclose( xyz_group );
+            }
+            H5Gclose( positionoffset_group );
+            
+            // Close and flush
+            H5Pclose( plist );
+            H5Sclose( file_space );
+            H5Sclose( mem_space );
+            H5Gclose( species_group );
+            H5Gclose( particles_group );
+            H5Gclose( iteration_group );
+            
+            if( flush_timeSelection->theTimeIsNow( itime ) ) {
+                H5Fflush( fileId_, H5F_SCOPE_GLOBAL );
+            }
         }
     }
     #pragma omp barrier
 }
 
 
+// Evaluate the compiled filter on the particles of one patch, and store the indices of the selected ones
+void DiagnosticTrack::selectParticles( Particles *p, int itime, vector<unsigned int> &selection )
+{
+    selection.resize( 0 );
+    unsigned int npart = p->size();
+    if( npart == 0 ) {
+        return;
+    }
+    
+    // Variables in the same order as given to the Expression constructor
+    const double *arrays[10] = {NULL};
+    for( unsigned int i=0; i<nDim_particle; i++ ) {
+        arrays[i] = &( p->Position[i][0] );
+    }
+    for( unsigned int i=0; i<3; i++ ) {
+        arrays[3+i] = &( p->Momentum[i][0] );
+    }
+    arrays[6] = &( p->Weight[0] );
+    // Integer quantities are converted only when used
+    vector<double> charge, id;
+    if( filter_expression_->usesArray( 7 ) ) {
+        charge.assign( p->Charge.begin(), p->Charge.begin()+npart );
+        arrays[7] = &charge[0];
+    }
+    if( p->isQuantumParameter ) {
+        arrays[8] = &( p->Chi[0] );
+    }
+    if( filter_expression_->usesArray( 9 ) ) {
+        id.assign( p->Id.begin(), p->Id.begin()+npart );
+        arrays[9] = &id[0];
+    }
+    double iteration = itime;
+    
+    vector<double> result( npart );
+    filter_expression_->evaluate( npart, arrays, &iteration, &result[0] );
+    for( unsigned int i=0; i<npart; i++ ) {
+        if( result[i] != 0. ) {
+            selection.push_back( i );
+        }
+    }
+}
+
 void DiagnosticTrack::setIDs( Patch *patch )
 {
     // If filter, IDs are set on-the-fly
@@ -649,8 +764,15 @@ void DiagnosticTrack::fill_buffer( VectorPatch &vecPatches, unsigned int iprop,
 template<typename T>
 void DiagnosticTrack::write_scalar( hid_t location, string name, T &buffer, hid_t dtype, hid_t file_space, hid_t mem_space, hid_t plist, unsigned int unit_type, unsigned int npart_global )
 {
-    hid_t did = H5Dcreate( location, name.c_str(), dtype, file_space, H5P_DEFAULT, plist, H5P_DEFAULT );
+    if( ring_ ) {
+        ring_->publish( timestep_, name, &buffer, {nParticles_local}, {particles_offset_}, {npart_global} );
+        return;
+    }
+    // Floating-point data may be stored with a lower precision
+    hid_t file_dtype = ( dtype == H5T_NATIVE_DOUBLE ) ? compression_.fileType() : dtype;
+    hid_t did = H5Dcreate( location, name.c_str(), file_dtype, file_space, H5P_DEFAULT, plist, H5P_DEFAULT );
     if( npart_global>0 ) {
+        compression_.truncate( &buffer, nParticles_local );
         H5Dwrite( did, dtype, mem_space, file_space, transfer, &buffer );
     }
     openPMD_->writeRecordAttributes( did, unit_type );
@@ -661,8 +783,15 @@ void DiagnosticTrack::write_scalar( hid_t location, string name, T &buffer, hid_
 template<typename T>
 void DiagnosticTrack::write_component( hid_t location, string name, T &buffer, hid_t dtype, hid_t file_space, hid_t mem_space, hid_t plist, unsigned int unit_type, unsigned int npart_global )
 {
-    hid_t did = H5Dcreate( location, name.c_str(), dtype, file_space, H5P_DEFAULT, plist, H5P_DEFAULT );
+    if( ring_ ) {
+        ring_->publish( timestep_, name, &buffer, {nParticles_local}, {particles_offset_}, {npart_global} );
+        return;
+    }
+    // Floating-point data may be stored with a lower precision
+    hid_t file_dtype = ( dtype == H5T_NATIVE_DOUBLE ) ? compression_.fileType() : dtype;
+    hid_t did = H5Dcreate( location, name.c_str(), file_dtype, file_space, H5P_DEFAULT, plist, H5P_DEFAULT );
     if( npart_global>0 ) {
+        compression_.truncate( &buffer, nParticles_local );
         H5Dwrite( did, dtype, mem_space, file_space, transfer, &buffer );
     }
     openPMD_->writeComponentAttributes( did, unit_type );
@@ -689,7 +818,7 @@ uint64_t DiagnosticTrack::getDiskFootPrint( int istart, int istop, Patch *patch
     footprint += ndumps * 11250;
     
     // Add size of each parameter
-    footprint += ndumps * ( uint64_t )( nparams * npart_total * 8 );
+    footprint += ndumps * ( uint64_t )( nparams * npart_total * 8 * compression_.estimatedRatio() );
     
     return footprint;
 }
@@ -2,6 +2,9 @@
 #define DIAGNOSTICTRACK_H
 
 #include "Diagnostic.h"
+#include "H5Compression.h"
+#include "Expression.h"
+#include "SharedMemoryRing.h"
 
 class Patch;
 class Params;
@@ -30,7 +33,13 @@ public :
     //! Get memory footprint of current diagnostic
     int getMemFootPrint() override
     {
-        return 0;
+        size_t size = data_double.capacity()*sizeof( double )
+                      + data_short.capacity()*sizeof( short )
+                      + data_uint64.capacity()*sizeof( uint64_t );
+        for( unsigned int i=0; i<patch_selection.size(); i++ ) {
+            size += patch_selection[i].capacity()*sizeof( unsigned int );
+        }
+        return size;
     }
     
     //! Get disk footprint of current diagnostic
@@ -65,6 +74,9 @@ private :
     //! HDF5 objects
     hid_t data_group_id, transfer;
     
+    //! Chunks, filters and precision of the datasets
+    H5Compression compression_;
+    
     //! Number of spatial dimensions
     unsigned int nDim_particle;
     
@@ -77,6 +89,12 @@ private :
     //! Tells whether this diag includes a particle filter
     PyObject *filter;
     
+    //! Compiled filter, when the filter is given as a string (NULL otherwise)
+    Expression *filter_expression_;
+    
+    //! Select the particles of one patch with the compiled filter
+    void selectParticles( Particles *p, int itime, std::vector<unsigned int> &selection );
+    
     //! Selection of the filtered particles in each patch
     std::vector<std::vector<unsigned int> > patch_selection;
     
@@ -107,6 +125,12 @@ private :
     bool write_any_E;
     bool write_any_B;
     
+    //! Shared-memory ring where the arrays are published instead of the file (NULL for HDF5 output)
+    SharedMemoryRing *ring_;
+    //! Timestep being written, and position of the particles of this process in the arrays of all processes
+    int timestep_;
+    uint64_t particles_offset_;
+    
 };
 
 #endif
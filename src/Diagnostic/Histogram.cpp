@@ -3,6 +3,9 @@
 #include "Patch.h"
 #include "ParticleData.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -92,6 +95,24 @@ void Histogram::distribute(
     unsigned int ipart, npart=double_buffer.size();
     int ind;
     
+    // Sum the data into the thread copy of the output, without contention
+    // ---------------------------------------------------------------
+    if( ! thread_sums_.empty() ) {
+#ifdef _OPENMP
+        double *thread_sum = &thread_sums_[omp_get_thread_num()][0];
+#else
+        double *thread_sum = &thread_sums_[0][0];
+#endif
+        for( ipart = 0 ; ipart < npart ; ipart++ ) {
+            ind = int_buffer[ipart];
+            if( ind<0 ) {
+                continue;    // skip discarded particles
+            }
+            thread_sum[ind] += double_buffer[ipart];
+        }
+        return;
+    }
+    
     // Sum the data into the data_sum according to the indexes
     // ---------------------------------------------------------------
     for( ipart = 0 ; ipart < npart ; ipart++ ) {
@@ -105,6 +126,80 @@ void Histogram::distribute(
     
 }
 
+void Histogram::distributeSparse(
+    std::vector<double> &double_buffer,
+    std::vector<int>    &int_buffer,
+    std::unordered_map<unsigned int, double> &output_map )
+{
+    unsigned int ipart, npart=double_buffer.size();
+    int ind;
+    
+    for( ipart = 0 ; ipart < npart ; ipart++ ) {
+        ind = int_buffer[ipart];
+        if( ind<0 ) {
+            continue;    // skip discarded particles
+        }
+        output_map[ind] += double_buffer[ipart];
+    }
+}
+
+void Histogram::prepareThreadSums( unsigned int output_size )
+{
+    // Called inside the parallel region: one copy per thread of the team
+#ifdef _OPENMP
+    unsigned int nthreads = omp_get_num_threads();
+#else
+    unsigned int nthreads = 1;
+#endif
+    
+    // Large outputs are summed with atomic operations, as copies would be too costly to zero and reduce
+    if( nthreads < 2 || ( uint64_t )nthreads * output_size > max_thread_sums_size ) {
+        thread_sums_.clear();
+        return;
+    }
+    
+    // The copies are zeroed when they are reduced, so they are only allocated here
+    if( thread_sums_.size() != nthreads || thread_sums_[0].size() != output_size ) {
+        thread_sums_.assign( nthreads, vector<double>( output_size, 0. ) );
+    }
+}
+
+void Histogram::reduceThreadSums( std::vector<double> &output_array )
+{
+    if( thread_sums_.empty() ) {
+        return;
+    }
+    
+    // Each thread sums and zeroes the copies of all threads for a range of bins
+    unsigned int output_size = output_array.size();
+    #pragma omp for schedule(static)
+    for( unsigned int i=0; i<output_size; i++ ) {
+        output_array[i] += takeThreadSums( i );
+    }
+}
+
+void Histogram::gatherThreadSums( std::vector<double> &output_array )
+{
+    if( thread_sums_.empty() ) {
+        return;
+    }
+    
+    unsigned int output_size = output_array.size();
+    for( unsigned int i=0; i<output_size; i++ ) {
+        output_array[i] += takeThreadSums( i );
+    }
+}
+
+double Histogram::takeThreadSums( unsigned int i )
+{
+    double sum = 0.;
+    for( unsigned int ithread=0; ithread<thread_sums_.size(); ithread++ ) {
+        sum += thread_sums_[ithread][i];
+        thread_sums_[ithread][i] = 0.;
+    }
+    return sum;
+}
+
 
 
 void HistogramAxis::init( string type_, double min_, double max_, int nbins_, bool logscale_, bool edge_inclusive_, vector<double> coefficients_ )
@@ -7,6 +7,7 @@
 #include "Patch.h"
 #include "SimWindow.h"
 #include <algorithm>
+#include <unordered_map>
 
 // Class for each axis of the particle diags
 class HistogramAxis
@@ -57,9 +58,29 @@ public:
     //! Add the contribution of each particle in the histogram
     void distribute( std::vector<double> &, std::vector<int> &, std::vector<double> & );
     
+    //! Add the contribution of each particle in a sparse histogram (only non-empty bins are stored)
+    void distributeSparse( std::vector<double> &, std::vector<int> &, std::unordered_map<unsigned int, double> & );
+    
+    //! Allocate one copy of the output per thread if it is small enough (otherwise, atomic operations are used)
+    void prepareThreadSums( unsigned int output_size );
+    //! Add the thread copies to the output array and zero them (called by all threads)
+    void reduceThreadSums( std::vector<double> & );
+    //! Same as reduceThreadSums, called by one thread
+    void gatherThreadSums( std::vector<double> & );
+    
     std::string deposited_quantity;
     
     std::vector<HistogramAxis *> axes;
+    
+    //! Maximum total size of the thread copies of the output (number of doubles)
+    static const uint64_t max_thread_sums_size = 1<<22;
+    
+private:
+    //! Thread-private copies of the output, empty when atomic operations are used
+    std::vector<std::vector<double> > thread_sums_;
+    
+    //! Sum of the thread copies for the bin `i`, which are zeroed
+    double takeThreadSums( unsigned int i );
 };
 
 
@@ -274,13 +295,12 @@ class HistogramAxis_p : public HistogramAxis
         }
         // Photons
         else if( s->mass_ == 0 ) {
+            const double *gamma = s->diagLorentzFactors();
             for( unsigned int ipart = 0 ; ipart < npart ; ipart++ ) {
                 if( index[ipart]<0 ) {
                     continue;
                 }
-                array[ipart] = sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                     + pow( s->particles->Momentum[1][ipart], 2 )
-                                     + pow( s->particles->Momentum[2][ipart], 2 ) );
+                array[ipart] = gamma[ipart];
             }
         }
     };
@@ -289,15 +309,14 @@ class HistogramAxis_gamma : public HistogramAxis
 {
     void digitize( Species *s, std::vector<double> &array, std::vector<int> &index, unsigned int npart, SimWindow *simWindow )
     {
+        const double *gamma = s->diagLorentzFactors();
         // Matter Particles
         if( s->mass_ > 0 ) {
             for( unsigned int ipart = 0 ; ipart < npart ; ipart++ ) {
                 if( index[ipart]<0 ) {
                     continue;
                 }
-                array[ipart] = sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                     + pow( s->particles->Momentum[1][ipart], 2 )
-                                     + pow( s->particles->Momentum[2][ipart], 2 ) );
+                array[ipart] = gamma[ipart];
             }
         }
         // Photons
@@ -306,9 +325,7 @@ class HistogramAxis_gamma : public HistogramAxis
                 if( index[ipart]<0 ) {
                     continue;
                 }
-                array[ipart] = sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                     + pow( s->particles->Momentum[1][ipart], 2 )
-                                     + pow( s->particles->Momentum[2][ipart], 2 ) );
+                array[ipart] = gamma[ipart];
             }
         }
     };
@@ -317,15 +334,14 @@ class HistogramAxis_ekin : public HistogramAxis
 {
     void digitize( Species *s, std::vector<double> &array, std::vector<int> &index, unsigned int npart, SimWindow *simWindow )
     {
+        const double *gamma = s->diagLorentzFactors();
         // Matter Particles
         if( s->mass_ > 0 ) {
             for( unsigned int ipart = 0 ; ipart < npart ; ipart++ ) {
                 if( index[ipart]<0 ) {
                     continue;
                 }
-                array[ipart] = s->mass_ * ( sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                                 + pow( s->particles->Momentum[1][ipart], 2 )
-                                                 + pow( s->particles->Momentum[2][ipart], 2 ) ) - 1. );
+                array[ipart] = s->mass_ * ( gamma[ipart] - 1. );
             }
         }
         // Photons
@@ -334,9 +350,7 @@ class HistogramAxis_ekin : public HistogramAxis
                 if( index[ipart]<0 ) {
                     continue;
                 }
-                array[ipart] = sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                     + pow( s->particles->Momentum[1][ipart], 2 )
-                                     + pow( s->particles->Momentum[2][ipart], 2 ) );
+                array[ipart] = gamma[ipart];
             }
         }
     };
@@ -345,6 +359,7 @@ class HistogramAxis_vx : public HistogramAxis
 {
     void digitize( Species *s, std::vector<double> &array, std::vector<int> &index, unsigned int npart, SimWindow *simWindow )
     {
+        const double *gamma = s->diagLorentzFactors();
         // Matter Particles
         if( s->mass_ > 0 ) {
             for( unsigned int ipart = 0 ; ipart < npart ; ipart++ ) {
@@ -352,9 +367,7 @@ class HistogramAxis_vx : public HistogramAxis
                     continue;
                 }
                 array[ipart] = s->particles->Momentum[0][ipart]
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -364,9 +377,7 @@ class HistogramAxis_vx : public HistogramAxis
                     continue;
                 }
                 array[ipart] = s->particles->Momentum[0][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -375,6 +386,7 @@ class HistogramAxis_vy : public HistogramAxis
 {
     void digitize( Species *s, std::vector<double> &array, std::vector<int> &index, unsigned int npart, SimWindow *simWindow )
     {
+        const double *gamma = s->diagLorentzFactors();
         // Matter Particles
         if( s->mass_ > 0 ) {
             for( unsigned int ipart = 0 ; ipart < npart ; ipart++ ) {
@@ -382,9 +394,7 @@ class HistogramAxis_vy : public HistogramAxis
                     continue;
                 }
                 array[ipart] = s->particles->Momentum[1][ipart]
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -394,9 +404,7 @@ class HistogramAxis_vy : public HistogramAxis
                     continue;
                 }
                 array[ipart] = s->particles->Momentum[1][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -405,6 +413,7 @@ class HistogramAxis_vz : public HistogramAxis
 {
     void digitize( Species *s, std::vector<double> &array, std::vector<int> &index, unsigned int npart, SimWindow *simWindow )
     {
+        const double *gamma = s->diagLorentzFactors();
         // Matter Particles
         if( s->mass_ > 0 ) {
             for( unsigned int ipart = 0 ; ipart < npart ; ipart++ ) {
@@ -412,9 +421,7 @@ class HistogramAxis_vz : public HistogramAxis
                     continue;
                 }
                 array[ipart] = s->particles->Momentum[2][ipart]
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -424,9 +431,7 @@ class HistogramAxis_vz : public HistogramAxis
                     continue;
                 }
                 array[ipart] = s->particles->Momentum[2][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -575,6 +580,7 @@ class Histogram_jx : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -584,9 +590,7 @@ class Histogram_jx : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart] * ( double )( s->particles->Charge[ipart] )
                                * s->particles->Momentum[0][ipart]
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -597,9 +601,7 @@ class Histogram_jx : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart]
                                * s->particles->Momentum[0][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -608,6 +610,7 @@ class Histogram_jy : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -617,9 +620,7 @@ class Histogram_jy : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart] * ( double )( s->particles->Charge[ipart] )
                                * s->particles->Momentum[1][ipart]
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -630,9 +631,7 @@ class Histogram_jy : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart]
                                * s->particles->Momentum[1][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -641,6 +640,7 @@ class Histogram_jz : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -650,9 +650,7 @@ class Histogram_jz : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart] * ( double )( s->particles->Charge[ipart] )
                                * s->particles->Momentum[2][ipart]
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -663,9 +661,7 @@ class Histogram_jz : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart]
                                * s->particles->Momentum[2][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -674,6 +670,7 @@ class Histogram_ekin : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -682,9 +679,7 @@ class Histogram_ekin : public Histogram
                     continue;
                 }
                 array[ipart] = s->mass_ * s->particles->Weight[ipart]
-                               * ( sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                         + pow( s->particles->Momentum[1][ipart], 2 )
-                                         + pow( s->particles->Momentum[2][ipart], 2 ) ) - 1. );
+                               * ( gamma[ipart] - 1. );
             }
         }
         // Photons
@@ -694,9 +689,7 @@ class Histogram_ekin : public Histogram
                     continue;
                 }
                 array[ipart] = s->particles->Weight[ipart]
-                               * ( sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                         + pow( s->particles->Momentum[1][ipart], 2 )
-                                         + pow( s->particles->Momentum[2][ipart], 2 ) ) );
+                               * ( gamma[ipart] );
             }
         }
     };
@@ -747,14 +740,13 @@ class Histogram_p : public Histogram
         }
         // Photons
         else if( s->mass_ == 0 ) {
+            const double *gamma = s->diagLorentzFactors();
             for( unsigned int ipart = 0 ; ipart < npart ; ipart++ ) {
                 if( index[ipart]<0 ) {
                     continue;
                 }
                 array[ipart] = s->particles->Weight[ipart]
-                               * sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               * gamma[ipart];
             }
         }
     };
@@ -838,6 +830,7 @@ class Histogram_pressure_xx : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -847,9 +840,7 @@ class Histogram_pressure_xx : public Histogram
                 }
                 array[ipart] = s->mass_ * s->particles->Weight[ipart]
                                * pow( s->particles->Momentum[0][ipart], 2 )
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -860,9 +851,7 @@ class Histogram_pressure_xx : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart]
                                * pow( s->particles->Momentum[0][ipart], 2 )
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -871,6 +860,7 @@ class Histogram_pressure_yy : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -880,9 +870,7 @@ class Histogram_pressure_yy : public Histogram
                 }
                 array[ipart] = s->mass_ * s->particles->Weight[ipart]
                                * pow( s->particles->Momentum[1][ipart], 2 )
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -893,9 +881,7 @@ class Histogram_pressure_yy : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart]
                                * pow( s->particles->Momentum[1][ipart], 2 )
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -904,6 +890,7 @@ class Histogram_pressure_zz : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -913,9 +900,7 @@ class Histogram_pressure_zz : public Histogram
                 }
                 array[ipart] = s->mass_ * s->particles->Weight[ipart]
                                * pow( s->particles->Momentum[2][ipart], 2 )
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -926,9 +911,7 @@ class Histogram_pressure_zz : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart]
                                * pow( s->particles->Momentum[2][ipart], 2 )
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -937,6 +920,7 @@ class Histogram_pressure_xy : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -947,9 +931,7 @@ class Histogram_pressure_xy : public Histogram
                 array[ipart] = s->mass_ * s->particles->Weight[ipart]
                                * s->particles->Momentum[0][ipart]
                                * s->particles->Momentum[1][ipart]
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -961,9 +943,7 @@ class Histogram_pressure_xy : public Histogram
                 array[ipart] = s->particles->Weight[ipart]
                                * s->particles->Momentum[0][ipart]
                                * s->particles->Momentum[1][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -972,6 +952,7 @@ class Histogram_pressure_xz : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -982,9 +963,7 @@ class Histogram_pressure_xz : public Histogram
                 array[ipart] = s->mass_ * s->particles->Weight[ipart]
                                * s->particles->Momentum[0][ipart]
                                * s->particles->Momentum[2][ipart]
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -996,9 +975,7 @@ class Histogram_pressure_xz : public Histogram
                 array[ipart] = s->particles->Weight[ipart]
                                * s->particles->Momentum[0][ipart]
                                * s->particles->Momentum[2][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -1007,6 +984,7 @@ class Histogram_pressure_yz : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -1017,9 +995,7 @@ class Histogram_pressure_yz : public Histogram
                 array[ipart] = s->mass_ * s->particles->Weight[ipart]
                                * s->particles->Momentum[1][ipart]
                                * s->particles->Momentum[2][ipart]
-                               / sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
         // Photons
@@ -1031,9 +1007,7 @@ class Histogram_pressure_yz : public Histogram
                 array[ipart] = s->particles->Weight[ipart]
                                * s->particles->Momentum[1][ipart]
                                * s->particles->Momentum[2][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -1042,6 +1016,7 @@ class Histogram_ekin_vx : public Histogram
 {
     void valuate( Species *s, std::vector<double> &array, std::vector<int> &index )
     {
+        const double *gamma = s->diagLorentzFactors();
         unsigned int npart = array.size();
         // Matter Particles
         if( s->mass_ > 0 ) {
@@ -1051,9 +1026,7 @@ class Histogram_ekin_vx : public Histogram
                 }
                 array[ipart] = s->mass_ * s->particles->Weight[ipart]
                                * s->particles->Momentum[0][ipart]
-                               * ( 1. - 1./sqrt( 1. + pow( s->particles->Momentum[0][ipart], 2 )
-                                                 + pow( s->particles->Momentum[1][ipart], 2 )
-                                                 + pow( s->particles->Momentum[2][ipart], 2 ) ) );
+                               * ( 1. - 1./gamma[ipart] );
             }
         }
         // Photons
@@ -1064,9 +1037,7 @@ class Histogram_ekin_vx : public Histogram
                 }
                 array[ipart] = s->particles->Weight[ipart]
                                * s->particles->Momentum[0][ipart]
-                               / sqrt( pow( s->particles->Momentum[0][ipart], 2 )
-                                       + pow( s->particles->Momentum[1][ipart], 2 )
-                                       + pow( s->particles->Momentum[2][ipart], 2 ) );
+                               / gamma[ipart];
             }
         }
     };
@@ -181,7 +181,12 @@ TimeSelection::TimeSelection( TimeSelection *timeSelection )
 // Tell whether the current timestep is within the selection
 bool TimeSelection::theTimeIsNow( int timestep )
 {
-    TheTimeIsNow = false;
+    TheTimeIsNow = isSelected( timestep );
+    return TheTimeIsNow;
+}
+
+bool TimeSelection::isSelected( int timestep ) const
+{
     // In selection if inside the start/end bounds
     if( timestep>=round( start ) && timestep<=round( end ) ) {
         // Calculate the number of timesteps since the start
@@ -194,10 +199,10 @@ bool TimeSelection::theTimeIsNow( int timestep )
         }
         // The time is now if closest repeat it within 0.5
         if( t < 1. ) {
-            TheTimeIsNow = true;
+            return true;
         }
     }
-    return TheTimeIsNow;
+    return false;
 }
 
 
@@ -36,6 +36,8 @@ public:
     
     //! Tell whether the current timestep is within the selection
     bool theTimeIsNow( int timestep );
+    //! Same as theTimeIsNow(int timestep), without storing the answer (may be called by several threads)
+    bool isSelected( int timestep ) const;
     //! Get the last answer of theTimeIsNow(int timestep)
     inline bool theTimeIsNow()
     {
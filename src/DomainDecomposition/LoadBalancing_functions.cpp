@@ -0,0 +1,86 @@
+#include "LoadBalancing_functions.h"
+
+#include <cmath>
+#include <climits>
+
+using namespace std;
+
+//Functions shared by the dynamic load balancing (SmileiMPI::recompute_patch_count) and the offline balancing tool.
+
+//Move the boundary between two ranks one patch at a time as long as it brings Tcur closer to the target.
+//Both ranks sharing a boundary call this function with the same arguments so that they agree on the result.
+int balanceBoundary( const vector<double> &left, const vector<double> &right, double Tcur, double target,
+                     unsigned int max_moved, bool &incomplete, double &moved_load )
+{
+    int shift = 0;
+    unsigned int j, nmoved = 0;
+    moved_load = 0.;
+    
+    if( Tcur > target ) {
+        //The left rank gives its last patches to the right rank.
+        j = left.size()-1;
+        while( abs( Tcur-target ) > abs( Tcur-left[j]-target ) && j>0 ) { //Leave at least 1 patch to the left rank.
+            Tcur -= left[j];
+            if( nmoved++ < max_moved ) {
+                moved_load += left[j];
+                shift++;
+            } else {
+                incomplete = true;
+            }
+            j--;
+        }
+    } else {
+        //The right rank gives its first patches to the left rank.
+        j = 0;
+        while( abs( Tcur-target ) > abs( Tcur+right[j]-target ) && j<right.size()-1 ) { //Leave at least 1 patch to the right rank.
+            Tcur += right[j];
+            if( nmoved++ < max_moved ) {
+                moved_load -= right[j];
+                shift--;
+            } else {
+                incomplete = true;
+            }
+            j++;
+        }
+    }
+    
+    return shift;
+}
+
+//Apply balanceBoundary to all boundaries, each computed from the current distribution as done by the MPI ranks.
+bool balancePatchCount( const vector<double> &loads, vector<int> &patch_count, unsigned int max_moved )
+{
+    unsigned int nranks = patch_count.size();
+    if( max_moved == 0 ) {
+        max_moved = UINT_MAX;
+    }
+    
+    //Loads of the patches of each rank, and total load
+    vector<vector<double> > Lp( nranks );
+    double Tload = 0.;
+    unsigned int hindex = 0;
+    for( unsigned int rk=0; rk<nranks; rk++ ) {
+        Lp[rk].assign( loads.begin()+hindex, loads.begin()+hindex+patch_count[rk] );
+        hindex += patch_count[rk];
+    }
+    for( unsigned int i=0; i<loads.size(); i++ ) {
+        Tload += loads[i];
+    }
+    Tload /= nranks;
+    
+    //Move each boundary
+    bool incomplete = false;
+    double Tcur = 0., moved_load;
+    vector<int> new_count( patch_count );
+    for( unsigned int rk=1; rk<nranks; rk++ ) {
+        for( unsigned int i=0; i<Lp[rk-1].size(); i++ ) {
+            Tcur += Lp[rk-1][i];
+        }
+        int shift = balanceBoundary( Lp[rk-1], Lp[rk], Tcur, rk*Tload, max_moved, incomplete, moved_load );
+        new_count[rk-1] -= shift;
+        new_count[rk  ] += shift;
+    }
+    patch_count = new_count;
+    
+    return incomplete;
+}
@@ -0,0 +1,18 @@
+#ifndef LOADBALANCING_FUNCTIONS_H
+#define LOADBALANCING_FUNCTIONS_H
+
+#include <vector>
+
+//!Shift of the boundary between two consecutive MPI ranks bringing the load carried before the boundary (Tcur) closest to target.
+//!left and right are the loads of the patches of both ranks, in Hilbert order.
+//!Returns the number of patches given by the left rank to the right one (negative if the right rank gives patches).
+//!At least one patch is left to each rank and at most max_moved patches cross the boundary (incomplete is then set to true).
+//!moved_load is the load given by the left rank to the right one.
+int balanceBoundary( const std::vector<double> &left, const std::vector<double> &right, double Tcur, double target,
+                     unsigned int max_moved, bool &incomplete, double &moved_load );
+
+//!Serial equivalent of SmileiMPI::recompute_patch_count : new patch_count from the loads of all patches (in Hilbert order).
+//!Returns true if the distribution was limited by max_moved.
+bool balancePatchCount( const std::vector<double> &loads, std::vector<int> &patch_count, unsigned int max_moved );
+
+#endif
@@ -6,6 +6,7 @@
 
 #include <cmath>
 #include <string>
+#include <limits>
 
 using namespace std;
 
@@ -270,6 +271,11 @@ LaserProfileSeparable::LaserProfileSeparable(
 {
     space_envelope = NULL;
     phase = NULL;
+    amplitude_ = NULL;
+    // No amplitude computed yet (NaN differs from any time)
+    amplitude_time_ = std::numeric_limits<double>::quiet_NaN();
+    uniform_phase_ = false;
+    python_ = timeProfile_->profileName == "" || chirpProfile_->profileName == "";
 }
 // Separable laser profile cloning constructor
 LaserProfileSeparable::LaserProfileSeparable( LaserProfileSeparable *lp ) :
@@ -283,6 +289,11 @@ LaserProfileSeparable::LaserProfileSeparable( LaserProfileSeparable *lp ) :
 {
     space_envelope = NULL;
     phase = NULL;
+    amplitude_ = NULL;
+    // No amplitude computed yet (NaN differs from any time)
+    amplitude_time_ = std::numeric_limits<double>::quiet_NaN();
+    uniform_phase_ = false;
+    python_ = timeProfile_->profileName == "" || chirpProfile_->profileName == "";
 }
 // Separable laser profile destructor
 LaserProfileSeparable::~LaserProfileSeparable()
@@ -306,6 +317,9 @@ LaserProfileSeparable::~LaserProfileSeparable()
     if( phase ) {
         delete phase;
     }
+    if( amplitude_ ) {
+        delete amplitude_;
+    }
 }
 
 
@@ -343,6 +357,7 @@ void LaserProfileSeparable::createFields( Params &params, Patch *patch )
     //Create laser fields
     space_envelope = new Field2D( dim );
     phase          = new Field2D( dim );
+    amplitude_     = new Field2D( dim );
 }
 
 void LaserProfileSeparable::initFields( Params &params, Patch *patch )
@@ -413,19 +428,66 @@ void LaserProfileSeparable::initFields( Params &params, Patch *patch )
             pos[0] += dy;
         }
     }
+    
+    amplitude_time_ = std::numeric_limits<double>::quiet_NaN();
+    uniform_phase_ = true;
+    for( unsigned int i=1; i<phase->globalDims_; i++ ) {
+        if( ( *phase )( i ) != ( *phase )( 0 ) ) {
+            uniform_phase_ = false;
+            break;
+        }
+    }
 }
 
 // Amplitude of a separable laser profile
 double LaserProfileSeparable::getAmplitude( std::vector<double> pos, double t, int j, int k )
 {
-    double amp;
-    #pragma omp critical
-    {
-        double omega = omega_ * chirpProfile_->valueAt( t );
-        double phi = ( *phase )( j, k );
-        amp = timeProfile_->valueAt( t-( phi+delay_phase_ )/omega ) * ( *space_envelope )( j, k ) * sin( omega*t - phi );
+    // Each patch has its own laser profiles: the amplitudes of all points are computed
+    // by the thread handling the patch, at the first call of each timestep
+    if( t != amplitude_time_ ) {
+        computeAmplitudes( t );
+    }
+    return ( *amplitude_ )( j, k );
+}
+
+void LaserProfileSeparable::computeAmplitudes( double t )
+{
+    if( python_ ) {
+        #pragma omp critical
+        computeTimeEnvelope( t );
+    } else {
+        computeTimeEnvelope( t );
+    }
+    
+    unsigned int n = phase->globalDims_;
+    double *amplitude = amplitude_->data();
+    double *envelope = space_envelope->data();
+    double *phi = phase->data();
+    double omega = chirped_omega_;
+    #pragma omp simd
+    for( unsigned int i=0; i<n; i++ ) {
+        amplitude[i] *= envelope[i] * sin( omega*t - phi[i] );
+    }
+    amplitude_time_ = t;
+}
+
+void LaserProfileSeparable::computeTimeEnvelope( double t )
+{
+    chirped_omega_ = omega_ * chirpProfile_->valueAt( t );
+    
+    unsigned int n = phase->globalDims_;
+    double *amplitude = amplitude_->data();
+    if( uniform_phase_ ) {
+        double value = timeProfile_->valueAt( t-( ( *phase )( 0 )+delay_phase_ )/chirped_omega_ );
+        for( unsigned int i=0; i<n; i++ ) {
+            amplitude[i] = value;
+        }
+    } else {
+        // The time envelope is retarded by the phase of each point (not needed outside the space envelope)
+        for( unsigned int i=0; i<n; i++ ) {
+            amplitude[i] = ( *space_envelope )( i ) == 0. ? 0. : timeProfile_->valueAt( t-( ( *phase )( i )+delay_phase_ )/chirped_omega_ );
+        }
     }
-    return amp;
 }
 
 //Destructor
@@ -549,6 +611,9 @@ double LaserProfileFile::getAmplitude( std::vector<double> pos, double t, int j,
     for( unsigned int i=0; i<n; i++ ) {
         amp += ( *magnitude )( j, k, i ) * cos( omega[i] * t + ( *phase )( j, k, i ) );
     }
+    if( extraProfile->profileName != "" ) {
+        return amp * extraProfile->valueAt( pos, t );
+    }
     #pragma omp critical
     {
         amp *= extraProfile->valueAt( pos, t );
@@ -121,11 +121,23 @@ public:
     double getAmplitude( std::vector<double> pos, double t, int j, int k );
 protected:
     Field *space_envelope, *phase;
+    //! Amplitude at all points of the boundary, at time `amplitude_time_`
+    Field *amplitude_;
 private:
+    //! Compute the amplitudes of all points at time t
+    void computeAmplitudes( double t );
+    //! Evaluate the time profiles (chirp and time envelope) at time t
+    void computeTimeEnvelope( double t );
+    
     bool primal_;
     double omega_;
     Profile *timeProfile_, *chirpProfile_, *spaceProfile_, *phaseProfile_;
     double delay_phase_;
+    double amplitude_time_, chirped_omega_;
+    //! Whether the phase is the same at all points, so that the time envelope is evaluated once
+    bool uniform_phase_;
+    //! Whether the time profiles are python functions, which require a critical section
+    bool python_;
 };
 
 // Laser profile for non-separable space and time
@@ -140,6 +152,10 @@ public:
     ~LaserProfileNonSeparable();
     inline double getAmplitude( std::vector<double> pos, double t, int j, int k )
     {
+        // Only python profiles need to be evaluated by one thread at a time
+        if( spaceAndTimeProfile_->profileName != "" ) {
+            return spaceAndTimeProfile_->valueAt( pos, t );
+        }
         double amp;
         #pragma omp critical
         amp = spaceAndTimeProfile_->valueAt( pos, t );
@@ -148,6 +164,9 @@ public:
 
     inline std::complex<double> getAmplitudecomplex( std::vector<double> pos, double t, int j, int k )
     {
+        if( spaceAndTimeProfile_->profileName != "" ) {
+            return spaceAndTimeProfile_->complexValueAt( pos, t );
+        }
         std::complex<double> amp;
         #pragma omp critical
         amp = spaceAndTimeProfile_->complexValueAt( pos, t );
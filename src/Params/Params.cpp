@@ -2,6 +2,9 @@
 #include <cmath>
 #include <ctime>
 #include <iomanip>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #define SMILEI_IMPORT_ARRAY
 
@@ -22,21 +25,54 @@ using namespace std;
 namespace Rand
 {
 std::random_device device;
-std::mt19937 gen( device() );
+bool seeded = false;
+unsigned int initial_seed = 0;
+
+//! Generator of a thread, created when the thread first draws a number
+std::mt19937 threadGenerator()
+{
+    int ithread = 0;
+#ifdef _OPENMP
+    ithread = omp_get_thread_num();
+#endif
+    if( seeded ) {
+        return std::mt19937( initial_seed + ithread );
+    }
+    unsigned int s;
+    #pragma omp critical
+    s = device();
+    return std::mt19937( s );
+}
+thread_local std::mt19937 gen( threadGenerator() );
+
+void seed( unsigned int seed )
+{
+    seeded = true;
+    initial_seed = seed;
+    gen.seed( seed );
+}
 
-std::uniform_real_distribution<double> uniform_distribution( 0., 1. );
+void seedPatch( unsigned int hindex, unsigned int ispec )
+{
+    if( seeded ) {
+        std::seed_seq s { initial_seed, hindex, ispec };
+        gen.seed( s );
+    }
+}
+
+thread_local std::uniform_real_distribution<double> uniform_distribution( 0., 1. );
 double uniform()
 {
     return uniform_distribution( gen );
 }
 
-std::uniform_real_distribution<double> uniform_distribution1( 0., 1.-1e-11 );
+thread_local std::uniform_real_distribution<double> uniform_distribution1( 0., 1.-1e-11 );
 double uniform1()
 {
     return uniform_distribution1( gen );
 }
 
-std::uniform_real_distribution<double> uniform_distribution2( -1., 1. );
+thread_local std::uniform_real_distribution<double> uniform_distribution2( -1., 1. );
 double uniform2()
 {
     return uniform_distribution2( gen );
@@ -215,7 +251,7 @@ Params::Params( SmileiMPI *smpi, std::vector<std::string> namelistsFiles ) :
         // See https://software.intel.com/en-us/articles/random-number-function-vectorization
         srand48( random_seed );
         // Init of the seed for the C++ random generator
-        Rand::gen = std::mt19937( random_seed );
+        Rand::seed( random_seed );
     }
 
     // communication pattern initialized as partial B exchange
@@ -545,6 +581,9 @@ Params::Params( SmileiMPI *smpi, std::vector<std::string> namelistsFiles ) :
     }
 
 
+    load_model = "particles";
+    load_smoothing = 10;
+    max_patches_moved = 0;
     if( PyTools::nComponents( "LoadBalancing" )>0 ) {
         // get parameter "every" which describes a timestep selection
         load_balancing_time_selection = new TimeSelection(
@@ -553,6 +592,15 @@ Params::Params( SmileiMPI *smpi, std::vector<std::string> namelistsFiles ) :
         PyTools::extract( "cell_load", cell_load, "LoadBalancing" );
         PyTools::extract( "frozen_particle_load", frozen_particle_load, "LoadBalancing" );
         PyTools::extract( "initial_balance", initial_balance, "LoadBalancing" );
+        PyTools::extract( "load_model", load_model, "LoadBalancing" );
+        if( load_model != "particles" && load_model != "measured" ) {
+            ERROR( "In block `LoadBalancing`, parameter `load_model` must be `particles` or `measured`" );
+        }
+        PyTools::extract( "load_smoothing", load_smoothing, "LoadBalancing" );
+        if( load_smoothing == 0 ) {
+            ERROR( "In block `LoadBalancing`, parameter `load_smoothing` must be at least 1" );
+        }
+        PyTools::extract( "max_patches_moved", max_patches_moved, "LoadBalancing" );
     } else {
         load_balancing_time_selection = new TimeSelection();
     }
@@ -584,6 +632,7 @@ Params::Params( SmileiMPI *smpi, std::vector<std::string> namelistsFiles ) :
     vectorization_mode = "off";
     has_adaptive_vectorization = false;
     adaptive_vecto_time_selection = nullptr;
+    adaptive_cost_model = "reference";
 
     if( PyTools::nComponents( "Vectorization" )>0 ) {
         // Extraction of the vectorization mode
@@ -616,10 +665,28 @@ Params::Params( SmileiMPI *smpi, std::vector<std::string> namelistsFiles ) :
             adaptive_vecto_time_selection = new TimeSelection(
                 PyTools::extract_py( "reconfigure_every", "Vectorization" ), "Adaptive vectorization"
             );
+
+        // Cost model used to choose between scalar and vectorized operators
+        PyTools::extract( "cost_model", adaptive_cost_model, "Vectorization" );
+        if( !( adaptive_cost_model == "reference" ||
+                adaptive_cost_model == "calibrated" ) ) {
+            ERROR( "In block `Vectorization`, parameter `cost_model` must be `reference` or `calibrated`" );
+        }
+        PyTools::extract( "calibration_iterations", adaptive_calibration_iterations, "Vectorization" );
+        PyTools::extract( "cost_model_file", adaptive_cost_model_file, "Vectorization" );
+        if( ! has_adaptive_vectorization ) {
+            adaptive_cost_model = "reference";
+        }
     }
 
     ;
     PyTools::extract( "cell_sorting", cell_sorting, "Main" );
+    
+    // Distribution of the patches between threads
+    PyTools::extract( "patch_scheduling", patch_scheduling, "Main" );
+    if( patch_scheduling != "runtime" && patch_scheduling != "cost" ) {
+        ERROR( "The parameter `Main.patch_scheduling` must be `runtime` or `cost`" );
+    }
     //MESSAGE("Sorting per cell : " << cell_sorting );
     //if (cell_sorting)
     //    vectorization_mode = "on";
@@ -655,6 +722,11 @@ Params::Params( SmileiMPI *smpi, std::vector<std::string> namelistsFiles ) :
     if( ! PyTools::extract( "print_expected_disk_usage", print_expected_disk_usage, "Main" ) ) {
         ERROR( "The parameter `Main.print_expected_disk_usage` must be True or False" );
     }
+    
+    // Read the "print_memory_usage" parameter
+    if( ! PyTools::extract( "print_memory_usage", print_memory_usage, "Main" ) ) {
+        ERROR( "The parameter `Main.print_memory_usage` must be True or False" );
+    }
 
     // -------------------------------------------------------
     // Checking species order
@@ -1035,6 +1107,12 @@ void Params::print_init()
         MESSAGE( 1, "Happens: " << load_balancing_time_selection->info() );
         MESSAGE( 1, "Cell load coefficient = " << cell_load );
         MESSAGE( 1, "Frozen particle load coefficient = " << frozen_particle_load );
+        if( load_model == "measured" ) {
+            MESSAGE( 1, "Particle load measured by timers, averaged over " << load_smoothing << " iterations" );
+        }
+        if( max_patches_moved > 0 ) {
+            MESSAGE( 1, "Incremental migration: at most " << max_patches_moved << " patches moved across each MPI boundary per iteration" );
+        }
     }
 
     TITLE( "Vectorization: " );
@@ -1042,6 +1120,10 @@ void Params::print_init()
     if( vectorization_mode == "adaptive_mixed_sort" || vectorization_mode == "adaptive" ) {
         MESSAGE( 1, "Default mode: " << adaptive_default_mode );
         MESSAGE( 1, "Time selection: " << adaptive_vecto_time_selection->info() );
+        MESSAGE( 1, "Cost model: " << adaptive_cost_model );
+        if( adaptive_cost_model == "calibrated" ) {
+            MESSAGE( 2, "Calibration during " << adaptive_calibration_iterations << " iterations, stored in " << adaptive_cost_model_file );
+        }
     }
 
 }
@@ -1113,6 +1195,7 @@ void Params::print_parallelism_params( SmileiMPI *smpi )
 //        nthds = omp_get_num_threads();
 //    }
         MESSAGE( 1, "Number of thread per MPI process : " << smpi->getOMPMaxThreads() );
+        MESSAGE( 1, "Patch scheduling in particle dynamics : " << patch_scheduling );
 #else
         MESSAGE( "Disabled" );
 #endif
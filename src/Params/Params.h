@@ -34,15 +34,21 @@ class Profile;
 namespace Rand
 {
 extern std::random_device device;
-extern std::mt19937 gen;
+//! Each thread has its own generator, so that threads may draw numbers concurrently
+extern thread_local std::mt19937 gen;
+//! Seed the generators (each thread adds its number to `seed`)
+extern void seed( unsigned int seed );
+//! If a seed was given, restart the generator of the calling thread with a stream depending only on
+//! the seed, the patch and the species, so that the initial particles do not depend on the threads
+extern void seedPatch( unsigned int hindex, unsigned int ispec );
 
-extern std::uniform_real_distribution<double> uniform_distribution;
+extern thread_local std::uniform_real_distribution<double> uniform_distribution;
 extern double uniform();
 
-extern std::uniform_real_distribution<double> uniform_distribution1;
+extern thread_local std::uniform_real_distribution<double> uniform_distribution1;
 extern double uniform1();
 
-extern std::uniform_real_distribution<double> uniform_distribution2;
+extern thread_local std::uniform_real_distribution<double> uniform_distribution2;
 extern double uniform2();
 
 extern std::normal_distribution<double> normal_distribution;
@@ -247,11 +253,26 @@ public:
     bool one_patch_per_MPI;
     //! Compute an initially balanced patch distribution right from the start
     bool initial_balance;
+    //! Model of the patch load for the balancing: particles (number of particles), measured (patch timers)
+    std::string load_model;
+    //! Number of iterations over which the measured patch loads are averaged
+    unsigned int load_smoothing;
+    //! Maximum number of patches moved across each MPI boundary at one balancing (0 = no limit)
+    unsigned int max_patches_moved;
+    
+    //! Distribution of the patches between OpenMP threads in the particle dynamics: runtime, cost
+    std::string patch_scheduling;
     
     //! String containing the vectorization mode: off, on, adaptive, adaptive_mixed_sort
     std::string vectorization_mode;
     //! Initial state of the patches in adaptive mode
     std::string adaptive_default_mode;
+    //! Cost model of the adaptive mode: reference (fits of the code), calibrated (measured on the current machine)
+    std::string adaptive_cost_model;
+    //! Number of iterations during which the operators alternate to calibrate the cost model
+    unsigned int adaptive_calibration_iterations;
+    //! File where the calibrated cost model is stored and reloaded
+    std::string adaptive_cost_model_file;
     
     //! Tells whether there is a moving window
     bool hasWindow;
@@ -297,6 +318,9 @@ public:
     //! Boolean for printing the expected disk usage or not
     bool print_expected_disk_usage;
     
+    //! Boolean for printing the memory usage of each subsystem every print_every
+    bool print_memory_usage;
+    
     //! Random seed
     unsigned int random_seed;
     
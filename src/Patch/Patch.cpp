@@ -44,6 +44,11 @@ Patch::Patch( Params &params, SmileiMPI *smpi, DomainDecomposition *domain_decom
 
     hindex = ipatch;
     nDim_fields_ = params.nDim_field;
+    dynamics_time_ = 0.;
+    compute_time_ = 0.;
+    load_history_.resize( params.load_smoothing, 0. );
+    load_history_index_ = 0;
+    load_history_count_ = 0;
 
     initStep1( params );
 
@@ -77,6 +82,11 @@ Patch::Patch( Patch *patch, Params &params, SmileiMPI *smpi, DomainDecomposition
 
     hindex = ipatch;
     nDim_fields_ = patch->nDim_fields_;
+    dynamics_time_ = 0.;
+    compute_time_ = 0.;
+    load_history_.resize( params.load_smoothing, 0. );
+    load_history_index_ = 0;
+    load_history_count_ = 0;
 
     initStep1( params );
 
@@ -833,6 +843,16 @@ void Patch::importAndSortParticles( SmileiMPI *smpi, int ispec, Params &params,
     timer = MPI_Wtime();
 #endif
 
+    // Particles received from the neighbours count in the scalar diagnostics of this patch
+    if( vecSpecies[ispec]->accumulate_scalars_ ) {
+        for( unsigned int iDim=0 ; iDim < vecSpecies[ispec]->MPI_buffer_.partRecv.size() ; iDim++ ) {
+            for( int iNeighbor=0 ; iNeighbor<nbNeighbors_ ; iNeighbor++ ) {
+                vecSpecies[ispec]->accumulateScalars( vecSpecies[ispec]->MPI_buffer_.partRecv[iDim][iNeighbor], 0,
+                                                      vecSpecies[ispec]->MPI_buffer_.part_index_recv_sz[iDim][iNeighbor] );
+            }
+        }
+    }
+
     vecSpecies[ispec]->sortParticles( params , this);
 
 #ifdef  __DETAILED_TIMERS
@@ -93,6 +93,34 @@ public:
     // Detailed timers
     // -----------------------
     
+    //! Time spent in the particle dynamics of the patch at the last iteration (0 if never measured)
+    double dynamics_time_;
+    
+    //! Compute time of the patch accumulated since the last record (collisions, dynamics, merging)
+    double compute_time_;
+    
+    //! Store compute_time_ in the load history and reset it
+    inline void recordLoad()
+    {
+        load_history_[load_history_index_] = compute_time_;
+        load_history_index_ = ( load_history_index_+1 ) % load_history_.size();
+        if( load_history_count_ < load_history_.size() ) {
+            load_history_count_++;
+        }
+        compute_time_ = 0.;
+    }
+    
+    //! Average compute time per iteration over the load history, 0 if never measured
+    inline double measuredLoad()
+    {
+        double load = 0.;
+        for( unsigned int i=0; i<load_history_count_; i++ ) {
+            load += load_history_[i];
+        }
+        return load_history_count_ > 0 ? load / ( double )load_history_count_ : 0.;
+    }
+    
+    
 #ifdef  __DETAILED_TIMERS
     //! Timers for the patch
     std::vector<double> patch_timers;
@@ -357,6 +385,13 @@ public:
     
     
 protected:
+    //! Compute time of the last iterations (circular buffer of Params::load_smoothing values)
+    std::vector<double> load_history_;
+    //! Next position to be written in load_history_
+    unsigned int load_history_index_;
+    //! Number of values already recorded in load_history_
+    unsigned int load_history_count_;
+    
     // Complementary members for the description of the geometry
     // ---------------------------------------------------------
     
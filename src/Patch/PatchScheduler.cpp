@@ -0,0 +1,171 @@
+
+#include "PatchScheduler.h"
+
+#include <algorithm>
+
+#include "VectorPatch.h"
+
+using namespace std;
+
+PatchScheduler::PatchScheduler() :
+    imbalance_time_( 0. )
+{
+}
+
+PatchScheduler::~PatchScheduler()
+{
+#ifdef _OPENMP
+    for( unsigned int i=0; i<locks_.size(); i++ ) {
+        omp_destroy_lock( &locks_[i] );
+    }
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Predict the cost of each patch
+//   The time measured at the previous iteration is the best estimate (it accounts for radiation, ionization,
+//   vectorized or scalar operators ...). Patches which were never measured (new patches after load balancing or
+//   moving window) are given a cost proportional to their number of particles, scaled with the average time per
+//   particle of the measured patches.
+// ---------------------------------------------------------------------------------------------------------------------
+void PatchScheduler::predictCosts( VectorPatch &vecPatches, vector<double> &costs )
+{
+    unsigned int npatches = vecPatches.size();
+    costs.resize( npatches );
+
+    vector<double> nparticles( npatches, 0. );
+    double measured_time = 0., measured_particles = 0.;
+    for( unsigned int ipatch=0; ipatch<npatches; ipatch++ ) {
+        for( unsigned int ispec=0; ispec<vecPatches( ipatch )->vecSpecies.size(); ispec++ ) {
+            nparticles[ipatch] += ( double )vecPatches( ipatch )->vecSpecies[ispec]->getNbrOfParticles();
+        }
+        if( vecPatches( ipatch )->dynamics_time_ > 0. ) {
+            measured_time      += vecPatches( ipatch )->dynamics_time_;
+            measured_particles += nparticles[ipatch];
+        }
+    }
+    double time_per_particle = ( measured_time > 0. && measured_particles > 0. ) ? measured_time / measured_particles : 1.;
+
+    for( unsigned int ipatch=0; ipatch<npatches; ipatch++ ) {
+        if( vecPatches( ipatch )->dynamics_time_ > 0. ) {
+            costs[ipatch] = vecPatches( ipatch )->dynamics_time_;
+        } else {
+            costs[ipatch] = ( nparticles[ipatch] + 1. ) * time_per_particle;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Allocate the per-thread structures
+// ---------------------------------------------------------------------------------------------------------------------
+void PatchScheduler::resize( int nthreads )
+{
+    if( ( int )queues_.size() == nthreads ) {
+        return;
+    }
+#ifdef _OPENMP
+    for( unsigned int i=0; i<locks_.size(); i++ ) {
+        omp_destroy_lock( &locks_[i] );
+    }
+    locks_.resize( nthreads );
+    for( int i=0; i<nthreads; i++ ) {
+        omp_init_lock( &locks_[i] );
+    }
+#endif
+    queues_.resize( nthreads );
+    head_.assign( nthreads, 0 );
+    tail_.assign( nthreads, 0 );
+    busy_time_.assign( nthreads, 0. );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Sort patches by decreasing cost and deal them to the least loaded thread
+// ---------------------------------------------------------------------------------------------------------------------
+void PatchScheduler::prepare( VectorPatch &vecPatches )
+{
+    int nthreads = queues_.size();
+
+    vector<double> costs;
+    predictCosts( vecPatches, costs );
+
+    unsigned int npatches = vecPatches.size();
+    vector<int> order( npatches );
+    for( unsigned int ipatch=0; ipatch<npatches; ipatch++ ) {
+        order[ipatch] = ipatch;
+    }
+    stable_sort( order.begin(), order.end(), [&costs]( int a, int b ) {
+        return costs[a] > costs[b];
+    } );
+
+    // Longest processing time first: each patch goes to the thread with the smallest load so far
+    vector<double> thread_load( nthreads, 0. );
+    for( int ithread=0; ithread<nthreads; ithread++ ) {
+        queues_[ithread].clear();
+    }
+    for( unsigned int i=0; i<npatches; i++ ) {
+        int ithread = min_element( thread_load.begin(), thread_load.end() ) - thread_load.begin();
+        queues_[ithread].push_back( order[i] );
+        thread_load[ithread] += costs[order[i]];
+    }
+    for( int ithread=0; ithread<nthreads; ithread++ ) {
+        head_[ithread] = 0;
+        tail_[ithread] = queues_[ithread].size();
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Pop the heaviest patch of the own queue, or steal the lightest patch of another queue
+// ---------------------------------------------------------------------------------------------------------------------
+int PatchScheduler::next( int ithread )
+{
+    int nthreads = queues_.size();
+    int ipatch = -1;
+
+#ifdef _OPENMP
+    omp_set_lock( &locks_[ithread] );
+#endif
+    if( head_[ithread] < tail_[ithread] ) {
+        ipatch = queues_[ithread][head_[ithread]++];
+    }
+#ifdef _OPENMP
+    omp_unset_lock( &locks_[ithread] );
+#endif
+    if( ipatch >= 0 ) {
+        return ipatch;
+    }
+
+    for( int i=1; i<nthreads; i++ ) {
+        int victim = ( ithread + i ) % nthreads;
+#ifdef _OPENMP
+        omp_set_lock( &locks_[victim] );
+#endif
+        if( head_[victim] < tail_[victim] ) {
+            ipatch = queues_[victim][--tail_[victim]];
+        }
+#ifdef _OPENMP
+        omp_unset_lock( &locks_[victim] );
+#endif
+        if( ipatch >= 0 ) {
+            return ipatch;
+        }
+    }
+
+    return -1;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// The imbalance of one iteration is the time between the mean and the slowest thread
+// ---------------------------------------------------------------------------------------------------------------------
+void PatchScheduler::accumulateImbalance()
+{
+    if( busy_time_.size() == 0 ) {
+        return;
+    }
+    double max_time = 0., sum_time = 0.;
+    for( unsigned int ithread=0; ithread<busy_time_.size(); ithread++ ) {
+        max_time = max( max_time, busy_time_[ithread] );
+        sum_time += busy_time_[ithread];
+        busy_time_[ithread] = 0.;
+    }
+    imbalance_time_ += max_time - sum_time / ( double )busy_time_.size();
+}
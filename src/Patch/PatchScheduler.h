@@ -0,0 +1,64 @@
+
+#ifndef PATCHSCHEDULER_H
+#define PATCHSCHEDULER_H
+
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+class VectorPatch;
+
+//  --------------------------------------------------------------------------------------------------------------------
+//! Class PatchScheduler
+//!   Cost-aware distribution of the patches between the OpenMP threads of a MPI process.
+//!   Patches are sorted by decreasing predicted cost and dealt to per-thread queues (longest processing time first).
+//!   Each thread treats its own queue from the heaviest patch, then steals the lightest patches left in the others.
+//  --------------------------------------------------------------------------------------------------------------------
+class PatchScheduler
+{
+public:
+    PatchScheduler();
+    ~PatchScheduler();
+
+    //! Allocate the per-thread structures for `nthreads` threads (called by a single thread)
+    void resize( int nthreads );
+
+    //! Build the thread queues from the cost predicted for each patch (called by a single thread, after resize)
+    void prepare( VectorPatch &vecPatches );
+
+    //! Return the next patch to be treated by thread `ithread`, -1 if no patch remains
+    int next( int ithread );
+
+    //! Store the time spent by a thread in patches at the current iteration
+    inline void setBusyTime( int ithread, double busy_time )
+    {
+        busy_time_[ithread] = busy_time;
+    }
+
+    //! Accumulate the load imbalance between threads of the last iteration (called by a single thread)
+    void accumulateImbalance();
+
+    //! Time lost waiting for the slowest thread, accumulated since the beginning of the run
+    double imbalance_time_;
+
+private:
+    //! Predict the cost of each patch from its measured time, or from its number of particles when not measured
+    void predictCosts( VectorPatch &vecPatches, std::vector<double> &costs );
+
+    //! Queue of patch indices for each thread, sorted by decreasing cost
+    std::vector<std::vector<int> > queues_;
+    //! First and last+1 positions of the patches remaining in each queue
+    std::vector<int> head_, tail_;
+    //! Time spent by each thread in patches at the last iteration
+    std::vector<double> busy_time_;
+
+#ifdef _OPENMP
+    //! One lock per queue, taken by the owner and by the thieves
+    std::vector<omp_lock_t> locks_;
+#endif
+
+};
+
+#endif
@@ -14,6 +14,7 @@
 #include "SpeciesV.h"
 #include "SpeciesVAdaptiveMixedSort.h"
 #include "SpeciesVAdaptive.h"
+#include "ParticleCreator.h"
 #endif
 
 class PatchesFactory
@@ -50,6 +51,68 @@ public:
         return nullptr;
     }
     
+    //! Whether the particles of a species may be created by any thread: python functions
+    //! and numpy arrays are only available to the thread holding the python interpreter
+    static bool hasBuiltInProfiles( Species *species )
+    {
+        if( species->position_initialization_array_ || species->momentum_initialization_array_ ) {
+            return false;
+        }
+        std::vector<Profile *> profiles( 1, species->charge_profile_ );
+        profiles.push_back( species->density_profile_ );
+        profiles.push_back( species->particles_per_cell_profile_ );
+        profiles.insert( profiles.end(), species->velocity_profile_.begin(), species->velocity_profile_.end() );
+        profiles.insert( profiles.end(), species->temperature_profile_.begin(), species->temperature_profile_.end() );
+        for( unsigned int i=0; i<profiles.size(); i++ ) {
+            if( profiles[i] && profiles[i]->profileName == "" ) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    //! Create the particles of patches cloned without particles (all patches but the first).
+    //! Species with built-in profiles are created by all threads, so that each patch is
+    //! allocated by the thread which will most likely handle it in the time loop.
+    //! Species requiring python are created beforehand by the master thread.
+    static void createParticles( VectorPatch &vecPatches, Params &params )
+    {
+        unsigned int nspecies = vecPatches( 0 )->vecSpecies.size();
+        std::vector<bool> threaded( nspecies );
+        unsigned int nthreaded = 0;
+        for( unsigned int ispec=0 ; ispec<nspecies ; ispec++ ) {
+            threaded[ispec] = hasBuiltInProfiles( vecPatches( 0 )->vecSpecies[ispec] );
+            if( threaded[ispec] ) {
+                nthreaded++;
+            }
+        }
+        MESSAGE( 1, "Creating particles (" << nthreaded << " species out of " << nspecies << " created by all threads)" );
+        
+        for( unsigned int ipatch=1 ; ipatch<vecPatches.size() ; ipatch++ ) {
+            for( unsigned int ispec=0 ; ispec<nspecies ; ispec++ ) {
+                if( ! threaded[ispec] ) {
+                    Rand::seedPatch( vecPatches( ipatch )->Hindex(), ispec );
+                    ParticleCreator particle_creator;
+                    particle_creator.associate( vecPatches( ipatch )->vecSpecies[ispec] );
+                    particle_creator.create( params.n_space, params, vecPatches( ipatch ), 0, 0 );
+                }
+            }
+        }
+        
+        #pragma omp parallel for schedule(runtime)
+        for( unsigned int ipatch=1 ; ipatch<vecPatches.size() ; ipatch++ ) {
+            for( unsigned int ispec=0 ; ispec<nspecies ; ispec++ ) {
+                if( threaded[ispec] ) {
+                    Rand::seedPatch( vecPatches( ipatch )->Hindex(), ispec );
+                    ParticleCreator particle_creator;
+                    particle_creator.associate( vecPatches( ipatch )->vecSpecies[ispec] );
+                    particle_creator.create( params.n_space, params, vecPatches( ipatch ), 0, 0 );
+                }
+            }
+            vecPatches( ipatch )->copyPositions( vecPatches( ipatch )->vecSpecies );
+        }
+    }
+    
     // Create a vector of patches
     static void createVector( VectorPatch &vecPatches, Params &params, SmileiMPI *smpi, OpenPMDparams &openPMD, unsigned int itime, unsigned int n_moved=0 )
     {
@@ -78,14 +141,19 @@ public:
         TITLE( "Initializing Patches" );
         MESSAGE( 1, "First patch created" );
         
-        // If normal mode (not test mode) clone the first patch to create the others
+        // If normal mode (not test mode) clone the first patch to create the others, without particles
         unsigned int percent=10;
         for( unsigned int ipatch = 1 ; ipatch < npatches ; ipatch++ ) {
             if( ( 100*ipatch )/npatches > percent ) {
                 MESSAGE( 2, "Approximately "<<percent<<"% of patches created" );
                 percent += 10;
             }
-            vecPatches.patches_[ipatch] = clone( vecPatches( 0 ), params, smpi, vecPatches.domain_decomposition_, firstpatch + ipatch, n_moved );
+            vecPatches.patches_[ipatch] = clone( vecPatches( 0 ), params, smpi, vecPatches.domain_decomposition_, firstpatch + ipatch, n_moved, false );
+        }
+        
+        // Create the particles of the cloned patches
+        if( ! params.restart && npatches > 1 ) {
+            createParticles( vecPatches, params );
         }
         
         //Cleaning arrays and pointer
@@ -10,6 +10,8 @@
 
 #include "Collisions.h"
 #include "DomainDecompositionFactory.h"
+#include "SpeciesMetrics.h"
+#include "AsyncWriter.h"
 #include "PatchesFactory.h"
 #include "Species.h"
 #include "Particles.h"
@@ -24,6 +26,7 @@
 #include "SyncVectorPatch.h"
 #include "interface.h"
 #include "Timers.h"
+#include "Tracer.h"
 
 using namespace std;
 
@@ -31,12 +34,18 @@ using namespace std;
 VectorPatch::VectorPatch()
 {
     domain_decomposition_ = NULL ;
+    migration_pending_ = false;
+    balance_now_ = false;
+    sample_vecto_cost_ = false;
 }
 
 
 VectorPatch::VectorPatch( Params &params )
 {
     domain_decomposition_ = DomainDecompositionFactory::create( params );
+    migration_pending_ = false;
+    balance_now_ = false;
+    sample_vecto_cost_ = false;
 }
 
 
@@ -234,13 +243,17 @@ void VectorPatch::configuration( Params &params, Timers &timers, int itime )
 // ---------------------------------------------------------------------------------------------------------------------
 // Reconfigure all patches for the new time step
 // ---------------------------------------------------------------------------------------------------------------------
-void VectorPatch::reconfiguration( Params &params, Timers &timers, int itime )
+void VectorPatch::reconfiguration( Params &params, Timers &timers, int itime, SmileiMPI *smpi )
 {
     //if (params.has_adaptive_vectorization)
     //{
 
     timers.reconfiguration.restart();
 
+    // Fit the cost model with the times measured since the last reconfiguration
+    #pragma omp single
+    SpeciesMetrics::updateModel( params, smpi, itime );
+
     unsigned int npatches = this->size();
 
     // Clean buffers
@@ -307,55 +320,44 @@ void VectorPatch::dynamics( Params &params,
             applyExternalTimeFields(time_dual);
         
         diag_flag = needsRhoJsNow( itime );
+        scalars_flag = static_cast<DiagnosticScalar *>( globalDiags[0] )->needsSpeciesSums( itime );
+
+        // Species times are measured at each iteration of the calibration, then at each reconfiguration
+        sample_vecto_cost_ = params.adaptive_cost_model == "calibrated"
+                             && ( SpeciesMetrics::isCalibrating() || params.adaptive_vecto_time_selection->theTimeIsNow( itime ) );
+
+#ifdef _OPENMP
+        patch_scheduler_.resize( omp_get_num_threads() );
+#else
+        patch_scheduler_.resize( 1 );
+#endif
+        patch_scheduler_.accumulateImbalance();
+        if( params.patch_scheduling == "cost" ) {
+            patch_scheduler_.prepare( *this );
+        }
     }
 	
     timers.particles.restart();
-    ostringstream t;
-    #pragma omp for schedule(runtime)
-    for( unsigned int ipatch=0 ; ipatch<this->size() ; ipatch++ ) {
-        ( *this )( ipatch )->EMfields->restartRhoJ();
-        //MESSAGE("restart rhoj");
-        for( unsigned int ispec=0 ; ispec<( *this )( ipatch )->vecSpecies.size() ; ispec++ ) {
-            Species *spec = species( ipatch, ispec );
-            if( spec->ponderomotive_dynamics ) {
-                continue;
-            }
-            if( spec->isProj( time_dual, simWindow ) || diag_flag ) {
-                // Dynamics with vectorized operators
-                if( spec->vectorized_operators || params.cell_sorting ) {
-                    spec->dynamics( time_dual, ispec,
-                                    emfields( ipatch ),
-                                    params, diag_flag, partwalls( ipatch ),
-                                    ( *this )( ipatch ), smpi,
-                                    RadiationTables,
-                                    MultiphotonBreitWheelerTables,
-                                    localDiags );
-                }
-                // Dynamics with scalar operators
-                else {
-                    if( params.vectorization_mode == "adaptive" ) {
-                        spec->scalarDynamics( time_dual, ispec,
-                                               emfields( ipatch ),
-                                               params, diag_flag, partwalls( ipatch ),
-                                               ( *this )( ipatch ), smpi,
-                                               RadiationTables,
-                                               MultiphotonBreitWheelerTables,
-                                               localDiags );
-                    } else {
-                        spec->Species::dynamics( time_dual, ispec,
-                                                 emfields( ipatch ),
-                                                 params, diag_flag, partwalls( ipatch ),
-                                                 ( *this )( ipatch ), smpi,
-                                                 RadiationTables,
-                                                 MultiphotonBreitWheelerTables,
-                                                 localDiags );
-                    }
-                } // end if condition on envelope dynamics
-            } // end if condition on species
-        } // end loop on species
-        //MESSAGE("species dynamics");
-    } // end loop on patches
-
+#ifdef _OPENMP
+    int ithread = omp_get_thread_num();
+#else
+    int ithread = 0;
+#endif
+    double busy_time = 0.;
+    if( params.patch_scheduling == "cost" ) {
+        // Heaviest patches first, with work stealing between threads
+        for( int ipatch = patch_scheduler_.next( ithread ) ; ipatch >= 0 ; ipatch = patch_scheduler_.next( ithread ) ) {
+            busy_time += dynamicsOnePatch( ipatch, params, smpi, simWindow, RadiationTables, MultiphotonBreitWheelerTables, time_dual );
+        }
+        patch_scheduler_.setBusyTime( ithread, busy_time );
+        #pragma omp barrier
+    } else {
+        #pragma omp for schedule(runtime)
+        for( unsigned int ipatch=0 ; ipatch<this->size() ; ipatch++ ) {
+            busy_time += dynamicsOnePatch( ipatch, params, smpi, simWindow, RadiationTables, MultiphotonBreitWheelerTables, time_dual );
+        }
+        patch_scheduler_.setBusyTime( ithread, busy_time );
+    }
 
     timers.particles.update( params.printNow( itime ) );
 #ifdef __DETAILED_TIMERS
@@ -387,6 +389,85 @@ void VectorPatch::dynamics( Params &params,
 #endif
 } // END dynamics
 
+// ---------------------------------------------------------------------------------------------------------------------
+// Move the particles of one patch, return the time spent
+// ---------------------------------------------------------------------------------------------------------------------
+double VectorPatch::dynamicsOnePatch( unsigned int ipatch,
+                                      Params &params,
+                                      SmileiMPI *smpi,
+                                      SimWindow *simWindow,
+                                      RadiationTables &RadiationTables,
+                                      MultiphotonBreitWheelerTables &MultiphotonBreitWheelerTables,
+                                      double time_dual )
+{
+    double timer = MPI_Wtime();
+    Tracer::begin( "Patch dynamics", ( *this )( ipatch )->hindex );
+    ( *this )( ipatch )->EMfields->restartRhoJ();
+    //MESSAGE("restart rhoj");
+    for( unsigned int ispec=0 ; ispec<( *this )( ipatch )->vecSpecies.size() ; ispec++ ) {
+        Species *spec = species( ipatch, ispec );
+        spec->prepareScalars( scalars_flag && !spec->particles->is_test && !spec->ponderomotive_dynamics );
+        if( spec->ponderomotive_dynamics ) {
+            continue;
+        }
+        if( spec->isProj( time_dual, simWindow ) || diag_flag ) {
+            double model_terms[5];
+            double species_timer = 0.;
+            bool sample = sample_vecto_cost_ && time_dual > spec->time_frozen_;
+            if( sample ) {
+                // In scalar mode, count is not refreshed by the sort: the particles are counted from their positions
+                if( spec->vectorized_operators ) {
+                    SpeciesMetrics::get_model_terms( spec->count, model_terms );
+                } else {
+                    std::vector<int> cell_count;
+                    spec->countParticlesPerCell( cell_count );
+                    SpeciesMetrics::get_model_terms( cell_count, model_terms );
+                }
+                species_timer = MPI_Wtime();
+            }
+            // Dynamics with vectorized operators
+            if( spec->vectorized_operators || params.cell_sorting ) {
+                spec->dynamics( time_dual, ispec,
+                                emfields( ipatch ),
+                                params, diag_flag, partwalls( ipatch ),
+                                ( *this )( ipatch ), smpi,
+                                RadiationTables,
+                                MultiphotonBreitWheelerTables,
+                                localDiags );
+            }
+            // Dynamics with scalar operators
+            else {
+                if( params.vectorization_mode == "adaptive" ) {
+                    spec->scalarDynamics( time_dual, ispec,
+                                           emfields( ipatch ),
+                                           params, diag_flag, partwalls( ipatch ),
+                                           ( *this )( ipatch ), smpi,
+                                           RadiationTables,
+                                           MultiphotonBreitWheelerTables,
+                                           localDiags );
+                } else {
+                    spec->Species::dynamics( time_dual, ispec,
+                                             emfields( ipatch ),
+                                             params, diag_flag, partwalls( ipatch ),
+                                             ( *this )( ipatch ), smpi,
+                                             RadiationTables,
+                                             MultiphotonBreitWheelerTables,
+                                             localDiags );
+                }
+            } // end if condition on envelope dynamics
+            if( sample ) {
+                SpeciesMetrics::addSample( model_terms, MPI_Wtime() - species_timer, spec->vectorized_operators );
+            }
+        } // end if condition on species
+    } // end loop on species
+
+    ( *this )( ipatch )->dynamics_time_ = MPI_Wtime() - timer;
+    ( *this )( ipatch )->compute_time_ += ( *this )( ipatch )->dynamics_time_;
+    ( *this )( ipatch )->recordLoad();
+    Tracer::end( "Patch dynamics", ( *this )( ipatch )->hindex );
+    return ( *this )( ipatch )->dynamics_time_;
+} // END dynamicsOnePatch
+
 // ---------------------------------------------------------------------------------------------------------------------
 // For all patches, project charge and current densities with standard scheme for diag purposes at t=0
 // ---------------------------------------------------------------------------------------------------------------------
@@ -481,6 +562,7 @@ void VectorPatch::mergeParticles(Params &params, SmileiMPI *smpi, double time_du
     
     #pragma omp for schedule(runtime)
     for( unsigned int ipatch=0 ; ipatch<this->size() ; ipatch++ ) {
+        double timer = MPI_Wtime();
         // Particle importation for all species
         for( unsigned int ispec=0 ; ispec<( *this )( ipatch )->vecSpecies.size() ; ispec++ ) {
             // Check if the particle merging is activated for this species
@@ -488,6 +570,8 @@ void VectorPatch::mergeParticles(Params &params, SmileiMPI *smpi, double time_du
 
                 // Check the time selection
                 if( species( ipatch, ispec )->merging_time_selection_->theTimeIsNow( itime ) ) {
+                    // The sums of the scalar diagnostics must be computed again after merging
+                    species( ipatch, ispec )->scalars_ready_ = false;
                     species( ipatch, ispec )->mergeParticles( time_dual, ispec,
                             params,
                             ( *this )( ipatch ), smpi,
@@ -495,6 +579,7 @@ void VectorPatch::mergeParticles(Params &params, SmileiMPI *smpi, double time_du
                 }
             }
         }
+        ( *this )( ipatch )->compute_time_ += MPI_Wtime() - timer;
     }
     
     timers.particleMerging.update( params.printNow( itime ) );
@@ -502,10 +587,22 @@ void VectorPatch::mergeParticles(Params &params, SmileiMPI *smpi, double time_du
 }
 
 //! Clean MPI buffers and resize particle arrays to save memory
-void VectorPatch::cleanParticlesOverhead(Params &params, Timers &timers, int itime )
+void VectorPatch::cleanParticlesOverhead(Params &params, SmileiMPI *smpi, Timers &timers, int itime )
 {
     timers.syncPart.restart();
     
+    // Measure the memory before the cleaning, when the particle arrays and buffers are the largest.
+    // The counters are cheap and updated at each timestep to catch the peaks; the resident memory
+    // is only read when it is output. The other threads wait for the master at the next barrier
+    // (after the cleaning, or in the update of the syncPart timer), so no container changes meanwhile.
+    #pragma omp master
+    {
+        updateMemoryCounters( smpi );
+        if( memoryAccountingNow( params, itime ) ) {
+            accountProcessMemory();
+        }
+    }
+    
     if( itime%params.every_clean_particles_overhead==0 ) {
         #pragma omp master
         for( unsigned int ipatch=0 ; ipatch<this->size() ; ipatch++ ) {
@@ -1157,6 +1254,8 @@ void VectorPatch::initAllDiags( Params &params, SmileiMPI *smpi )
 
 void VectorPatch::closeAllDiags( SmileiMPI *smpi )
 {
+    AsyncWriter::wait();
+    
     // MPI master closes all global diags
     if( smpi->isMaster() )
         for( unsigned int idiag = 0 ; idiag < globalDiags.size() ; idiag++ ) {
@@ -1167,6 +1266,8 @@ void VectorPatch::closeAllDiags( SmileiMPI *smpi )
     for( unsigned int idiag = 0 ; idiag < localDiags.size() ; idiag++ ) {
         localDiags[idiag]->closeFile();
     }
+    
+    AsyncWriter::stop();
 }
 
 
@@ -1194,18 +1295,37 @@ void VectorPatch::runAllDiags( Params &params, SmileiMPI *smpi, unsigned int iti
 {
     // Global diags: scalars + particles
     timers.diags.restart();
+    #pragma omp single
+    {
+        for( unsigned int idiag = 0 ; idiag < globalDiags.size() ; idiag++ ) {
+            globalDiags[idiag]->theTimeIsNow = globalDiags[idiag]->prepare( itime );
+            // Files are not accessed while the I/O thread writes
+            if( globalDiags[idiag]->theTimeIsNow && globalDiags[idiag]->writesNow( itime ) ) {
+                AsyncWriter::wait();
+            }
+        }
+    }
+
+    // All the diags due now run on a patch one after the other, so that its particles are
+    // streamed once and their Lorentz factors are computed once
+    #pragma omp for schedule(runtime)
+    for( unsigned int ipatch=0 ; ipatch<size() ; ipatch++ ) {
+        for( unsigned int idiag = 0 ; idiag < globalDiags.size() ; idiag++ ) {
+            if( globalDiags[idiag]->theTimeIsNow ) {
+                globalDiags[idiag]->run( ( *this )( ipatch ), itime, simWindow );
+            }
+        }
+        for( unsigned int ispec = 0 ; ispec < ( *this )( ipatch )->vecSpecies.size() ; ispec++ ) {
+            ( *this )( ipatch )->vecSpecies[ispec]->clearDiagLorentzFactors();
+        }
+    }
+
     for( unsigned int idiag = 0 ; idiag < globalDiags.size() ; idiag++ ) {
         diag_timers[idiag]->restart();
 
-        #pragma omp single
-        globalDiags[idiag]->theTimeIsNow = globalDiags[idiag]->prepare( itime );
-        #pragma omp barrier
         if( globalDiags[idiag]->theTimeIsNow ) {
-            // All patches run
-            #pragma omp for schedule(runtime)
-            for( unsigned int ipatch=0 ; ipatch<size() ; ipatch++ ) {
-                globalDiags[idiag]->run( ( *this )( ipatch ), itime, simWindow );
-            }
+            // Threads sum their contributions
+            globalDiags[idiag]->reduceThreads();
             // MPI procs gather the data and compute
             #pragma omp single
             smpi->computeGlobalDiags( globalDiags[idiag], itime );
@@ -1222,7 +1342,17 @@ void VectorPatch::runAllDiags( Params &params, SmileiMPI *smpi, unsigned int iti
         diag_timers[globalDiags.size()+idiag]->restart();
 
         #pragma omp single
-        localDiags[idiag]->theTimeIsNow = localDiags[idiag]->prepare( itime );
+        {
+            localDiags[idiag]->theTimeIsNow = localDiags[idiag]->prepare( itime );
+            // An asynchronous diag only waits for its own writes, the others do not access the files while the I/O thread writes
+            if( localDiags[idiag]->theTimeIsNow && localDiags[idiag]->writesNow( itime ) ) {
+                if( localDiags[idiag]->writesAsynchronously() ) {
+                    AsyncWriter::wait( localDiags[idiag] );
+                } else {
+                    AsyncWriter::wait();
+                }
+            }
+        }
         #pragma omp barrier
         // All MPI run their stuff and write out
         if( localDiags[idiag]->theTimeIsNow ) {
@@ -2614,12 +2744,18 @@ void VectorPatch::solveRelativisticPoissonAM( Params &params, SmileiMPI *smpi, d
 void VectorPatch::loadBalance( Params &params, double time_dual, SmileiMPI *smpi, SimWindow *simWindow, unsigned int itime )
 {
 
-    // Compute new patch distribution
-    smpi->recompute_patch_count( params, *this, time_dual );
+    // Compute new patch distribution, possibly limited to a few patches per MPI boundary
+    migration_pending_ = smpi->recompute_patch_count( params, *this, time_dual );
 
-    // Create empty patches according to this new distribution
+    // Define the patches to send and to receive according to this new distribution
     this->createPatches( params, smpi, simWindow );
 
+    // Post the particles of the leaving patches before building the new ones, so that the transfer overlaps the cloning
+    this->sendSpecies( smpi, params );
+
+    // Create empty patches to receive the incoming ones
+    this->clonePatches( params, smpi, simWindow );
+
     // Proceed to patch exchange, and delete patch which moved
     this->exchangePatches( smpi, params );
 
@@ -2633,11 +2769,9 @@ void VectorPatch::loadBalance( Params &params, double time_dual, SmileiMPI *smpi
 // Explicits patch movement regarding new patch distribution stored in smpi->patch_count
 //   - compute send_patch_id_
 //   - compute recv_patch_id_
-//   - create empty (not really, created like at t0) new patch in recv_patches_
 // ---------------------------------------------------------------------------------------------------------------------
 void VectorPatch::createPatches( Params &params, SmileiMPI *smpi, SimWindow *simWindow )
 {
-    unsigned int n_moved( 0 );
     recv_patches_.resize( 0 );
 
     // Set Index of the 1st patch of the vector yet on current MPI rank
@@ -2691,11 +2825,20 @@ void VectorPatch::createPatches( Params &params, SmileiMPI *smpi, SimWindow *sim
     if( existing_patch_id<0 ) {
         ERROR( "No patch to clone. This should never happen!" );
     }
-    Patch *existing_patch = ( *this )( existing_patch_id-refHindex_ );
+    clone_patch_id_ = existing_patch_id-refHindex_;
 
+} // END createPatches
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Create empty (not really, created like at t0) new patches in recv_patches_, based on createPatches initialization
+// ---------------------------------------------------------------------------------------------------------------------
+void VectorPatch::clonePatches( Params &params, SmileiMPI *smpi, SimWindow *simWindow )
+{
+    Patch *existing_patch = ( *this )( clone_patch_id_ );
 
     // Create new Patches
-    n_moved = simWindow->getNmoved();
+    unsigned int n_moved = simWindow->getNmoved();
     // Store in local vector future patches
     // Loop on the patches I have to receive and do not already own.
     for( unsigned int ipatch=0 ; ipatch < recv_patch_id_.size() ; ipatch++ ) {
@@ -2708,20 +2851,15 @@ void VectorPatch::createPatches( Params &params, SmileiMPI *smpi, SimWindow *sim
         recv_patches_.push_back( newPatch );
     }
 
-
-} // END createPatches
+} // END clonePatches
 
 
 // ---------------------------------------------------------------------------------------------------------------------
-// Exchange patches, based on createPatches initialization
-//   take care of reinitialize patch master and diag file managment
+// Post the non-blocking sends of the particles of the leaving patches, based on createPatches initialization
 // ---------------------------------------------------------------------------------------------------------------------
-void VectorPatch::exchangePatches( SmileiMPI *smpi, Params &params )
+void VectorPatch::sendSpecies( SmileiMPI *smpi, Params &params )
 {
-
-    //int newMPIrankbis, oldMPIrankbis, tmp;
     int newMPIrank = smpi->getRank() -1;
-    int oldMPIrank = smpi->getRank() -1;
     int istart = 0;
     int nmessage = nrequests;
 
@@ -2729,7 +2867,6 @@ void VectorPatch::exchangePatches( SmileiMPI *smpi, Params &params )
         istart += smpi->patch_count[irk];
     }
 
-
     // Send particles
     for( unsigned int ipatch=0 ; ipatch < send_patch_id_.size() ; ipatch++ ) {
         // locate rank which will own send_patch_id_[ipatch]
@@ -2743,6 +2880,27 @@ void VectorPatch::exchangePatches( SmileiMPI *smpi, Params &params )
         smpi->isend_species( ( *this )( send_patch_id_[ipatch] ), newMPIrank, ( refHindex_+send_patch_id_[ipatch] )*nmessage, params );
     }
 
+} // END sendSpecies
+
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Exchange patches, based on createPatches initialization and on the particles posted by sendSpecies
+//   take care of reinitialize patch master and diag file managment
+// ---------------------------------------------------------------------------------------------------------------------
+void VectorPatch::exchangePatches( SmileiMPI *smpi, Params &params )
+{
+
+    //int newMPIrankbis, oldMPIrankbis, tmp;
+    int newMPIrank = smpi->getRank() -1;
+    int oldMPIrank = smpi->getRank() -1;
+    int istart = 0;
+    int nmessage = nrequests;
+
+    for( int irk=0 ; irk<smpi->getRank() ; irk++ ) {
+        istart += smpi->patch_count[irk];
+    }
+
+    // Receive particles
     for( unsigned int ipatch=0 ; ipatch < recv_patch_id_.size() ; ipatch++ ) {
         //if  hindex of patch to be received > first hindex actually owned, that means it comes from the next MPI process and not from the previous anymore.
         if( recv_patch_id_[ipatch] > refHindex_ ) {
@@ -3435,9 +3593,11 @@ void VectorPatch::applyCollisions( Params &params, int itime, Timers &timers )
     
     #pragma omp for schedule(runtime)
     for( unsigned int ipatch=0 ; ipatch<size() ; ipatch++ ) {
+        double timer = MPI_Wtime();
         for( unsigned int icoll=0 ; icoll<ncoll; icoll++ ) {
             patches_[ipatch]->vecCollisions[icoll]->collide( params, patches_[ipatch], itime, localDiags );
         }
+        patches_[ipatch]->compute_time_ += MPI_Wtime() - timer;
     }
     
     #pragma omp single
@@ -3596,6 +3756,118 @@ void VectorPatch::checkMemoryConsumption( SmileiMPI *smpi )
 }
 
 
+const char *VectorPatch::memory_subsystems_[VectorPatch::N_MEMORY_SUBSYSTEMS] = {
+    "particles", "buffers", "fields", "diagnostics", "other", "total"
+};
+
+// The resident memory is only measured when it is output, as it requires reading /proc
+bool VectorPatch::memoryAccountingNow( Params &params, int itime )
+{
+    if( params.print_memory_usage && params.printNow( itime ) ) {
+        return true;
+    }
+    for( unsigned int idiags=0 ; idiags<localDiags.size() ; idiags++ ) {
+        if( dynamic_cast<DiagnosticPerformances *>( localDiags[idiags] )
+                && localDiags[idiags]->timeSelection->isSelected( itime ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Measure the memory used by each subsystem of this process, and update the high-water marks
+void VectorPatch::accountMemory( SmileiMPI *smpi )
+{
+    updateMemoryCounters( smpi );
+    accountProcessMemory();
+}
+
+// Capacities of the containers of each subsystem: a loop over patches, without system call
+void VectorPatch::updateMemoryCounters( SmileiMPI *smpi )
+{
+    if( memory_current_.size() == 0 ) {
+        memory_current_.resize( N_MEMORY_SUBSYSTEMS, 0. );
+        memory_peak_   .resize( N_MEMORY_SUBSYSTEMS, 0. );
+    }
+    
+    double bytes[N_MEMORY_SUBSYSTEMS];
+    for( unsigned int i=0 ; i<N_MEMORY_SUBSYSTEMS ; i++ ) {
+        bytes[i] = 0.;
+    }
+    
+    // Particles, and the buffers of the particle exchanges
+    for( unsigned int ipatch=0 ; ipatch<size() ; ipatch++ ) {
+        for( unsigned int ispec=0 ; ispec<patches_[ipatch]->vecSpecies.size(); ispec++ ) {
+            Species *spec = patches_[ipatch]->vecSpecies[ispec];
+            bytes[MEMORY_PARTICLES] += ( double )spec->getMemFootPrint();
+            
+            double bytes_per_particle = spec->particles->double_prop.size()*sizeof( double )
+                                        + spec->particles->short_prop.size()*sizeof( short )
+                                        + spec->particles->uint64_prop.size()*sizeof( uint64_t );
+            for( unsigned int iDim=0 ; iDim<spec->MPI_buffer_.partRecv.size() ; iDim++ ) {
+                for( unsigned int iNeighbor=0 ; iNeighbor<spec->MPI_buffer_.partRecv[iDim].size() ; iNeighbor++ ) {
+                    bytes[MEMORY_BUFFERS] += bytes_per_particle * ( spec->MPI_buffer_.partRecv[iDim][iNeighbor].capacity()
+                                             + spec->MPI_buffer_.partSend[iDim][iNeighbor].capacity() );
+                }
+            }
+            bytes[MEMORY_BUFFERS] += ( double )spec->indexes_of_particles_to_exchange.capacity() * sizeof( int );
+        }
+    }
+    bytes[MEMORY_BUFFERS] += ( double )smpi->getDynamicsBuffersMemFootPrint();
+    
+    // Fields
+    for( unsigned int ipatch=0 ; ipatch<size() ; ipatch++ ) {
+        bytes[MEMORY_FIELDS] += ( double )patches_[ipatch]->EMfields->getMemFootPrint();
+    }
+    
+    // Diagnostics
+    for( unsigned int idiags=0 ; idiags<globalDiags.size() ; idiags++ ) {
+        bytes[MEMORY_DIAGNOSTICS] += ( double )globalDiags[idiags]->getMemFootPrint();
+    }
+    for( unsigned int idiags=0 ; idiags<localDiags.size() ; idiags++ ) {
+        bytes[MEMORY_DIAGNOSTICS] += ( double )localDiags[idiags]->getMemFootPrint();
+    }
+    
+    for( unsigned int i=0 ; i<MEMORY_OTHER ; i++ ) {
+        memory_current_[i] = bytes[i] / 1024./1024./1024.;
+        memory_peak_[i] = max( memory_peak_[i], memory_current_[i] );
+    }
+}
+
+// The resident memory includes everything else (tables, python, MPI library, ...)
+void VectorPatch::accountProcessMemory()
+{
+    memory_current_[MEMORY_TOTAL] = Tools::getMemFootPrint();
+    memory_peak_   [MEMORY_TOTAL] = max( memory_peak_[MEMORY_TOTAL], Tools::getMemPeak() );
+    double accounted = 0.;
+    for( unsigned int i=0 ; i<MEMORY_OTHER ; i++ ) {
+        accounted += memory_current_[i];
+    }
+    memory_current_[MEMORY_OTHER] = max( 0., memory_current_[MEMORY_TOTAL] - accounted );
+    memory_peak_   [MEMORY_OTHER] = max( memory_peak_[MEMORY_OTHER], memory_current_[MEMORY_OTHER] );
+}
+
+// Print the current and high-water memory of each subsystem (maximum over the processes)
+void VectorPatch::printMemoryUsage( SmileiMPI *smpi )
+{
+    if( memory_current_.size() == 0 ) {
+        accountMemory( smpi );
+    }
+    vector<double> current( N_MEMORY_SUBSYSTEMS ), peak( N_MEMORY_SUBSYSTEMS );
+    MPI_Reduce( &memory_current_[0], &current[0], N_MEMORY_SUBSYSTEMS, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD );
+    MPI_Reduce( &memory_peak_   [0], &peak   [0], N_MEMORY_SUBSYSTEMS, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD );
+    
+    if( smpi->isMaster() ) {
+        ostringstream msg;
+        msg << "Memory [MB] (max over processes, current/peak):";
+        for( unsigned int i=0 ; i<N_MEMORY_SUBSYSTEMS ; i++ ) {
+            msg << " " << memory_subsystems_[i] << " " << ( int )( current[i]*1024. ) << "/" << ( int )( peak[i]*1024. );
+        }
+        MESSAGE( 1, msg.str() );
+    }
+}
+
+
 void VectorPatch::saveOldRho( Params &params )
 {
     int n=0;
@@ -19,6 +19,7 @@
 #include "Timers.h"
 #include "RadiationTables.h"
 #include "ParticleCreator.h"
+#include "PatchScheduler.h"
 
 class Field;
 class Timer;
@@ -106,7 +107,7 @@ public :
     void configuration( Params &params, Timers &timers, int itime );
     
     //! Reconfigure all patches for the new time step
-    void reconfiguration( Params &params, Timers &timers, int itime );
+    void reconfiguration( Params &params, Timers &timers, int itime, SmileiMPI *smpi );
     
     //! Particle sorting for all patches
     void sortAllParticles( Params &params );
@@ -120,6 +121,9 @@ public :
                    double time_dual,
                    Timers &timers, int itime );
     
+    //! Cost-aware distribution of the patches between threads in dynamics
+    PatchScheduler patch_scheduler_;
+    
     //! For all patches, exchange particles and sort them.
     void finalizeAndSortParticles( Params &params, SmileiMPI *smpi, SimWindow *simWindow,
                                   double time_dual,
@@ -130,8 +134,8 @@ public :
     //! Particle merging
     void mergeParticles(Params &params, SmileiMPI *smpi, double time_dual,Timers &timers, int itime );
 
-    //! Clean MPI buffers and resize particle arrays to save memory
-    void cleanParticlesOverhead(Params &params, Timers &timers, int itime );
+    //! Clean MPI buffers and resize particle arrays to save memory (after updating the memory accounting)
+    void cleanParticlesOverhead(Params &params, SmileiMPI *smpi, Timers &timers, int itime );
                               
     //! Particle injection from the boundaries
     void injectParticlesFromBoundaries( Params &params, Timers &timers, unsigned int itime );
@@ -229,9 +233,21 @@ public :
     //! Explicits patch movement regarding new patch distribution stored in smpi->patch_count
     void createPatches( Params &params, SmileiMPI *smpi, SimWindow *simWindow );
     
+    //! Post the sends of the particles of the patches leaving this rank, based on createPatches initialization
+    void sendSpecies( SmileiMPI *smpi, Params &params );
+    
+    //! Create the empty patches which will receive the incoming patches, based on createPatches initialization
+    void clonePatches( Params &params, SmileiMPI *smpi, SimWindow *simWindow );
+    
     //! Exchange patches, based on createPatches initialization
     void exchangePatches( SmileiMPI *smpi, Params &params );
     
+    //! True if the last balancing was limited by LoadBalancing.max_patches_moved and must continue at the next iteration
+    bool migration_pending_;
+    
+    //! Decision to balance at the current iteration, set by a single thread and read by all after the barrier
+    bool balance_now_;
+    
     //! Write in a file patches communications
     void outputExchanges( SmileiMPI *smpi );
     
@@ -340,11 +356,42 @@ public :
     
     void checkMemoryConsumption( SmileiMPI *smpi );
     
+    //! Measure the memory used by each subsystem of this process, and update the high-water marks
+    void accountMemory( SmileiMPI *smpi );
+    
+    //! Measure the capacity of the particles, buffers, fields and diagnostics, and update their high-water marks
+    void updateMemoryCounters( SmileiMPI *smpi );
+    
+    //! Measure the resident memory of this process, and deduce the memory not accounted in the subsystems
+    void accountProcessMemory();
+    
+    //! Whether the memory must be measured at this timestep (printed, or written by DiagPerformances)
+    bool memoryAccountingNow( Params &params, int itime );
+    
+    //! Print the current and high-water memory of each subsystem (maximum over the processes)
+    void printMemoryUsage( SmileiMPI *smpi );
+    
+    //! Subsystems of the memory accounting
+    enum MemorySubsystem { MEMORY_PARTICLES, MEMORY_BUFFERS, MEMORY_FIELDS, MEMORY_DIAGNOSTICS, MEMORY_OTHER, MEMORY_TOTAL, N_MEMORY_SUBSYSTEMS };
+    
+    //! Names of the subsystems
+    static const char *memory_subsystems_[N_MEMORY_SUBSYSTEMS];
+    
+    //! Current and high-water memory of each subsystem of this process (GB)
+    //! The total is the resident memory, and "other" is the part not accounted in the other subsystems
+    std::vector<double> memory_current_, memory_peak_;
+    
     void checkExpectedDiskUsage( SmileiMPI *smpi, Params &params, Checkpoint &checkpoint );
     
     // Keep track if we need the needsRhoJsNow
     int diag_flag;
     
+    //! True when the species sums of the scalar diagnostics are accumulated during the dynamics
+    bool scalars_flag;
+    
+    //! True when the time of each species is measured to calibrate the cost model of the adaptive vectorization
+    bool sample_vecto_cost_;
+    
     int nrequests;
     
     //! Tells which iteration was last time the patches moved (by moving window or load balancing)
@@ -389,10 +436,21 @@ private :
     
     std::vector<int> recv_patch_id_;
     std::vector<int> send_patch_id_;
+    //! Index of a patch staying on this rank, used as a model for the incoming patches
+    int clone_patch_id_;
     
     //! Current intensity of antennas
     double antenna_intensity;
     
+    //! Move the particles of one patch (restartRhoJ and species dynamics), return the time spent
+    double dynamicsOnePatch( unsigned int ipatch,
+                             Params &params,
+                             SmileiMPI *smpi,
+                             SimWindow *simWindow,
+                             RadiationTables &RadiationTables,
+                             MultiphotonBreitWheelerTables &MultiphotonBreitWheelerTables,
+                             double time_dual );
+    
     std::vector<Timer *> diag_timers;
 };
 
@@ -408,3 +408,60 @@ double Function_TimeSin2Plateau::valueAt( double time )
         return 0.;
     }
 }
+
+// Compiled expression
+Function_Expression::Function_Expression( PyObject *py_profile, unsigned int nvariables, string name )
+{
+    string expression;
+    vector<string> variables;
+    PyTools::getAttr( py_profile, "expression", expression );
+    PyTools::getAttr( py_profile, "variables", variables );
+    if( variables.size() != nvariables ) {
+        ERROR( "Profile `"<<name<<"`: expression() must have "<<nvariables<<" variables (found "<<variables.size()<<")" );
+    }
+    expression_ = new Expression( expression, variables, vector<string>(), "Profile `"+name+"`" );
+    nvariables_ = nvariables;
+}
+double Function_Expression::valueAt( double x )
+{
+    double r;
+    const double *arrays[1] = { &x };
+    expression_->evaluate( 1, arrays, NULL, &r );
+    return r;
+}
+double Function_Expression::valueAt( vector<double> x )
+{
+    double r;
+    vector<const double *> arrays( nvariables_ );
+    for( unsigned int i=0; i<nvariables_; i++ ) {
+        arrays[i] = &x[i];
+    }
+    expression_->evaluate( 1, &arrays[0], NULL, &r );
+    return r;
+}
+double Function_Expression::valueAt( vector<double> x, double time )
+{
+    // time only (space discarded), as for python functions
+    if( nvariables_ == 1 ) {
+        return valueAt( time );
+    }
+    x.resize( nvariables_-1 );
+    x.push_back( time );
+    return valueAt( x );
+}
+complex<double> Function_Expression::complexValueAt( vector<double> x, double time )
+{
+    return valueAt( x, time );
+}
+complex<double> Function_Expression::complexValueAt( vector<double> x )
+{
+    return valueAt( x );
+}
+bool Function_Expression::valuesAt( unsigned int npoints, vector<const double *> &x, double *result )
+{
+    if( x.size() != nvariables_ ) {
+        return false;
+    }
+    expression_->evaluate( npoints, &x[0], NULL, result );
+    return true;
+}
@@ -2,6 +2,7 @@
 #define Function_H
 
 #include "PyTools.h"
+#include "Expression.h"
 #include <vector>
 #include <string>
 #include <complex>
@@ -47,6 +48,13 @@ public:
         return 0.; // virtual => will be redefined
     };
     
+    //! Gets the values of a N-D function at `npoints` points, given one array per coordinate.
+    //! Returns false if the function cannot evaluate arrays of points (it must then be called point by point)
+    virtual bool valuesAt( unsigned int, std::vector<const double *> &, double * )
+    {
+        return false;
+    };
+    
     //! Provide information about the function
     virtual std::string getInfo()
     {
@@ -1203,6 +1211,36 @@ private:
     std::vector<double> coeffs;
 };
 
+// Expression compiled by Smilei (see expression() in pyprofiles.py): thread-safe and evaluated on arrays
+class Function_Expression : public Function
+{
+public:
+    Function_Expression( PyObject *py_profile, unsigned int nvariables, std::string name );
+    Function_Expression( Function_Expression *f )
+    {
+        expression_ = new Expression( *f->expression_ );
+        nvariables_ = f->nvariables_;
+    };
+    ~Function_Expression()
+    {
+        delete expression_;
+    };
+    double valueAt( double ); // 1 variable (time or space)
+    double valueAt( std::vector<double> ); // space
+    double valueAt( std::vector<double>, double ); // space + time
+    std::complex<double> complexValueAt( std::vector<double>, double ); // space + time
+    std::complex<double> complexValueAt( std::vector<double> ); // space
+    bool valuesAt( unsigned int, std::vector<const double *> &, double * );
+    std::string getInfo()
+    {
+        std::string info = " (expression: " + expression_->str() + ")";
+        return info;
+    };
+private:
+    Expression *expression_;
+    unsigned int nvariables_;
+};
+
 class Function_TimeSin2Plateau : public Function
 {
 public:
@@ -155,6 +155,10 @@ Profile::Profile( PyObject *py_profile, unsigned int nvariables, string name, bo
             } else {
                 ERROR( "Profile `"<<name<<"`: tsin2plateau() profile is only for time" );
             }
+            
+        } else if( profileName == "expression" ) {
+        
+            function = new Function_Expression( py_profile, nvariables_, name );
         }
         
     }
@@ -391,6 +395,8 @@ Profile::Profile( Profile *p )
             function = new Function_TimePolynomial( static_cast<Function_TimePolynomial *>( p->function ) );
         } else if( profileName == "tsin2plateau" ) {
             function = new Function_TimeSin2Plateau( static_cast<Function_TimeSin2Plateau *>( p->function ) );
+        } else if( profileName == "expression" ) {
+            function = new Function_Expression( static_cast<Function_Expression *>( p->function ) );
         }
     } else {
         if( nvariables_ == 1 ) {
@@ -74,8 +74,15 @@ public:
             Py_DECREF( values );
         } else
 #endif
-            // Otherwise, calculate profile for each point
+            // Otherwise, calculate profile for all points at once (compiled expressions), or for each point
         {
+            std::vector<const double *> arrays( nvar );
+            for( unsigned int ivar=0; ivar<nvar; ivar++ ) {
+                arrays[ivar] = coordinates[ivar]->data();
+            }
+            if( function->valuesAt( size, arrays, ret.data() ) ) {
+                return;
+            }
             std::vector<double> x( nvar );
             for( unsigned int i=0; i<size; i++ ) {
                 for( unsigned int ivar=0; ivar<nvar; ivar++ ) {
@@ -29,6 +29,10 @@ def _prepare_checkpoint_dir():
                 _mkdir("checkpoint", group_dir)
         else:
             _mkdir("checkpoint", checkpoint_dir)
+    if smilei_mpi_rank == 0 and Checkpoints.memory_step>0:
+        memory_dir = "." + os.sep + "checkpoints" + os.sep + "memory" + os.sep
+        _mkdir("checkpoint", memory_dir)
+        _mkdir("checkpoint", memory_dir + "partner")
 
 def _smilei_check():
     """Do checks over the script"""
@@ -51,15 +55,25 @@ def _smilei_check():
             if Checkpoints.restart_dir:
                 Checkpoints.restart=True
                 my_pattern=Checkpoints.restart_dir + os.sep + "checkpoints" + os.sep
-                if Checkpoints.file_grouping :
-                    my_pattern += "*"+ os.sep
-                my_pattern += "dump-*-*.h5";
-                # pick those file that match the mpi rank
-                my_files = filter(lambda a: smilei_mpi_rank==int(re.search(r'dump-[0-9]*-([0-9]*).h5$',a).groups()[-1]),glob.glob(my_pattern))
+                # aggregated dumps: all ranks read the first file of each dump
+                my_files = glob.glob(my_pattern + "dump-*-aggregated-00000.h5")
+                if my_files:
+                    my_pattern += "dump-*-aggregated-00000.h5"
+                else:
+                    if Checkpoints.file_grouping :
+                        my_pattern += "*"+ os.sep
+                    my_pattern += "dump-*-*.h5";
+                    # pick those file that match the mpi rank
+                    my_files = filter(lambda a: re.search(r'dump-[0-9]*-([0-9]*).h5$',a) and smilei_mpi_rank==int(re.search(r'dump-[0-9]*-([0-9]*).h5$',a).groups()[-1]),glob.glob(my_pattern))
 
                 if Checkpoints.restart_number:
                     # pick those file that match the restart_number
-                    my_files = filter(lambda a: Checkpoints.restart_number==int(re.search(r'dump-([0-9]*)-[0-9]*.h5$',a).groups()[-1]),my_files)
+                    my_files = filter(lambda a: Checkpoints.restart_number==int(re.search(r'dump-([0-9]*)-',a).groups()[-1]),my_files)
+                else:
+                    # in-memory dumps written when the job was terminated, by this rank or by its partner
+                    memory_pattern = Checkpoints.restart_dir + os.sep + "checkpoints" + os.sep + "memory" + os.sep
+                    memory_files = glob.glob(memory_pattern + "dump-*-*.h5") + glob.glob(memory_pattern + "partner" + os.sep + "dump-*-*.h5")
+                    my_files = list(my_files) + [a for a in memory_files if re.search(r'dump-[0-9]*-([0-9]*).h5$',a) and smilei_mpi_rank==int(re.search(r'dump-[0-9]*-([0-9]*).h5$',a).groups()[-1])]
 
                 Checkpoints.restart_files = list(my_files)
 
@@ -140,7 +154,7 @@ def _keep_python_running():
             return True
     # Verify the tracked species that require a particle selection
     for d in DiagTrackParticles:
-        if d.filter is not None:
+        if d.filter is not None and type(d.filter) is not str:
             return True
     # Verify the particle binning having a function for deposited_quantity or axis type
     for d in DiagParticleBinning._list + DiagScreen._list:
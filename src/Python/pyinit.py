@@ -116,7 +116,8 @@ class SmileiComponent(object):
                 "chipa_disc_min_threshold":"minimum_chi_discontinuous",
             }
             for key, value in kwargs.items():
-                if key in deprecated:
+                # `output` is now the kind of output of diagnostics, no longer the deposited quantity
+                if key in deprecated and not (key=="output" and value in ["hdf5", "shared_memory"]):
                     raise Exception("Deprecated `"+key+"` parameter should be replaced by `"+deprecated[key]+"`")
                 if key=="_list":
                     print("Python warning: in "+cls.__name__+": cannot have argument named '_list'. Discarding.")
@@ -185,6 +186,7 @@ class Main(SmileiSingleton):
     number_of_AM_relativistic_field_initialization = 1
     timestep_over_CFL = None
     cell_sorting = False
+    patch_scheduling = "runtime"
 
 
     # PXR tuning
@@ -216,6 +218,7 @@ class Main(SmileiSingleton):
     print_every = None
     random_seed = None
     print_expected_disk_usage = True
+    print_memory_usage = False
 
     def __init__(self, **kwargs):
         # Load all arguments to Main()
@@ -297,6 +300,9 @@ class LoadBalancing(SmileiSingleton):
     initial_balance      = True
     cell_load            = 1.0
     frozen_particle_load = 0.1
+    load_model           = "particles"
+    load_smoothing       = 10
+    max_patches_moved    = 0
 
 # Radiation reaction configuration (continuous and MC algorithms)
 class Vectorization(SmileiSingleton):
@@ -306,6 +312,9 @@ class Vectorization(SmileiSingleton):
     mode                = "off"
     reconfigure_every   = 20
     initial_mode        = "off"
+    cost_model          = "reference"
+    calibration_iterations = 200
+    cost_model_file     = "vectorization_cost_model.txt"
 
 
 class MovingWindow(SmileiSingleton):
@@ -328,6 +337,9 @@ class Checkpoints(SmileiSingleton):
     dump_deflate = 0
     exit_after_dump = True
     file_grouping = None
+    aggregators_per_node = 0
+    asynchronous = False
+    memory_step = 0
     restart_files = []
 
 class CurrentFilter(SmileiSingleton):
@@ -454,6 +466,13 @@ class DiagProbe(SmileiComponent):
     vectors = []
     fields = []
     flush_every = 1
+    chunks = []
+    compression = 0
+    shuffle = True
+    hdf5_filter = 0
+    hdf5_filter_parameters = []
+    precision = "double"
+    mantissa_bits = 0
 
 class DiagParticleBinning(SmileiComponent):
     """Particle Binning diagnostic"""
@@ -463,6 +482,12 @@ class DiagParticleBinning(SmileiComponent):
     axes = []
     every = None
     flush_every = 1
+    sparse = False
+    sparse_output = "sparse"
+    output = "hdf5"
+    shared_memory_slots = 0
+    shared_memory_slot_size = 0.
+    shared_memory_policy = "drop_oldest"
 
 class DiagScreen(SmileiComponent):
     """Screen diagnostic"""
@@ -490,6 +515,18 @@ class DiagFields(SmileiComponent):
     time_average = 1
     subgrid = None
     flush_every = 1
+    asynchronous = False
+    output = "hdf5"
+    shared_memory_slots = 0
+    shared_memory_slot_size = 0.
+    shared_memory_policy = "drop_oldest"
+    chunks = []
+    compression = 0
+    shuffle = True
+    hdf5_filter = 0
+    hdf5_filter_parameters = []
+    precision = "double"
+    mantissa_bits = 0
 
 class DiagTrackParticles(SmileiComponent):
     """Track diagnostic"""
@@ -498,12 +535,26 @@ class DiagTrackParticles(SmileiComponent):
     flush_every = 1
     filter = None
     attributes = ["x", "y", "z", "px", "py", "pz"]
+    output = "hdf5"
+    shared_memory_slots = 0
+    shared_memory_slot_size = 0.
+    shared_memory_policy = "drop_oldest"
+    chunks = []
+    compression = 0
+    shuffle = True
+    hdf5_filter = 0
+    hdf5_filter_parameters = []
+    precision = "double"
+    mantissa_bits = 0
 
 class DiagPerformances(SmileiSingleton):
     """Performances diagnostic"""
     every = 0
     flush_every = 1
     patch_information = True
+    hardware_counters = False
+    trace = []
+    trace_events = 100000
 
 # external fields
 class ExternalField(SmileiComponent):
@@ -304,6 +304,145 @@ def polynomial(**kwargs):
     return f
 
 
+def _expression_to_python(expr, variables):
+    # Translates the expression into python, following the grammar and the
+    # precedence of the compiled parser (src/Tools/Expression.cpp): logical
+    # operators and comparisons give 1. or 0., and comparisons do not chain
+    import re
+    number = r"(?:\d+\.?\d*|\.\d+)(?:[eE][+-]?\d+)?"
+    tokens = re.findall(number+r"|[A-Za-z_]\w*|\*\*|<=|>=|==|!=|\S", expr) + [""]
+    position = [0]
+    def fail(message):
+        raise Exception("expression profile: "+message+" in expression \""+expr+"\"")
+    def accept(*token):
+        if tokens[position[0]] in token:
+            position[0] += 1
+            return tokens[position[0]-1]
+        return None
+    def expect(token):
+        if not accept(token):
+            fail("expected `"+token+"`")
+    def parseOr():
+        a = parseAnd()
+        while accept("|", "or"):
+            a = "_or("+a+","+parseAnd()+")"
+        return a
+    def parseAnd():
+        a = parseNot()
+        while accept("&", "and"):
+            a = "_and("+a+","+parseNot()+")"
+        return a
+    def parseNot():
+        if accept("~", "not"):
+            return "_not("+parseNot()+")"
+        return parseComparison()
+    def parseComparison():
+        a = parseSum()
+        op = accept("<", "<=", ">", ">=", "==", "!=")
+        if op:
+            a = "float(("+a+")"+op+"("+parseSum()+"))"
+        return a
+    def parseSum():
+        a = parseProduct()
+        op = accept("+", "-")
+        while op:
+            a = "("+a+op+parseProduct()+")"
+            op = accept("+", "-")
+        return a
+    def parseProduct():
+        a = parseUnary()
+        op = accept("*", "/")
+        while op:
+            a = "("+a+"*"+parseUnary()+")" if op=="*" else "_div("+a+","+parseUnary()+")"
+            op = accept("*", "/")
+        return a
+    def parseUnary():
+        if accept("-"):
+            return "(-"+parseUnary()+")"
+        if accept("+"):
+            return parseUnary()
+        return parsePower()
+    def parsePower():
+        a = parseAtom()
+        if accept("**"):
+            a = "_pow("+a+","+parseUnary()+")"
+        return a
+    def parseAtom():
+        token = tokens[position[0]]
+        if token == "":
+            fail("unexpected end")
+        if accept("("):
+            a = parseOr()
+            expect(")")
+            return "("+a+")"
+        position[0] += 1
+        if re.match(number+"$", token):
+            return "float("+repr(token)+")"
+        if not re.match(r"[A-Za-z_]\w*$", token):
+            fail("unexpected `"+token+"`")
+        if accept("("):
+            if token in ["abs", "sqrt", "exp", "log", "sin", "cos", "tan", "tanh"]:
+                args = [parseOr()]
+            elif token in ["min", "max"]:
+                args = [parseOr()]
+                expect(","); args += [parseOr()]
+            elif token == "where":
+                args = [parseOr()]
+                expect(","); args += [parseOr()]
+                expect(","); args += [parseOr()]
+            else:
+                fail("unknown function `"+token+"`")
+            expect(")")
+            return "_"+token+"("+",".join(args)+")"
+        if token in variables:
+            return "float("+token+")"
+        if token == "pi":
+            return "_pi"
+        fail("unknown variable `"+token+"`")
+    a = parseOr()
+    if tokens[position[0]] != "":
+        fail("unexpected `"+tokens[position[0]]+"`")
+    return a
+
+def expression(expr, variables=None):
+    global Main
+    if variables is None:
+        if len(Main)==0:
+            raise Exception("expression profile has been defined before `Main()`")
+        if   Main.geometry == "1Dcartesian": variables = "x"
+        elif Main.geometry == "3Dcartesian": variables = "x,y,z"
+        else                               : variables = "x,y"
+    if type(variables) is str:
+        variables = variables.split(",")
+    variables = [v.strip() for v in variables]
+    # Python equivalent, used only if the profile is called from the namelist.
+    # Like the compiled version, invalid operations give nan or inf instead of raising
+    import math
+    nan, inf = float("nan"), float("inf")
+    def _div(a, b):
+        if b != 0.: return a/b
+        return nan if a == 0. or a != a else math.copysign(inf, a)*math.copysign(1., b)
+    def _pow(a, b):
+        try: return float(math.pow(a, b))
+        except (ValueError, OverflowError): return nan if a < 0. else inf
+    functions = {
+        "_pi":math.pi, "_div":_div, "_pow":_pow,
+        "_or" :lambda a,b: float(a!=0. or  b!=0.),
+        "_and":lambda a,b: float(a!=0. and b!=0.),
+        "_not":lambda a  : float(a==0.),
+        "_abs":abs, "_min":min, "_max":max,
+        "_sqrt":lambda a: math.sqrt(a) if a>=0. else nan,
+        "_exp" :lambda a: math.exp(a) if a<700. else _pow(math.e, a),
+        "_log" :lambda a: math.log(a) if a>0. else (-inf if a==0. else nan),
+        "_sin" :math.sin, "_cos":math.cos, "_tan":math.tan, "_tanh":math.tanh,
+        "_where":lambda c,a,b: a if c!=0. else b,
+    }
+    f = eval("lambda "+",".join(variables)+": float("+_expression_to_python(expr, variables)+")", functions)
+    f.profileName = "expression"
+    f.expression  = expr
+    f.variables   = variables
+    return f
+
 
 def tconstant(start=0.):
     def f(t):
@@ -455,6 +594,9 @@ def tsin2plateau(start=0., fwhm=0., plateau=None, slope1=None, slope2=None):
     f.slope2      = slope2
     return f
 
+def texpression(expr):
+    return expression(expr, "t")
+
 
 def transformPolarization(polarization_phi, ellipticity):
     from math import pi, sqrt, sin, cos, tan, atan
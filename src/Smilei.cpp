@@ -35,6 +35,8 @@
 #include "Timers.h"
 #include "RadiationTables.h"
 #include "MultiphotonBreitWheelerTables.h"
+#include "SpeciesMetrics.h"
+#include "Tracer.h"
 
 using namespace std;
 
@@ -151,6 +153,7 @@ int main( int argc, char *argv[] )
         vecPatches.sortAllParticles( params );
 
         // Patch reconfiguration for the adaptive vectorization
+        SpeciesMetrics::initCalibration( params, &smpi, checkpoint.this_run_start_step );
         if( params.has_adaptive_vectorization ) {
             vecPatches.configuration( params, timers, 0 );
         }
@@ -195,6 +198,7 @@ int main( int argc, char *argv[] )
         }
 
         // Patch reconfiguration
+        SpeciesMetrics::initCalibration( params, &smpi, 0 );
         if( params.has_adaptive_vectorization ) {
             vecPatches.configuration( params, timers, 0 );
         }
@@ -284,11 +288,12 @@ int main( int argc, char *argv[] )
             {
                 time_prim += params.timestep;
                 time_dual += params.timestep;
+                Tracer::step( itime, &smpi );
             }
 
             // Patch reconfiguration
             if( params.has_adaptive_vectorization && params.adaptive_vecto_time_selection->theTimeIsNow( itime ) ) {
-                vecPatches.reconfiguration( params, timers, itime );
+                vecPatches.reconfiguration( params, timers, itime, &smpi );
             }
 
             // apply collisions if requested
@@ -354,7 +359,7 @@ int main( int argc, char *argv[] )
             vecPatches.injectParticlesFromBoundaries(params, timers, itime );
 
             // Clean buffers and resize arrays
-            vecPatches.cleanParticlesOverhead(params, timers, itime );
+            vecPatches.cleanParticlesOverhead(params, &smpi, timers, itime );
 
             // Finalize field synchronization and exchanges
             vecPatches.finalizeSyncAndBCFields( params, &smpi, simWindow, time_dual, timers, itime );
@@ -381,7 +386,12 @@ int main( int argc, char *argv[] )
 
 
             if( params.has_load_balancing ) {
-                if( params.load_balancing_time_selection->theTimeIsNow( itime ) ) {
+                #pragma omp single
+                {
+                    smpi.measure_achieved_imbalance( params, vecPatches, time_dual );
+                    vecPatches.balance_now_ = params.load_balancing_time_selection->theTimeIsNow( itime ) || vecPatches.migration_pending_;
+                }
+                if( vecPatches.balance_now_ ) {
                     timers.loadBal.restart();
                     #pragma omp single
                     vecPatches.loadBalance( params, time_dual, &smpi, simWindow, itime );
@@ -397,7 +407,12 @@ int main( int argc, char *argv[] )
 
             if( params.printNow( itime ) ) {
                 #pragma omp master
-                timers.consolidate( &smpi );
+                {
+                    timers.consolidate( &smpi );
+                    if( params.print_memory_usage ) {
+                        vecPatches.printMemoryUsage( &smpi );
+                    }
+                }
                 #pragma omp barrier
             }
 
@@ -414,6 +429,7 @@ int main( int argc, char *argv[] )
     // ------------------------------------------------------------------
     TITLE( "End time loop, time dual = " << time_dual );
     timers.global.update();
+    Tracer::write( &smpi );
 
     TITLE( "Time profiling : (print time > 0.001%)" );
     timers.profile( &smpi );
@@ -2,6 +2,7 @@
 
 #include <cmath>
 #include <cstring>
+#include <climits>
 
 #include <iostream>
 #include <sstream>
@@ -19,6 +20,7 @@
 #include "Species.h"
 #include "PeekAtSpecies.h"
 #include "Hilbert_functions.h"
+#include "LoadBalancing_functions.h"
 #include "VectorPatch.h"
 #include "DomainDecomposition.h"
 
@@ -41,6 +43,8 @@ using namespace std;
 SmileiMPI::SmileiMPI( int *argc, char ***argv )
 {
     test_mode = false;
+    imbalance_window_ = -1;
+    predicted_imbalance_ = 0.;
     
     // Send information on current simulation
     int mpi_provided;
@@ -378,13 +382,54 @@ void SmileiMPI::init_patch_count( Params &params, DomainDecomposition *domain_de
 } // END init_patch_count
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+//  Particle contribution to the load of each patch, in particle-load units
+// ---------------------------------------------------------------------------------------------------------------------
+void SmileiMPI::compute_particle_loads( Params &params, VectorPatch &vecpatches, double time_dual, bool measured, std::vector<double> &Lparticles )
+{
+    unsigned int tot_species_number = vecpatches( 0 )->vecSpecies.size();
+    
+    Lparticles.assign( vecpatches.size(), 0. );
+    for( unsigned int ipatch=0; ipatch < vecpatches.size(); ipatch++ ) {
+        for( unsigned int ispecies = 0; ispecies < tot_species_number; ispecies++ ) {
+            Lparticles[ipatch] += vecpatches( ipatch )->vecSpecies[ispecies]->getNbrOfParticles()*( 1+( params.frozen_particle_load-1 )*( time_dual < vecpatches( ipatch )->vecSpecies[ispecies]->time_frozen_ ) ) ;
+        }
+    }
+    
+    //With the measured model, the particle contribution is replaced by the compute time measured in each patch.
+    //Times are converted in particle-load units (using the ratio over all measured patches) so that cell_load keeps its meaning.
+    //Patches never measured (e.g. just created) keep the particle model.
+    if( measured ) {
+        double measured_loc[2] = {0., 0.}, measured_tot[2];
+        std::vector<double> Lmeasured( vecpatches.size() );
+        for( unsigned int ipatch=0; ipatch < vecpatches.size(); ipatch++ ) {
+            Lmeasured[ipatch] = vecpatches( ipatch )->measuredLoad();
+            if( Lmeasured[ipatch] > 0. ) {
+                measured_loc[0] += Lmeasured[ipatch];
+                measured_loc[1] += Lparticles[ipatch];
+            }
+        }
+        MPI_Allreduce( measured_loc, measured_tot, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD );
+        if( measured_tot[0] > 0. && measured_tot[1] > 0. ) {
+            double load_per_second = measured_tot[1] / measured_tot[0];
+            for( unsigned int ipatch=0; ipatch < vecpatches.size(); ipatch++ ) {
+                if( Lmeasured[ipatch] > 0. ) {
+                    Lparticles[ipatch] = Lmeasured[ipatch] * load_per_second;
+                }
+            }
+        }
+    }
+    
+} // END compute_particle_loads
+
+
 // ---------------------------------------------------------------------------------------------------------------------
 //  Recompute patch distribution
 // ---------------------------------------------------------------------------------------------------------------------
-void SmileiMPI::recompute_patch_count( Params &params, VectorPatch &vecpatches, double time_dual )
+bool SmileiMPI::recompute_patch_count( Params &params, VectorPatch &vecpatches, double time_dual )
 {
 
-    unsigned int ncells_perpatch, j;
+    unsigned int ncells_perpatch;
     int Ncur;
     double Tload, Tload_loc, Tcur, cells_load, target, Tscan, largest_patch_loc, largest_patch;
     bool recompute_tload = true;
@@ -405,9 +450,12 @@ void SmileiMPI::recompute_patch_count( Params &params, VectorPatch &vecpatches,
         ncells_perpatch *= params.n_space[idim]+2*params.oversize[idim];
     }
     
-    unsigned int tot_species_number = vecpatches( 0 )->vecSpecies.size();
     cells_load = ncells_perpatch*params.cell_load ;
     
+    //Compute particle contribution to Local Loads of each Patch
+    std::vector<double> Lparticles;
+    compute_particle_loads( params, vecpatches, time_dual, params.load_model == "measured", Lparticles );
+    
     Lp.resize( patch_count[smilei_rk] );
     if( smilei_rk > 0 ) {
         Lp_left.resize( patch_count[smilei_rk-1] );
@@ -426,11 +474,9 @@ void SmileiMPI::recompute_patch_count( Params &params, VectorPatch &vecpatches,
             Lp[ipatch] =  cells_load ;
         }
         
-        //Compute particle contribution to Local Loads of each Patch (Lp)
+        //Add particle contribution to Local Loads of each Patch (Lp)
         for( unsigned int ipatch=0; ipatch < ( unsigned int )patch_count[smilei_rk]; ipatch++ ) {
-            for( unsigned int ispecies = 0; ispecies < tot_species_number; ispecies++ ) {
-                Lp[ipatch] += vecpatches( ipatch )->vecSpecies[ispecies]->getNbrOfParticles()*( 1+( params.frozen_particle_load-1 )*( time_dual < vecpatches( ipatch )->vecSpecies[ispecies]->time_frozen_ ) ) ;
-            }
+            Lp[ipatch] += Lparticles[ipatch];
             Tload_loc += Lp[ipatch];
         }
         
@@ -476,53 +522,33 @@ void SmileiMPI::recompute_patch_count( Params &params, VectorPatch &vecpatches,
         MPI_Wait( &request0, &status );
     }
     
+    //Load of the current rank after balancing, to evaluate the predicted imbalance
+    double Tload_new = Tload_loc;
+    
+    //Number of patches allowed to cross each boundary. Patches beyond the limit will move at the next iterations.
+    unsigned int max_moved = params.max_patches_moved > 0 ? params.max_patches_moved : UINT_MAX;
+    
+    bool incomplete_boundary = false;
+    double moved_load;
+    
     if( smilei_rk > 0 ) {
         //Tcur is now initialized as the total load currently carried by previous ranks.
         Tcur = Tscan - Tload_loc;
-        //Check if my rank should start with additional patches from left neighbour.
+        //Check if my rank should start with additional patches from left neighbour, or give some of mine.
         target = smilei_rk*Tload; //target here points at the optimal begining for current rank
-        if( Tcur > target ) {
-            j = Lp_left.size()-1;
-            while( abs( Tcur-target ) > abs( Tcur-Lp_left[j] - target ) && j>0 ) { //Leave at least 1 patch to my neighbour.
-                Tcur -= Lp_left[j];
-                j--;
-                Ncur++;
-            }
-        } else {
-            //  Check if some of my patches should be given to my left neighbour.
-            j = 0;
-            while( ( abs( Tcur-target ) > abs( Tcur+Lp[j]-target ) ) && ( j < ( unsigned int )patch_count[smilei_rk]-1 ) ) { //Keep at least 1 patch from my original set of patches
-                Tcur += Lp[j];
-                j++;
-                Ncur --;
-            }
-        }
+        Ncur += balanceBoundary( Lp_left, Lp, Tcur, target, max_moved, incomplete_boundary, moved_load );
+        Tload_new += moved_load;
     }
     
     if( smilei_rk < smilei_sz-1 ) {
         //Tcur is now initialized as the total load carried by previous ranks + my load.
         Tcur = Tscan;
+        //Check if my rank should end with additional patches from right neighbour, or give some of mine.
         target = ( smilei_rk+1 )*Tload;
-        
-        //Check if my rank should start with additional patches from right neighbour ...
-        if( Tcur < target ) {
-            j = 0;
-            while( ( abs( Tcur-target ) > abs( Tcur+Lp_right[j] - target ) ) && ( j<( unsigned int )patch_count[smilei_rk+1] - 1 ) ) { //Leave at least 1 patch to my neighbour
-                Tcur += Lp_right[j];
-                j++;
-                Ncur++;
-            }
-            
-        } else {
-            //  Check if some of my patches should be given to my right neighbour.
-            j = patch_count[smilei_rk]-1;
-            while( abs( Tcur-target ) > abs( Tcur-Lp[j]-target ) && j > 0 ) { //Keep at least 1 patch from my original set of patches
-                Tcur -= Lp[j];
-                j--;
-                Ncur --;
-            }
-        }
+        Ncur -= balanceBoundary( Lp, Lp_right, Tcur, target, max_moved, incomplete_boundary, moved_load );
+        Tload_new -= moved_load;
     }
+    int incomplete = incomplete_boundary ? 1 : 0;
     
     //Ncur is the variation of number of patches owned by current rank.
     //Stores in Ncur the final patch count of this rank
@@ -536,20 +562,77 @@ void SmileiMPI::recompute_patch_count( Params &params, VectorPatch &vecpatches,
         patch_refHindexes[rk] = patch_refHindexes[rk-1] + patch_count[rk-1];
     }
     
+    //Imbalance (max load / average load) of the current distribution and predicted for the new one
+    double max_load[2], loc_load[2] = {Tload_loc, Tload_new};
+    MPI_Reduce( loc_load, max_load, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD );
+    
+    //All ranks must know if the migration has to be continued at the next iteration
+    int any_incomplete;
+    MPI_Allreduce( &incomplete, &any_incomplete, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD );
+    
     //Write patch_load.txt
     if( smilei_rk==0 ) {
         fout << "\tt = " << time_dual << endl;
+        fout << " load model = " << params.load_model << endl;
+        fout << " imbalance before balancing = " << max_load[0]/Tload << endl;
+        fout << " predicted imbalance after balancing = " << max_load[1]/Tload << endl;
         for( int irk=0; irk<smilei_sz; irk++ ) {
             fout << " patch_count[" << irk << "] = " << patch_count[irk] << endl;
         }
+        if( any_incomplete ) {
+            fout << " migration limited to " << params.max_patches_moved << " patches per boundary, continued at next iteration" << endl;
+        }
         fout.close();
+        predicted_imbalance_ = max_load[1]/Tload;
     }
     
-    return;
+    //The achieved imbalance is measured once the migration is complete and all patches have a full load history
+    imbalance_window_ = any_incomplete ? -1 : params.load_smoothing;
+    
+    return any_incomplete;
     
 } // END recompute_patch_count
 
 
+// ---------------------------------------------------------------------------------------------------------------------
+//  Measure the imbalance achieved by the last balancing, from the compute times of the patches
+// ---------------------------------------------------------------------------------------------------------------------
+void SmileiMPI::measure_achieved_imbalance( Params &params, VectorPatch &vecpatches, double time_dual )
+{
+    if( imbalance_window_ < 0 || --imbalance_window_ > 0 ) {
+        return;
+    }
+    imbalance_window_ = -1;
+    
+    //Load of this rank as defined by the balancing (cells and particles, in particle-load units), except that
+    //the particle contribution is always taken from the compute times measured since the balancing
+    std::vector<double> Lparticles;
+    compute_particle_loads( params, vecpatches, time_dual, true, Lparticles );
+    unsigned int ncells_perpatch = params.n_space[0]+2*params.oversize[0];
+    for( unsigned int idim = 1; idim < params.nDim_field; idim++ ) {
+        ncells_perpatch *= params.n_space[idim]+2*params.oversize[idim];
+    }
+    double Tload_loc = 0.;
+    for( unsigned int ipatch=0; ipatch < vecpatches.size(); ipatch++ ) {
+        Tload_loc += ncells_perpatch*params.cell_load + Lparticles[ipatch];
+    }
+    double max_load, Tload;
+    MPI_Reduce( &Tload_loc, &max_load, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD );
+    MPI_Reduce( &Tload_loc, &Tload, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
+    //Same normalization as the prediction: target load per MPI process
+    Tload /= Tcapabilities;
+    
+    if( smilei_rk==0 && Tload > 0. ) {
+        ofstream fout( "patch_load.txt", std::ofstream::out | std::ofstream::app );
+        fout << "\tt = " << time_dual << endl;
+        fout << " achieved imbalance after balancing = " << max_load/Tload
+             << " (predicted " << predicted_imbalance_ << ")" << endl;
+        fout.close();
+    }
+    
+} // END measure_achieved_imbalance
+
+
 // ----------------------------------------------------------------------
 // Returns the rank of the MPI process currently owning patch h.
 // ----------------------------------------------------------------------
@@ -1726,6 +1809,10 @@ void SmileiMPI::computeGlobalDiags( DiagnosticScalar *scalars, int timestep )
 void SmileiMPI::computeGlobalDiags( DiagnosticParticleBinning *diagParticles, int timestep )
 {
     if( timestep - diagParticles->timeSelection->previousTime() == diagParticles->time_average-1 ) {
+        if( diagParticles->sparse_ ) {
+            computeGlobalSparseDiags( diagParticles );
+            return;
+        }
         MPI_Reduce( diagParticles->filename.size()?MPI_IN_PLACE:&diagParticles->data_sum[0], &diagParticles->data_sum[0], diagParticles->output_size, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
         
         if( !isMaster() ) {
@@ -1734,6 +1821,46 @@ void SmileiMPI::computeGlobalDiags( DiagnosticParticleBinning *diagParticles, in
     }
 } // END computeGlobalDiags(DiagnosticParticleBinning* diagParticles ...)
 
+// ---------------------------------------------------------------------------------------------------------------------
+// MPI synchronization of sparse diags particle binning: only the non-empty bins are sent to the master
+// ---------------------------------------------------------------------------------------------------------------------
+void SmileiMPI::computeGlobalSparseDiags( DiagnosticParticleBinning *diagParticles )
+{
+    unordered_map<unsigned int, double> &sparse_sum = diagParticles->sparse_sum_;
+    
+    vector<unsigned int> indices;
+    vector<double> values;
+    indices.reserve( sparse_sum.size() );
+    values .reserve( sparse_sum.size() );
+    for( auto &bin : sparse_sum ) {
+        indices.push_back( bin.first );
+        values .push_back( bin.second );
+    }
+    
+    // Number of non-empty bins in each process
+    int nbins = indices.size();
+    vector<int> counts( isMaster() ? smilei_sz : 0 ), displs( isMaster() ? smilei_sz : 0 );
+    MPI_Gather( &nbins, 1, MPI_INT, isMaster() ? &counts[0] : NULL, 1, MPI_INT, 0, SMILEI_COMM_WORLD );
+    int total = 0;
+    for( unsigned int i=0; i<counts.size(); i++ ) {
+        displs[i] = total;
+        total += counts[i];
+    }
+    
+    vector<unsigned int> all_indices( isMaster() ? max( total, 1 ) : 0 );
+    vector<double> all_values( isMaster() ? max( total, 1 ) : 0 );
+    MPI_Gatherv( nbins>0 ? &indices[0] : NULL, nbins, MPI_UNSIGNED, isMaster() ? &all_indices[0] : NULL, isMaster() ? &counts[0] : NULL, isMaster() ? &displs[0] : NULL, MPI_UNSIGNED, 0, SMILEI_COMM_WORLD );
+    MPI_Gatherv( nbins>0 ? &values [0] : NULL, nbins, MPI_DOUBLE,   isMaster() ? &all_values [0] : NULL, isMaster() ? &counts[0] : NULL, isMaster() ? &displs[0] : NULL, MPI_DOUBLE,   0, SMILEI_COMM_WORLD );
+    
+    // The master merges the bins of all processes
+    sparse_sum.clear();
+    if( isMaster() ) {
+        for( int i=0; i<total; i++ ) {
+            sparse_sum[all_indices[i]] += all_values[i];
+        }
+    }
+}
+
 // ---------------------------------------------------------------------------------------------------------------------
 // MPI synchronization of diags screen
 // ---------------------------------------------------------------------------------------------------------------------
@@ -24,6 +24,7 @@ class DiagnosticParticleBinning;
 class DiagnosticScreen;
 
 #define SMILEI_COMM_DUMP_TIME 1312
+#define SMILEI_COMM_DUMP_DATA 1313
 
 //  --------------------------------------------------------------------------------------------------------------------
 //! Class SmileiMPI
@@ -37,7 +38,7 @@ class SmileiMPI
     friend class AsyncMPIbuffers;
     
 public:
-    SmileiMPI() {};
+    SmileiMPI() : imbalance_window_( -1 ), predicted_imbalance_( 0. ) {};
     //! Create intial MPI environment
     SmileiMPI( int *argc, char ***argv );
     //! Destructor for SmileiMPI
@@ -56,7 +57,11 @@ public:
     virtual void init_patch_count( Params &params, DomainDecomposition *domain_decomposition );
     
     // Recompute the patch_count vector. Browse patches and redistribute them in order to balance the load between MPI processes.
-    void recompute_patch_count( Params &params, VectorPatch &vecpatches, double time_dual );
+    bool recompute_patch_count( Params &params, VectorPatch &vecpatches, double time_dual );
+    // After a balancing, once the patch loads have been measured over load_smoothing iterations, writes the achieved imbalance next to the predicted one.
+    void measure_achieved_imbalance( Params &params, VectorPatch &vecpatches, double time_dual );
+    // Particle contribution to the load of each patch (particle model, or measured compute times converted in particle-load units).
+    void compute_particle_loads( Params &params, VectorPatch &vecpatches, double time_dual, bool measured, std::vector<double> &Lparticles );
     // Returns the rank of the MPI process currently owning patch h.
     int hrank( int h );
     
@@ -109,6 +114,8 @@ public:
     void computeGlobalDiags( DiagnosticScalar          *diag, int timestep );
     // MPI synchronization of diags particles
     void computeGlobalDiags( DiagnosticParticleBinning *diag, int timestep );
+    // MPI synchronization of diags particles in sparse mode
+    void computeGlobalSparseDiags( DiagnosticParticleBinning *diag );
     // MPI synchronization of screen diags
     void computeGlobalDiags( DiagnosticScreen          *diag, int timestep );
     
@@ -195,6 +202,27 @@ public:
         }
     }
     
+    //! Memory allocated for the buffers of the dynamics (bytes)
+    inline uint64_t getDynamicsBuffersMemFootPrint()
+    {
+        uint64_t size = 0;
+        for( unsigned int ithread=0; ithread<dynamics_Epart.size(); ithread++ ) {
+            size += ( dynamics_Epart[ithread].capacity() + dynamics_Bpart[ithread].capacity()
+                      + dynamics_invgf[ithread].capacity() + dynamics_deltaold[ithread].capacity() ) * sizeof( double )
+                    + dynamics_iold[ithread].capacity() * sizeof( int );
+        }
+        // Only in AM geometry
+        for( unsigned int ithread=0; ithread<dynamics_thetaold.size(); ithread++ ) {
+            size += dynamics_thetaold[ithread].capacity() * sizeof( double );
+        }
+        for( unsigned int ithread=0; ithread<dynamics_GradPHIpart.size(); ithread++ ) {
+            size += ( dynamics_GradPHIpart[ithread].capacity() + dynamics_GradPHI_mpart[ithread].capacity()
+                      + dynamics_PHIpart[ithread].capacity() + dynamics_PHI_mpart[ithread].capacity()
+                      + dynamics_inv_gamma_ponderomotive[ithread].capacity() ) * sizeof( double );
+        }
+        return size;
+    }
+    
     // Resize buffers for old properties only
     inline void resizeOldPropertiesBuffer( int ithread, int ndim_field, int npart, bool isAM = false )
     {
@@ -236,6 +264,11 @@ protected:
     //Number of patches owned by each mpi process.
     std::vector<int>  patch_count, capabilities, patch_refHindexes;
     int Tcapabilities; //Default = smilei_sz (1 per MPI rank)
+    
+    //! Iterations left before measuring the achieved imbalance of the last balancing (-1 if none)
+    int imbalance_window_;
+    //! Imbalance predicted by the last balancing (known by the master only)
+    double predicted_imbalance_;
 };
 
 
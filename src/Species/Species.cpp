@@ -110,6 +110,10 @@ Species::Species( Params &params, Patch *patch ) :
     merge_momentum_cell_size_.resize(3);
 
     merge_min_momentum_cell_length_.resize(3);
+    
+    prepareScalars( false );
+    
+    operator_cycles_.resize( 7, 0 );
 
 }//END Species creator
 
@@ -313,6 +317,7 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
     double timer;
 #endif
+    uint64_t cycles = 0;
 
     unsigned int iPart;
 
@@ -337,6 +342,7 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
             timer = MPI_Wtime();
 #endif
+            cycles = CycleCounter::now();
 
             // Interpolate the fields at the particle position
             Interp->fieldsWrapper( EMfields, *particles, smpi, &( first_index[ibin] ), &( last_index[ibin] ), ithread );
@@ -344,6 +350,7 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
             patch->patch_timers[0] += MPI_Wtime() - timer;
 #endif
+            operator_cycles_[0] += CycleCounter::now() - cycles;
 
             // Ionization
             if( Ionize ) {
@@ -351,12 +358,14 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 timer = MPI_Wtime();
 #endif
+                cycles = CycleCounter::now();
 
                 ( *Ionize )( particles, first_index[ibin], last_index[ibin], Epart, patch, Proj );
 
 #ifdef  __DETAILED_TIMERS
                 patch->patch_timers[4] += MPI_Wtime() - timer;
 #endif
+                operator_cycles_[4] += CycleCounter::now() - cycles;
             }
             
             if( time_dual<=time_frozen_ ) continue; // Do not push nor project frozen particles
@@ -367,6 +376,7 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 timer = MPI_Wtime();
 #endif
+                cycles = CycleCounter::now();
 
                 // Radiation process
                 ( *Radiate )( *particles, this->photon_species, smpi,
@@ -385,6 +395,7 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 patch->patch_timers[5] += MPI_Wtime() - timer;
 #endif
+                operator_cycles_[5] += CycleCounter::now() - cycles;
 
             }
 
@@ -395,6 +406,7 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 timer = MPI_Wtime();
 #endif
+                cycles = CycleCounter::now();
 
                 // Pair generation process
                 ( *Multiphoton_Breit_Wheeler_process )( *particles,
@@ -420,12 +432,14 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 patch->patch_timers[6] += MPI_Wtime() - timer;
 #endif
+                operator_cycles_[6] += CycleCounter::now() - cycles;
 
             }
 
 #ifdef  __DETAILED_TIMERS
             timer = MPI_Wtime();
 #endif
+            cycles = CycleCounter::now();
 
             // Push the particles and the photons
             ( *Push )( *particles, smpi, first_index[ibin], last_index[ibin], ithread );
@@ -439,7 +453,11 @@ void Species::dynamics( double time_dual, unsigned int ispec,
             patch->patch_timers[1] += MPI_Wtime() - timer;
             timer = MPI_Wtime();
 #endif
+            operator_cycles_[1] += CycleCounter::now() - cycles;
+            cycles = CycleCounter::now();
 
+            unsigned int iexch = indexes_of_particles_to_exchange.size();
+            
             // Apply wall and boundary conditions
             if( mass_>0 ) {
                 for( unsigned int iwall=0; iwall<partWalls->size(); iwall++ ) {
@@ -484,16 +502,24 @@ void Species::dynamics( double time_dual, unsigned int ispec,
                 }
 
             }
+            
+            // Sums for the scalar diagnostics, while the bin is still in cache
+            if( accumulate_scalars_ && time_dual>time_frozen_ ) {
+                accumulateScalars( *particles, first_index[ibin], last_index[ibin] );
+                discountExchangedScalars( iexch );
+            }
 
 #ifdef  __DETAILED_TIMERS
             patch->patch_timers[3] += MPI_Wtime() - timer;
 #endif
+            operator_cycles_[3] += CycleCounter::now() - cycles;
 
             //START EXCHANGE PARTICLES OF THE CURRENT BIN ?
 
 #ifdef  __DETAILED_TIMERS
             timer = MPI_Wtime();
 #endif
+            cycles = CycleCounter::now();
 
             // Project currents if not a Test species and charges as well if a diag is needed.
             // Do not project if a photon
@@ -504,6 +530,7 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
             patch->patch_timers[2] += MPI_Wtime() - timer;
 #endif
+            operator_cycles_[2] += CycleCounter::now() - cycles;
 
         }// ibin
 
@@ -511,6 +538,8 @@ void Species::dynamics( double time_dual, unsigned int ispec,
         for( unsigned int ithd=0 ; ithd<nrj_lost_per_thd.size() ; ithd++ ) {
             nrj_bc_lost += nrj_lost_per_thd[tid];
         }
+        
+        scalars_ready_ = accumulate_scalars_ && time_dual>time_frozen_;
 
 //        // Add the ionized electrons to the electron species
 //        if (Ionize)
@@ -582,6 +611,81 @@ void Species::dynamics( double time_dual, unsigned int ispec,
 //   - apply the boundary conditions
 //   - increment the currents (projection)
 // ---------------------------------------------------------------------------------------------------------------------
+// ---------------------------------------------------------------------------------------------------------------------
+// Sums of weights, charges and kinetic energies for the scalar diagnostics
+// ---------------------------------------------------------------------------------------------------------------------
+void Species::accumulateScalars( Particles &parts, int istart, int iend )
+{
+    if( istart >= iend ) {
+        return;
+    }
+    
+    double density = 0., charge = 0., energy = 0.;
+    double *weight = &( parts.weight( 0 ) );
+    short  *q      = &( parts.charge( 0 ) );
+    double *px     = &( parts.momentum( 0, 0 ) );
+    double *py     = &( parts.momentum( 1, 0 ) );
+    double *pz     = &( parts.momentum( 2, 0 ) );
+    
+    if( mass_ > 0 ) {
+        #pragma omp simd reduction(+:density,charge,energy)
+        for( int ipart=istart ; ipart<iend; ipart++ ) {
+            density += weight[ipart];
+            charge  += weight[ipart] * ( double )q[ipart];
+            energy  += weight[ipart] * ( sqrt( 1. + px[ipart]*px[ipart] + py[ipart]*py[ipart] + pz[ipart]*pz[ipart] ) - 1. );
+        }
+    } else {
+        #pragma omp simd reduction(+:density,energy)
+        for( int ipart=istart ; ipart<iend; ipart++ ) {
+            density += weight[ipart];
+            energy  += weight[ipart] * sqrt( px[ipart]*px[ipart] + py[ipart]*py[ipart] + pz[ipart]*pz[ipart] );
+        }
+    }
+    
+    scalars_density_ += density;
+    scalars_charge_  += charge;
+    scalars_energy_  += energy;
+}
+
+// Particles leaving the patch are counted by the patch receiving them
+void Species::discountExchangedScalars( unsigned int iexch )
+{
+    for( unsigned int i=iexch; i<indexes_of_particles_to_exchange.size(); i++ ) {
+        int ipart = indexes_of_particles_to_exchange[i];
+        scalars_density_ -= particles->weight( ipart );
+        if( mass_ > 0 ) {
+            scalars_charge_ -= particles->weight( ipart ) * ( double )particles->charge( ipart );
+            scalars_energy_ -= particles->weight( ipart ) * ( particles->LorentzFactor( ipart )-1. );
+        } else {
+            scalars_energy_ -= particles->weight( ipart ) * particles->momentumNorm( ipart );
+        }
+    }
+}
+
+const double *Species::diagLorentzFactors()
+{
+    unsigned int npart = particles->size();
+    if( diag_lorentz_factors_.size() != npart ) {
+        diag_lorentz_factors_.resize( npart );
+        double *px = &( particles->momentum( 0, 0 ) );
+        double *py = &( particles->momentum( 1, 0 ) );
+        double *pz = &( particles->momentum( 2, 0 ) );
+        double *gamma = diag_lorentz_factors_.data();
+        if( mass_ > 0 ) {
+            #pragma omp simd
+            for( unsigned int ipart=0; ipart<npart; ipart++ ) {
+                gamma[ipart] = sqrt( 1. + px[ipart]*px[ipart] + py[ipart]*py[ipart] + pz[ipart]*pz[ipart] );
+            }
+        } else {
+            #pragma omp simd
+            for( unsigned int ipart=0; ipart<npart; ipart++ ) {
+                gamma[ipart] = sqrt( px[ipart]*px[ipart] + py[ipart]*py[ipart] + pz[ipart]*pz[ipart] );
+            }
+        }
+    }
+    return diag_lorentz_factors_.data();
+}
+
 void Species::scalarDynamics( double time_dual, unsigned int ispec,
                                ElectroMagn *EMfields,
                                Params &params, bool diag_flag,
@@ -1032,6 +1136,10 @@ void Species::importParticles( Params &params, Patch *patch, Particles &source_p
     if( particles->tracked ) {
         dynamic_cast<DiagnosticTrack *>( localDiags[tracking_diagnostic] )->setIDs( source_particles );
     }
+    
+    if( accumulate_scalars_ ) {
+        accumulateScalars( source_particles, 0, npart );
+    }
 
     // Move particles
     vector<int> src_bin_keys( npart, 0 );
@@ -19,6 +19,7 @@
 #include "MultiphotonBreitWheeler.h"
 #include "MultiphotonBreitWheelerTables.h"
 #include "Merging.h"
+#include "CycleCounter.h"
 
 class ElectroMagn;
 class Pusher;
@@ -238,6 +239,22 @@ public:
     double new_particles_energy_;
     //! Accumulate energy lost by the particle with the radiation
     double nrj_radiation;
+    
+    //! Whether the sums for the scalar diagnostics are accumulated during this timestep
+    bool accumulate_scalars_;
+    //! Whether these sums are valid: they are accumulated right after the push, then updated
+    //! by the exchanges and imports of particles. Otherwise, the diagnostic loops over the particles.
+    bool scalars_ready_;
+    //! Sums of weights, charges and kinetic energies (not multiplied by the mass)
+    double scalars_density_, scalars_charge_, scalars_energy_;
+    
+    //! Lorentz factors of the particles (momentum norms for photons), shared by all the particle
+    //! diagnostics that run on this patch during the same traversal (see VectorPatch::runAllDiags)
+    std::vector<double> diag_lorentz_factors_;
+    
+    //! Time spent in the operators of the dynamics since the last DiagPerformances output, in CycleCounter counts,
+    //! indexed like the detailed timers: interpolator, pusher, projector, cell keys, ionization, radiation, Breit-Wheeler
+    std::vector<uint64_t> operator_cycles_;
 
     //! whether to choose vectorized operators with respective sorting methods
     int vectorized_operators;
@@ -425,6 +442,9 @@ public:
 
     virtual void computeParticleCellKeys( Params &params ) {};
 
+    //! Count the particles of each cell from their positions, without modifying cell_keys nor count
+    virtual void countParticlesPerCell( std::vector<int> &cell_count ) {};
+
     //! This function configures the type of species according to the default mode
     //! regardless the number of particles per cell
     virtual void defaultConfigure( Params &params, Patch *patch ) ;
@@ -502,6 +522,31 @@ public:
         return mass_*new_particles_energy_;
     }
 
+    //! Start the accumulation of the sums for the scalar diagnostics (if `accumulate`)
+    void prepareScalars( bool accumulate )
+    {
+        accumulate_scalars_ = accumulate;
+        scalars_ready_ = false;
+        scalars_density_ = 0.;
+        scalars_charge_ = 0.;
+        scalars_energy_ = 0.;
+    }
+    
+    //! Add particles istart to iend of `parts` to the sums for the scalar diagnostics
+    void accumulateScalars( Particles &parts, int istart, int iend );
+    
+    //! Remove from these sums the particles listed in indexes_of_particles_to_exchange from `iexch`
+    void discountExchangedScalars( unsigned int iexch );
+    
+    //! Lorentz factors for the diagnostics, computed at the first call of a traversal
+    const double *diagLorentzFactors();
+    
+    //! Release the Lorentz factors at the end of a traversal
+    void clearDiagLorentzFactors()
+    {
+        std::vector<double>().swap( diag_lorentz_factors_ );
+    }
+    
     //! Reinitialize the scalar diagnostics buffer
     void reinitDiags()
     {
@@ -902,6 +902,7 @@ public:
             // does a loop over all cells in the simulation
             // considering a 3d volume with size n_space[0]*n_space[1]*n_space[2]
             // Particle creator object
+            Rand::seedPatch( patch->Hindex(), ispec );
             ParticleCreator particle_creator;
             particle_creator.associate(this_species);
             particle_creator.create( params.n_space, params, patch, 0, 0 );
@@ -1032,6 +1033,7 @@ public:
 
         // \todo : NOT SURE HOW THIS BEHAVES WITH RESTART
         if( ( !params.restart ) && ( with_particles ) ) {
+            Rand::seedPatch( patch->Hindex(), new_species->species_number_ );
             ParticleCreator particle_creator;
             particle_creator.associate(new_species);
             particle_creator.create( params.n_space, params, patch, 0, 0 );
@@ -9,6 +9,79 @@
 
 #include "SpeciesMetrics.h"
 
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Params.h"
+#include "SmileiMPI.h"
+#include "Tools.h"
+
+// -----------------------------------------------------------------------------
+// Reference fits of the time per particle as a function of log(particles per cell),
+// by increasing power of the logarithm
+// -----------------------------------------------------------------------------
+// Cascade lake 6248 (Ex: Jean Zay)
+#if defined __INTEL_CASCADELAKE_6248
+static const double reference_vecto_fit[5] = {
+    2.851575999756124e+00, -1.103410559576951e+00, 6.520005335065826e-02, 3.143999691029673e-02, -3.878426186471072e-03
+};
+static const double reference_scalar_fit[2] = { 9.564834436679180e-01, -1.109419407609368e-02 };
+// Skylake 8168 (Ex: Irene Joliot-Curie)
+#elif defined __INTEL_SKYLAKE_8168
+static const double reference_vecto_fit[5] = {
+    2.873965603217334e+00, -1.018178658950980e+00, -2.390999177899332e-02, 5.302690106220765e-02, -5.500324176161280e-03
+};
+static const double reference_scalar_fit[2] = { 9.539747447809775e-01, -1.476070257489217e-02 };
+// Knight Landings Intel Xeon Phi 7250 (Ex: Frioul)
+#elif defined __INTEL_KNL_7250
+static const double reference_vecto_fit[5] = {
+    3.391615458521049e+00, -1.948861281215199e+00, 6.609030611761257e-01, -1.252595460426959e-01, 9.287025545185804e-03
+};
+static const double reference_scalar_fit[2] = { 9.640406193625433e-01, -1.693420314189753e-02 };
+// Broadwell Intel Xeon E5-2697 v4 (Ex: Tornado)
+#elif defined __INTEL_BDW_E5_2697_V4
+static const double reference_vecto_fit[5] = {
+    4.661824411143119e+00, -2.010116307618810e+00, 1.940828611778672e-01, 3.249709067117774e-02, -4.732086199743545e-03
+};
+static const double reference_scalar_fit[2] = { 9.382353109818060e-01, 6.694852027937652e-03 };
+// Haswell Intel Xeon E5-2680 v3 (Ex: Jureca)
+#elif defined __INTEL_HSW_E5_2680_v3
+static const double reference_vecto_fit[5] = {
+    2.893485213852858e+00, -1.066920754145127e+00, 3.666171703120181e-02, 3.688297004269906e-02, -4.127980207551420e-03
+};
+static const double reference_scalar_fit[2] = { 9.761935025470106e-01, -1.716273243387051e-02 };
+// General fit
+#else
+static const double reference_vecto_fit[5] = {
+    2.855507642982689e+00, -1.192593070397785e+00, 1.447576003168199e-01, 8.410553824987992e-03, -1.760649180606238e-03
+};
+static const double reference_scalar_fit[2] = { 9.405673399529412e-01, -8.274579739804833e-03 };
+#endif
+
+// Layout of the samples: normal equations (matrix, right-hand side, number of samples)
+// of the vectorized fit followed by those of the scalar fit
+static const unsigned int vecto_samples_size  = 5*5 + 5 + 1;
+static const unsigned int scalar_samples_size = 2*2 + 2 + 1;
+static const unsigned int samples_size = vecto_samples_size + scalar_samples_size;
+
+std::string SpeciesMetrics::model_key_;
+double SpeciesMetrics::vecto_coefficients_[5] = {
+    reference_vecto_fit[0], reference_vecto_fit[1], reference_vecto_fit[2], reference_vecto_fit[3], reference_vecto_fit[4]
+};
+double SpeciesMetrics::scalar_coefficients_[2] = { reference_scalar_fit[0], reference_scalar_fit[1] };
+bool SpeciesMetrics::calibrated_ = false;
+bool SpeciesMetrics::calibrating_ = false;
+int SpeciesMetrics::calibration_end_ = 0;
+unsigned int SpeciesMetrics::calibration_step_ = 0;
+std::vector<std::vector<double> > SpeciesMetrics::thread_samples_;
+std::vector<double> SpeciesMetrics::samples_;
+
 
 
 // -----------------------------------------------------------------------------
@@ -125,50 +198,11 @@ double SpeciesMetrics::get_particle_computation_time_vectorization(const double
 //#pragma omp declare simd
 float SpeciesMetrics::get_particle_computation_time_vectorization( const float log_particle_number )
 {
-// Cascade lake 6248 (Ex: Jean Zay)
-#if defined __INTEL_CASCADELAKE_6248
-    return -3.878426186471072e-03 * pow(log_particle_number,4)
-            + 3.143999691029673e-02 * pow(log_particle_number,3)
-            + 6.520005335065826e-02 * pow(log_particle_number,2)
-            -1.103410559576951e+00 * log_particle_number
-            + 2.851575999756124e+00;
-// Skylake 8168 (Ex: Irene Joliot-Curie)
-#elif defined __INTEL_SKYLAKE_8168
-    return    -5.500324176161280e-03 * pow( log_particle_number, 4 )
-              + 5.302690106220765e-02 * pow( log_particle_number, 3 )
-              -2.390999177899332e-02 * pow( log_particle_number, 2 )
-              -1.018178658950980e+00 * log_particle_number
-              + 2.873965603217334e+00;
-// Knight Landings Intel Xeon Phi 7250 (Ex: Frioul)
-#elif defined __INTEL_KNL_7250
-    return    + 9.287025545185804e-03 * pow( log_particle_number, 4 )
-              -1.252595460426959e-01 * pow( log_particle_number, 3 )
-              + 6.609030611761257e-01 * pow( log_particle_number, 2 )
-              -1.948861281215199e+00 * log_particle_number
-              + 3.391615458521049e+00;
-// Broadwell Intel Xeon E5-2697 v4 (Ex: Tornado)
-#elif defined __INTEL_BDW_E5_2697_V4
-    return     -4.732086199743545e-03 * pow( log_particle_number, 4 )
-               + 3.249709067117774e-02 * pow( log_particle_number, 3 )
-               + 1.940828611778672e-01 * pow( log_particle_number, 2 )
-               -2.010116307618810e+00 * log_particle_number
-               + 4.661824411143119e+00;
-// Haswell Intel Xeon E5-2680 v3 (Ex: Jureca)
-#elif defined __INTEL_HSW_E5_2680_v3
-    return     -4.127980207551420e-03 * pow( log_particle_number, 4 )
-               + 3.688297004269906e-02 * pow( log_particle_number, 3 )
-               + 3.666171703120181e-02 * pow( log_particle_number, 2 )
-               -1.066920754145127e+00 * log_particle_number
-               + 2.893485213852858e+00;
-// General fit
-#else
-    return    -1.760649180606238e-03 * pow(log_particle_number,4)
-            + 8.410553824987992e-03 * pow(log_particle_number,3)
-            + 1.447576003168199e-01 * pow(log_particle_number,2)
-             -1.192593070397785e+00 * log_particle_number
-            + 2.855507642982689e+00;
-#endif
-
+    return vecto_coefficients_[0]
+           + log_particle_number * ( vecto_coefficients_[1]
+           + log_particle_number * ( vecto_coefficients_[2]
+           + log_particle_number * ( vecto_coefficients_[3]
+           + log_particle_number * vecto_coefficients_[4] ) ) );
 };
 
 //! Evaluate the time necessary to compute `particle_number` particles
@@ -185,29 +219,328 @@ double SpeciesMetrics::get_particle_computation_time_scalar(const double log_par
 //#pragma omp declare simd
 float SpeciesMetrics::get_particle_computation_time_scalar( const float log_particle_number )
 {
-// Cascade lake 6248 (Ex: Jean Zay)
-#if defined __INTEL_CASCADELAKE_6248
-    return  -1.109419407609368e-02 * log_particle_number
-            + 9.564834436679180e-01;
-// Skylake 8168 (Ex: Irene)
-#elif defined __INTEL_SKYLAKE_8168
-    return   -1.476070257489217e-02 * log_particle_number
-             + 9.539747447809775e-01;
-// Knight Landings Intel Xeon Phi 7250 (Ex: Frioul)
-#elif defined __INTEL_KNL_7250
-    return   -1.693420314189753e-02 * log_particle_number
-             + 9.640406193625433e-01;
-// Broadwell Intel Xeon E5-2697 v4 (Ex: Tornado)
-#elif defined __INTEL_BDW_E5_2697_V4
-    return   + 6.694852027937652e-03 * log_particle_number
-             + 9.382353109818060e-01;
-// Haswell Intel Xeon E5-2680 v3 (Ex: Jureca)
-#elif defined __INTEL_HSW_E5_2680_v3
-    return    -1.716273243387051e-02 * log_particle_number
-              + 9.761935025470106e-01;
-// General fit
+    return scalar_coefficients_[0] + log_particle_number * scalar_coefficients_[1];
+};
+
+// -----------------------------------------------------------------------------
+//! Name of the processor, read from /proc/cpuinfo when available
+// -----------------------------------------------------------------------------
+static std::string cpu_model_name()
+{
+    std::ifstream cpuinfo( "/proc/cpuinfo" );
+    std::string line;
+    while( std::getline( cpuinfo, line ) ) {
+        if( line.compare( 0, 10, "model name" ) == 0 ) {
+            size_t pos = line.find( ':' );
+            if( pos != std::string::npos && pos+2 <= line.size() ) {
+                return line.substr( pos+2 );
+            }
+        }
+    }
+    return "unknown processor";
+}
+
+// -----------------------------------------------------------------------------
+//! Load a previously calibrated model or start the calibration.
+//! The model is only reused if it was measured on the same processor
+//! with the same interpolation order.
+// -----------------------------------------------------------------------------
+void SpeciesMetrics::initCalibration( Params &params, SmileiMPI *smpi, int itime )
+{
+    if( params.adaptive_cost_model != "calibrated" ) {
+        return;
+    }
+
+#ifdef _OPENMP
+    int nthreads = omp_get_max_threads();
 #else
-    return    -8.274579739804833e-03 * log_particle_number
-            + 9.405673399529412e-01;
+    int nthreads = 1;
 #endif
-};
+    thread_samples_.assign( nthreads, std::vector<double>( samples_size, 0. ) );
+    samples_.assign( samples_size, 0. );
+
+    std::ostringstream key;
+    key << cpu_model_name() << " / interpolation order " << params.interpolation_order;
+    model_key_ = key.str();
+
+    // The master reads the file and shares the model
+    double buffer[8];
+    buffer[7] = 0.;
+    if( smpi->isMaster() && load( params.adaptive_cost_model_file ) ) {
+        buffer[7] = 1.;
+    }
+    std::copy( vecto_coefficients_, vecto_coefficients_+5, buffer );
+    std::copy( scalar_coefficients_, scalar_coefficients_+2, buffer+5 );
+    MPI_Bcast( buffer, 8, MPI_DOUBLE, 0, smpi->getGlobalComm() );
+
+    if( buffer[7] > 0. ) {
+        std::copy( buffer, buffer+5, vecto_coefficients_ );
+        std::copy( buffer+5, buffer+7, scalar_coefficients_ );
+        calibrated_ = true;
+        MESSAGE( 1, "Adaptive vectorization: cost model read from " << params.adaptive_cost_model_file );
+    } else if( params.adaptive_calibration_iterations > 0 ) {
+        calibrating_ = true;
+        calibration_end_ = itime + params.adaptive_calibration_iterations;
+        MESSAGE( 1, "Adaptive vectorization: calibration of the cost model on " << model_key_ );
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! During the calibration, half of the patches use vectorized operators
+//! and the other half scalar operators, swapped at each reconfiguration
+// -----------------------------------------------------------------------------
+void SpeciesMetrics::imposeCalibrationMode( unsigned int hindex, float &vecto_time, float &scalar_time )
+{
+    if( ( hindex + calibration_step_ ) % 2 == 0 ) {
+        vecto_time  = 0.;
+        scalar_time = 1.;
+    } else {
+        vecto_time  = 1.;
+        scalar_time = 0.;
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! Terms of the cost model: the time of a patch is the sum over k
+//! of coefficient[k] * terms[k], with terms[k] = sum over cells of count*log(count)^k
+// -----------------------------------------------------------------------------
+void SpeciesMetrics::get_model_terms( const std::vector<int> &count, double *terms )
+{
+    double t0 = 0., t1 = 0., t2 = 0., t3 = 0., t4 = 0.;
+    #pragma omp simd reduction(+:t0,t1,t2,t3,t4)
+    for( unsigned int ic=0; ic < count.size(); ic++ ) {
+        if( count[ic] > 0 ) {
+            // Same range as the evaluation of the model
+            double x = log( std::min( double( count[ic] ), 256.0 ) );
+            double n = count[ic];
+            t0 += n;
+            t1 += n*x;
+            t2 += n*x*x;
+            t3 += n*x*x*x;
+            t4 += n*x*x*x*x;
+        }
+    }
+    terms[0] = t0;
+    terms[1] = t1;
+    terms[2] = t2;
+    terms[3] = t3;
+    terms[4] = t4;
+}
+
+// -----------------------------------------------------------------------------
+//! Accumulate the normal equations of the least-square fit
+//! with the time measured for one species in one patch
+// -----------------------------------------------------------------------------
+void SpeciesMetrics::addSample( const double *terms, double time, bool vectorized )
+{
+#ifdef _OPENMP
+    unsigned int ithread = omp_get_thread_num();
+#else
+    unsigned int ithread = 0;
+#endif
+    if( ithread >= thread_samples_.size() || terms[0] <= 0. ) {
+        return;
+    }
+    unsigned int n = vectorized ? 5 : 2;
+    double *A = &thread_samples_[ithread][vectorized ? 0 : vecto_samples_size];
+    double *b = A + n*n;
+    for( unsigned int i=0; i<n; i++ ) {
+        for( unsigned int j=0; j<n; j++ ) {
+            A[i*n+j] += terms[i] * terms[j];
+        }
+        b[i] += terms[i] * time;
+    }
+    b[n] += 1.;
+}
+
+// -----------------------------------------------------------------------------
+//! Least-square fit of the coefficients from the normal equations.
+//! The fit is regularized towards the reference fit scaled to the measured times,
+//! so that the ranges of particles per cell which were not sampled keep the reference shape.
+//! Return false if there are not enough samples or if the model is not positive.
+// -----------------------------------------------------------------------------
+bool SpeciesMetrics::fit( const double *samples, const double *reference, unsigned int n, double *coefficients )
+{
+    const double *A = samples;
+    const double *b = samples + n*n;
+    if( b[n] < 4*n ) {
+        return false;
+    }
+
+    // Scale of the reference fit which best matches the measurements
+    double rAr = 0., rb = 0., trace = 0.;
+    for( unsigned int i=0; i<n; i++ ) {
+        for( unsigned int j=0; j<n; j++ ) {
+            rAr += reference[i] * A[i*n+j] * reference[j];
+        }
+        rb += reference[i] * b[i];
+        trace += A[i*n+i];
+    }
+    if( rAr <= 0. || rb <= 0. ) {
+        return false;
+    }
+    double scale = rb / rAr;
+    double lambda = 1.e-3 * trace / n;
+
+    // Gauss elimination with partial pivoting of (A + lambda I) c = b + lambda * scale * reference
+    std::vector<double> M( n*( n+1 ) );
+    for( unsigned int i=0; i<n; i++ ) {
+        for( unsigned int j=0; j<n; j++ ) {
+            M[i*( n+1 )+j] = A[i*n+j] + ( i==j ? lambda : 0. );
+        }
+        M[i*( n+1 )+n] = b[i] + lambda * scale * reference[i];
+    }
+    for( unsigned int k=0; k<n; k++ ) {
+        unsigned int p = k;
+        for( unsigned int i=k+1; i<n; i++ ) {
+            if( std::abs( M[i*( n+1 )+k] ) > std::abs( M[p*( n+1 )+k] ) ) {
+                p = i;
+            }
+        }
+        if( std::abs( M[p*( n+1 )+k] ) <= 1.e-12 * trace ) {
+            return false;
+        }
+        if( p != k ) {
+            for( unsigned int j=0; j<=n; j++ ) {
+                std::swap( M[k*( n+1 )+j], M[p*( n+1 )+j] );
+            }
+        }
+        for( unsigned int i=k+1; i<n; i++ ) {
+            double f = M[i*( n+1 )+k] / M[k*( n+1 )+k];
+            for( unsigned int j=k; j<=n; j++ ) {
+                M[i*( n+1 )+j] -= f * M[k*( n+1 )+j];
+            }
+        }
+    }
+    std::vector<double> c( n );
+    for( int i=n-1; i>=0; i-- ) {
+        double s = M[i*( n+1 )+n];
+        for( unsigned int j=i+1; j<n; j++ ) {
+            s -= M[i*( n+1 )+j] * c[j];
+        }
+        c[i] = s / M[i*( n+1 )+i];
+    }
+
+    // The time per particle must stay positive in the range of the model
+    for( unsigned int ppc=1; ppc<=256; ppc++ ) {
+        double x = log( double( ppc ) ), t = 0., xk = 1.;
+        for( unsigned int k=0; k<n; k++ ) {
+            t += c[k] * xk;
+            xk *= x;
+        }
+        if( t <= 0. ) {
+            return false;
+        }
+    }
+
+    std::copy( c.begin(), c.end(), coefficients );
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//! Gather the samples of all threads and processes, fit the model and
+//! advance the calibration phase. Called by a single thread at each reconfiguration.
+// -----------------------------------------------------------------------------
+void SpeciesMetrics::updateModel( Params &params, SmileiMPI *smpi, int itime )
+{
+    if( params.adaptive_cost_model != "calibrated" ) {
+        return;
+    }
+
+    std::vector<double> local( samples_size, 0. ), global( samples_size, 0. );
+    for( unsigned int ithread=0; ithread<thread_samples_.size(); ithread++ ) {
+        for( unsigned int i=0; i<samples_size; i++ ) {
+            local[i] += thread_samples_[ithread][i];
+            thread_samples_[ithread][i] = 0.;
+        }
+    }
+    MPI_Allreduce( &local[0], &global[0], samples_size, MPI_DOUBLE, MPI_SUM, smpi->getGlobalComm() );
+    for( unsigned int i=0; i<samples_size; i++ ) {
+        samples_[i] += global[i];
+    }
+
+    double vecto[5], scalar[2];
+    bool vecto_ok  = fit( &samples_[0], reference_vecto_fit, 5, vecto );
+    bool scalar_ok = fit( &samples_[vecto_samples_size], reference_scalar_fit, 2, scalar );
+
+    // Both types of operators must be measured before the model is switched to seconds.
+    // Afterwards, each type is refined independently with the samples of the run.
+    if( calibrated_ || ( vecto_ok && scalar_ok ) ) {
+        if( vecto_ok ) {
+            std::copy( vecto, vecto+5, vecto_coefficients_ );
+        }
+        if( scalar_ok ) {
+            std::copy( scalar, scalar+2, scalar_coefficients_ );
+        }
+        calibrated_ = true;
+    }
+
+    calibration_step_++;
+    if( calibrating_ && itime >= calibration_end_ ) {
+        calibrating_ = false;
+        if( calibrated_ ) {
+            MESSAGE( 1, "Adaptive vectorization: cost model calibrated, stored in " << params.adaptive_cost_model_file );
+            if( smpi->isMaster() ) {
+                save( params.adaptive_cost_model_file );
+            }
+        } else {
+            MESSAGE( 1, "Adaptive vectorization: not enough samples to calibrate the cost model, reference model kept" );
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+//! Write the calibrated model
+// -----------------------------------------------------------------------------
+void SpeciesMetrics::save( const std::string &file )
+{
+    std::ofstream out( file.c_str() );
+    if( !out.is_open() ) {
+        WARNING( "Cannot write the cost model of the adaptive vectorization in " << file );
+        return;
+    }
+    out << "# Time per particle as a function of x = log(particles per cell), coefficients of x^0 to x^n" << std::endl;
+    out << "machine " << model_key_ << std::endl;
+    out << std::setprecision( 16 ) << std::scientific;
+    out << "vectorized";
+    for( unsigned int k=0; k<5; k++ ) {
+        out << " " << vecto_coefficients_[k];
+    }
+    out << std::endl << "scalar";
+    for( unsigned int k=0; k<2; k++ ) {
+        out << " " << scalar_coefficients_[k];
+    }
+    out << std::endl;
+}
+
+// -----------------------------------------------------------------------------
+//! Read a calibrated model, only if it matches the current machine
+// -----------------------------------------------------------------------------
+bool SpeciesMetrics::load( const std::string &file )
+{
+    std::ifstream in( file.c_str() );
+    if( !in.is_open() ) {
+        return false;
+    }
+    std::string line, key;
+    double vecto[5], scalar[2];
+    bool has_vecto = false, has_scalar = false;
+    while( std::getline( in, line ) ) {
+        std::istringstream fields( line );
+        std::string name;
+        fields >> name;
+        if( name == "machine" ) {
+            key = line.size() > 8 ? line.substr( 8 ) : "";
+        } else if( name == "vectorized" ) {
+            has_vecto = !!( fields >> vecto[0] >> vecto[1] >> vecto[2] >> vecto[3] >> vecto[4] );
+        } else if( name == "scalar" ) {
+            has_scalar = !!( fields >> scalar[0] >> scalar[1] );
+        }
+    }
+    if( key != model_key_ || !has_vecto || !has_scalar ) {
+        return false;
+    }
+    std::copy( vecto, vecto+5, vecto_coefficients_ );
+    std::copy( scalar, scalar+2, scalar_coefficients_ );
+    return true;
+}
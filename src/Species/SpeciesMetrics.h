@@ -7,6 +7,9 @@
 #include <cmath>
 #include <iostream>
 
+class Params;
+class SmileiMPI;
+
 //! class SpeciesMetrics: This class contains metrics operators to evaluate
 //! the computation cost of a patch to treat all particles and to determine
 //! which type of operators should be used (vecto or not)
@@ -29,6 +32,29 @@ public:
                                       float &vecto_time,
                                       float &scalar_time );
                                       
+    // Calibration of the cost model on the current machine
+
+    //! Load a previously calibrated model or start the calibration
+    static void initCalibration( Params &params, SmileiMPI *smpi, int itime );
+
+    //! True while the patches alternate between both types of operators to measure them
+    static inline bool isCalibrating()
+    {
+        return calibrating_;
+    }
+
+    //! Replace the estimated times so that the operators of the patch `hindex` are imposed during the calibration
+    static void imposeCalibrationMode( unsigned int hindex, float &vecto_time, float &scalar_time );
+
+    //! Terms of the cost model for the particle distribution `count` (sums of count*log(count)^k)
+    static void get_model_terms( const std::vector<int> &count, double *terms );
+
+    //! Store the measured time of one species in one patch (thread safe)
+    static void addSample( const double *terms, double time, bool vectorized );
+
+    //! Gather the samples of all threads and processes and fit the model (called by a single thread)
+    static void updateModel( Params &params, SmileiMPI *smpi, int itime );
+
 protected:
 
     //! Evaluate the time necessary to compute `particle_number` particles
@@ -49,6 +75,35 @@ protected:
     
 private:
 
+    //! Least-square fit of the coefficients of one type of operators from the accumulated samples
+    static bool fit( const double *samples, const double *reference, unsigned int ncoefficients, double *coefficients );
+
+    //! Write the calibrated model in `file` (master process only)
+    static void save( const std::string &file );
+
+    //! Read a calibrated model from `file`, return false if absent or computed for another machine
+    static bool load( const std::string &file );
+
+    //! Description of the machine and of the operators for which the model is calibrated
+    static std::string model_key_;
+
+    //! Coefficients (by increasing power of log(count)) used by the cost model
+    static double vecto_coefficients_[5];
+    static double scalar_coefficients_[2];
+
+    //! True when the coefficients are measured in seconds on this machine
+    static bool calibrated_;
+    //! True during the calibration phase
+    static bool calibrating_;
+    //! Last iteration of the calibration phase
+    static int calibration_end_;
+    //! Number of reconfigurations since the beginning of the calibration
+    static unsigned int calibration_step_;
+
+    //! Samples of each thread, not yet reduced: normal equations of the vectorized then scalar fits
+    static std::vector<std::vector<double> > thread_samples_;
+    //! Samples of all processes accumulated since the beginning of the run
+    static std::vector<double> samples_;
 
 };
 
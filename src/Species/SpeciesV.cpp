@@ -132,6 +132,7 @@ void SpeciesV::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
     double timer;
 #endif
+    uint64_t cycles = 0;
 
     if( npack_==0 ) {
         npack_    = 1;
@@ -180,6 +181,7 @@ void SpeciesV::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
             timer = MPI_Wtime();
 #endif
+            cycles = CycleCounter::now();
 
             // Interpolate the fields at the particle position
             for( unsigned int scell = 0 ; scell < packsize_ ; scell++ )
@@ -190,18 +192,21 @@ void SpeciesV::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
             patch->patch_timers[0] += MPI_Wtime() - timer;
 #endif
+            operator_cycles_[0] += CycleCounter::now() - cycles;
 
             // Ionization
             if( Ionize ) {
 #ifdef  __DETAILED_TIMERS
                 timer = MPI_Wtime();
 #endif
+                cycles = CycleCounter::now();
                 for( unsigned int scell = 0 ; scell < first_index.size() ; scell++ ) {
                     ( *Ionize )( particles, first_index[scell], last_index[scell], Epart, patch, Proj );
                 }
 #ifdef  __DETAILED_TIMERS
                 patch->patch_timers[4] += MPI_Wtime() - timer;
 #endif
+                operator_cycles_[4] += CycleCounter::now() - cycles;
             }
             
             if ( time_dual <= time_frozen_ ) continue;
@@ -211,6 +216,7 @@ void SpeciesV::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 timer = MPI_Wtime();
 #endif
+                cycles = CycleCounter::now();
 
                 for( unsigned int scell = 0 ; scell < first_index.size() ; scell++ ) {
                     // Radiation process
@@ -231,6 +237,7 @@ void SpeciesV::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 patch->patch_timers[5] += MPI_Wtime() - timer;
 #endif
+                operator_cycles_[5] += CycleCounter::now() - cycles;
             }
 
             // Multiphoton Breit-Wheeler
@@ -238,6 +245,7 @@ void SpeciesV::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 timer = MPI_Wtime();
 #endif
+                cycles = CycleCounter::now();
                 for( unsigned int scell = 0 ; scell < first_index.size() ; scell++ ) {
 
                     // Pair generation process
@@ -265,11 +273,13 @@ void SpeciesV::dynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 patch->patch_timers[6] += MPI_Wtime() - timer;
 #endif
+                operator_cycles_[6] += CycleCounter::now() - cycles;
             }
 
 #ifdef  __DETAILED_TIMERS
             timer = MPI_Wtime();
 #endif
+            cycles = CycleCounter::now();
 
             // Push the particles and the photons
             ( *Push )( *particles, smpi, first_index[ipack*packsize_],
@@ -280,11 +290,15 @@ void SpeciesV::dynamics( double time_dual, unsigned int ispec,
             patch->patch_timers[1] += MPI_Wtime() - timer;
             timer = MPI_Wtime();
 #endif
+            operator_cycles_[1] += CycleCounter::now() - cycles;
+            cycles = CycleCounter::now();
 
             unsigned int length[3];
             length[0]=0;
             length[1]=params.n_space[1]+1;
             length[2]=params.n_space[2]+1;
+            
+            unsigned int iexch = indexes_of_particles_to_exchange.size();
 
             for( unsigned int scell = 0 ; scell < packsize_ ; scell++ ) {
                 // Apply wall and boundary conditions
@@ -346,36 +360,48 @@ void SpeciesV::dynamics( double time_dual, unsigned int ispec,
                     }
                 }
             }
+            
+            // Sums for the scalar diagnostics, while the pack is still in cache
+            if( accumulate_scalars_ ) {
+                accumulateScalars( *particles, first_index[ipack*packsize_], last_index[ipack*packsize_+packsize_-1] );
+                discountExchangedScalars( iexch );
+            }
             //START EXCHANGE PARTICLES OF THE CURRENT BIN ?
 
 #ifdef  __DETAILED_TIMERS
             patch->patch_timers[3] += MPI_Wtime() - timer;
 #endif
+            operator_cycles_[3] += CycleCounter::now() - cycles;
 
             // Project currents if not a Test species and charges as well if a diag is needed.
             // Do not project if a photon
-            if( ( !particles->is_test ) && ( mass_ > 0 ) )
 #ifdef  __DETAILED_TIMERS
-                timer = MPI_Wtime();
+            timer = MPI_Wtime();
 #endif
-
-            for( unsigned int scell = 0 ; scell < packsize_ ; scell++ )
-                Proj->currentsAndDensityWrapper(
-                    EMfields, *particles, smpi, first_index[ipack*packsize_+scell],
-                    last_index[ipack*packsize_+scell],
-                    ithread,
-                    diag_flag, params.is_spectral,
-                    ispec, ipack*packsize_+scell, first_index[ipack*packsize_]
-                );
+            cycles = CycleCounter::now();
+            if( ( !particles->is_test ) && ( mass_ > 0 ) ) {
+                for( unsigned int scell = 0 ; scell < packsize_ ; scell++ ) {
+                    Proj->currentsAndDensityWrapper(
+                        EMfields, *particles, smpi, first_index[ipack*packsize_+scell],
+                        last_index[ipack*packsize_+scell],
+                        ithread,
+                        diag_flag, params.is_spectral,
+                        ispec, ipack*packsize_+scell, first_index[ipack*packsize_]
+                    );
+                }
+            }
 
 #ifdef  __DETAILED_TIMERS
             patch->patch_timers[2] += MPI_Wtime() - timer;
 #endif
+            operator_cycles_[2] += CycleCounter::now() - cycles;
 
             for( unsigned int ithd=0 ; ithd<nrj_lost_per_thd.size() ; ithd++ ) {
                 nrj_bc_lost += nrj_lost_per_thd[tid];
             }
         } // End loop on packs
+        
+        scalars_ready_ = accumulate_scalars_ && time_dual>time_frozen_;
     } //End if moving or ionized particles
 
     if(time_dual <= time_frozen_ && diag_flag &&( !particles->is_test ) ) { //immobile particle (at the moment only project density)
@@ -710,6 +736,25 @@ void SpeciesV::computeParticleCellKeys( Params &params )
 
 }
 
+// -----------------------------------------------------------------------------
+//! Count the particles of each cell from their current positions.
+//! Unlike count, which is only refreshed by the sort of the vectorized mode,
+//! the result is valid whatever the operators.
+// -----------------------------------------------------------------------------
+void SpeciesV::countParticlesPerCell( std::vector<int> &cell_count )
+{
+    cell_count.assign( count.size(), 0 );
+    
+    unsigned int npart = particles->size();
+    for( unsigned int ip=0; ip < npart ; ip++ ) {
+        int key = 0;
+        for( unsigned int ipos=0; ipos < nDim_field ; ipos++ ) {
+            key = key * this->length_[ipos] + round( ((this)->*(distance[ipos]))(particles, ipos, ip) * dx_inv_[ipos] );
+        }
+        cell_count[key] ++;
+    }
+}
+
 // -----------------------------------------------------------------------------
 //! Compute cell_keys for the specified bin boundaries.
 //! params object that contains the global parameters
@@ -740,6 +785,10 @@ void SpeciesV::importParticles( Params &params, Patch *patch, Particles &source_
     if( particles->tracked ) {
         dynamic_cast<DiagnosticTrack *>( localDiags[tracking_diagnostic] )->setIDs( source_particles );
     }
+    
+    if( accumulate_scalars_ ) {
+        accumulateScalars( source_particles, 0, npart );
+    }
 
     unsigned int length[3];
     length[0]=0;
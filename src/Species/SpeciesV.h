@@ -75,6 +75,9 @@ public:
     //! Compute cell_keys for all particles of the current species
     void computeParticleCellKeys( Params &params ) override;
 
+    //! Count the particles of each cell from their positions, without modifying cell_keys nor count
+    void countParticlesPerCell( std::vector<int> &cell_count ) override;
+
     //! Compute cell_keys for the specified bin boundaries.
     void compute_bin_cell_keys( Params &params, int istart, int iend );
 
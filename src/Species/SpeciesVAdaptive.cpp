@@ -80,6 +80,7 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
     double timer;
 #endif
+    uint64_t cycles = 0;
 
     unsigned int iPart;
 
@@ -110,6 +111,7 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
         timer = MPI_Wtime();
 #endif
+        cycles = CycleCounter::now();
 
         // Interpolate the fields at the particle position
         Interp->fieldsWrapper( EMfields, *particles, smpi, &( first_index[0] ), &( last_index[last_index.size()-1] ), ithread, first_index[0] );
@@ -117,6 +119,7 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
         patch->patch_timers[0] += MPI_Wtime() - timer;
 #endif
+        operator_cycles_[0] += CycleCounter::now() - cycles;
 
         // Interpolate the fields at the particle position
         //for (unsigned int scell = 0 ; scell < first_index.size() ; scell++)
@@ -128,10 +131,12 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 timer = MPI_Wtime();
 #endif
+                cycles = CycleCounter::now();
                 ( *Ionize )( particles, first_index[scell], last_index[scell], Epart, patch, Proj );
 #ifdef  __DETAILED_TIMERS
                 patch->patch_timers[4] += MPI_Wtime() - timer;
 #endif
+                operator_cycles_[4] += CycleCounter::now() - cycles;
             }
 
             if( time_dual<=time_frozen_ ) continue; // Do not push nor project frozen particles
@@ -141,6 +146,7 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 timer = MPI_Wtime();
 #endif
+                cycles = CycleCounter::now();
                 // Radiation process
                 ( *Radiate )( *particles, this->photon_species, smpi,
                               RadiationTables,
@@ -158,6 +164,7 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 patch->patch_timers[5] += MPI_Wtime() - timer;
 #endif
+                operator_cycles_[5] += CycleCounter::now() - cycles;
             }
 
             // Multiphoton Breit-Wheeler
@@ -165,6 +172,7 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 timer = MPI_Wtime();
 #endif
+                cycles = CycleCounter::now();
                 // Pair generation process
                 ( *Multiphoton_Breit_Wheeler_process )( *particles,
                                                         smpi,
@@ -188,23 +196,28 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
                 patch->patch_timers[6] += MPI_Wtime() - timer;
 #endif
+                operator_cycles_[6] += CycleCounter::now() - cycles;
             }
         }
 
 #ifdef  __DETAILED_TIMERS
         timer = MPI_Wtime();
 #endif
+        cycles = CycleCounter::now();
         // Push the particles and the photons
         ( *Push )( *particles, smpi, 0, last_index.back(), ithread, 0. );
 #ifdef  __DETAILED_TIMERS
         patch->patch_timers[1] += MPI_Wtime() - timer;
         timer = MPI_Wtime();
 #endif
+        operator_cycles_[1] += CycleCounter::now() - cycles;
+        cycles = CycleCounter::now();
 
         // Computation of the particle cell keys for all particles
         // this->compute_bin_cell_keys(params,0, last_index.back());
 
         for( unsigned int scell = 0 ; scell < first_index.size() ; scell++ ) {
+            unsigned int iexch = indexes_of_particles_to_exchange.size();
             // Apply wall and boundary conditions
             if( mass_>0 ) {
                 for( unsigned int iwall=0; iwall<partWalls->size(); iwall++ ) {
@@ -261,11 +274,18 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
                     }
                 }
             } // end if mass_ > 0
+            
+            // Sums for the scalar diagnostics, while the cell is still in cache
+            if( accumulate_scalars_ && time_dual>time_frozen_ ) {
+                accumulateScalars( *particles, first_index[scell], last_index[scell] );
+                discountExchangedScalars( iexch );
+            }
         } // end loop on cells
 
 #ifdef  __DETAILED_TIMERS
         patch->patch_timers[3] += MPI_Wtime() - timer;
 #endif
+        operator_cycles_[3] += CycleCounter::now() - cycles;
 
         // Project currents if not a Test species and charges as well if a diag is needed.
         // Do not project if a photon
@@ -274,6 +294,7 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
             timer = MPI_Wtime();
 #endif
+            cycles = CycleCounter::now();
             Proj->currentsAndDensityWrapper(
                 EMfields, *particles, smpi, first_index[0],
                 last_index.back(),
@@ -285,13 +306,15 @@ void SpeciesVAdaptive::scalarDynamics( double time_dual, unsigned int ispec,
 #ifdef  __DETAILED_TIMERS
             patch->patch_timers[2] += MPI_Wtime() - timer;
 #endif
+            operator_cycles_[2] += CycleCounter::now() - cycles;
 
         }
 
         for( unsigned int ithd=0 ; ithd<nrj_lost_per_thd.size() ; ithd++ ) {
             nrj_bc_lost += nrj_lost_per_thd[tid];
         }
-
+        
+        scalars_ready_ = accumulate_scalars_ && time_dual>time_frozen_;
     }
 
     if(time_dual <= time_frozen_ && diag_flag &&( !particles->is_test ) ) { //immobile particle (at the moment only project density)
@@ -383,6 +406,11 @@ void SpeciesVAdaptive::reconfiguration( Params &params, Patch *patch )
                                           vecto_time,
                                           scalar_time );
 
+    // During the calibration of the cost model, the operators are imposed
+    if( SpeciesMetrics::isCalibrating() ) {
+        SpeciesMetrics::imposeCalibrationMode( patch->Hindex(), vecto_time, scalar_time );
+    }
+
     if( ( vecto_time <= scalar_time && this->vectorized_operators == false )
             || ( vecto_time > scalar_time && this->vectorized_operators == true ) ) {
         reasign_operators = true;
@@ -294,6 +294,11 @@ void SpeciesVAdaptiveMixedSort::reconfiguration( Params &params, Patch *patch )
                                           vecto_time,
                                           scalar_time );
 
+    // During the calibration of the cost model, the operators are imposed
+    if( SpeciesMetrics::isCalibrating() ) {
+        SpeciesMetrics::imposeCalibrationMode( patch->Hindex(), vecto_time, scalar_time );
+    }
+
     if( ( vecto_time < scalar_time && this->vectorized_operators == false )
             || ( vecto_time > scalar_time && this->vectorized_operators == true ) ) {
         reasign_operators = true;
@@ -0,0 +1,72 @@
+#include "AsyncWriter.h"
+
+using namespace std;
+
+thread AsyncWriter::thread_;
+mutex AsyncWriter::mutex_;
+condition_variable AsyncWriter::job_cv_;
+condition_variable AsyncWriter::done_cv_;
+deque<pair<const void *, function<void()> > > AsyncWriter::jobs_;
+map<const void *, unsigned int> AsyncWriter::pending_;
+bool AsyncWriter::running_ = false;
+bool AsyncWriter::stopping_ = false;
+
+void AsyncWriter::submit( const void *owner, function<void()> job )
+{
+    unique_lock<mutex> lock( mutex_ );
+    if( ! thread_.joinable() ) {
+        stopping_ = false;
+        thread_ = thread( AsyncWriter::loop );
+    }
+    jobs_.push_back( make_pair( owner, job ) );
+    pending_[owner]++;
+    job_cv_.notify_one();
+}
+
+void AsyncWriter::wait( const void *owner )
+{
+    unique_lock<mutex> lock( mutex_ );
+    done_cv_.wait( lock, [owner] { return pending_.count( owner ) == 0; } );
+}
+
+void AsyncWriter::wait()
+{
+    unique_lock<mutex> lock( mutex_ );
+    done_cv_.wait( lock, [] { return jobs_.empty() && !running_; } );
+}
+
+void AsyncWriter::stop()
+{
+    {
+        unique_lock<mutex> lock( mutex_ );
+        if( ! thread_.joinable() ) {
+            return;
+        }
+        stopping_ = true;
+        job_cv_.notify_one();
+    }
+    thread_.join();
+}
+
+void AsyncWriter::loop()
+{
+    unique_lock<mutex> lock( mutex_ );
+    while( true ) {
+        job_cv_.wait( lock, [] { return !jobs_.empty() || stopping_; } );
+        if( jobs_.empty() ) {
+            // Stop only when all writes are done
+            break;
+        }
+        pair<const void *, function<void()> > job = jobs_.front();
+        jobs_.pop_front();
+        running_ = true;
+        lock.unlock();
+        job.second();
+        lock.lock();
+        running_ = false;
+        if( --pending_[job.first] == 0 ) {
+            pending_.erase( job.first );
+        }
+        done_cv_.notify_all();
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <deque>
+#include <map>
+#include <utility>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//  --------------------------------------------------------------------------------------------------------------------
+//! Class AsyncWriter
+//!   One I/O thread per MPI process executes the writes submitted by the asynchronous diagnostics,
+//!   in the order of submission (identical on all processes, so that collective HDF5 writes match).
+//!   Each write belongs to an owner (the diagnostic), which waits only for its own writes before reusing its buffers.
+//!   HDF5 is not used concurrently: an asynchronous diagnostic does all its file accesses in its writes,
+//!   and any other access to the files (other diagnostics, checkpoints, closing) waits for all pending writes first.
+//  --------------------------------------------------------------------------------------------------------------------
+class AsyncWriter
+{
+public:
+    //! Queue a write of `owner`, executed later by the I/O thread (the thread is started at the first call)
+    static void submit( const void *owner, std::function<void()> job );
+    
+    //! Wait until the queued writes of `owner` are done
+    static void wait( const void *owner );
+    
+    //! Wait until all queued writes are done
+    static void wait();
+    
+    //! Wait for the pending writes and stop the I/O thread
+    static void stop();
+    
+private:
+    //! Loop of the I/O thread
+    static void loop();
+    
+    static std::thread thread_;
+    static std::mutex mutex_;
+    //! Signals new jobs to the I/O thread, and finished jobs to the waiting threads
+    static std::condition_variable job_cv_, done_cv_;
+    static std::deque<std::pair<const void *, std::function<void()> > > jobs_;
+    //! Number of queued or running jobs of each owner
+    static std::map<const void *, unsigned int> pending_;
+    //! True while the I/O thread executes a job
+    static bool running_;
+    static bool stopping_;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "CycleCounter.h"
+
+#include <thread>
+
+using namespace std;
+
+double CycleCounter::perSecond()
+{
+    static double per_second = 0.;
+    if( per_second == 0. ) {
+#if defined(__aarch64__)
+        uint64_t frequency;
+        asm volatile( "mrs %0, cntfrq_el0" : "=r"( frequency ) );
+        per_second = ( double )frequency;
+#elif defined(__x86_64__) || defined(__i386__)
+        // The time-stamp counter runs at a constant rate: measure it against the steady clock
+        chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+        uint64_t c0 = now();
+        this_thread::sleep_for( chrono::milliseconds( 20 ) );
+        chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+        uint64_t c1 = now();
+        per_second = ( double )( c1 - c0 ) / chrono::duration<double>( t1 - t0 ).count();
+#else
+        per_second = 1.e9;
+#endif
+    }
+    return per_second;
+}
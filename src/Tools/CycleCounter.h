@@ -0,0 +1,42 @@
+#ifndef CYCLECOUNTER_H
+#define CYCLECOUNTER_H
+
+#include <cstdint>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//  --------------------------------------------------------------------------------------------------------------------
+//! Class CycleCounter
+//!   Cheap timestamps for the always-on operator timers: the time-stamp counter on x86,
+//!   the virtual counter on aarch64, and a steady clock in nanoseconds elsewhere.
+//  --------------------------------------------------------------------------------------------------------------------
+class CycleCounter
+{
+public:
+    //! Current value of the counter
+    static inline uint64_t now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t value;
+        asm volatile( "mrs %0, cntvct_el0" : "=r"( value ) );
+        return value;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+    }
+
+    //! Number of counts per second (calibrated at the first call)
+    static double perSecond();
+
+    //! Convert counts to seconds
+    static inline double seconds( uint64_t counts )
+    {
+        return ( double )counts / perSecond();
+    }
+};
+
+#endif
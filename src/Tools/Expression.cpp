@@ -0,0 +1,380 @@
+#include "Expression.h"
+
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+
+#include "Tools.h"
+
+using namespace std;
+
+// Number of points evaluated at once (the stack holds one block per level)
+static const unsigned int expression_block = 256;
+
+Expression::Expression( string expression, vector<string> array_variables, vector<string> scalar_variables, string errorPrefix ) :
+    expression_( expression ),
+    errorPrefix_( errorPrefix ),
+    array_variables_( array_variables ),
+    scalar_variables_( scalar_variables ),
+    uses_array_( array_variables.size(), false ),
+    position_( 0 ),
+    depth_( 0 ),
+    max_depth_( 0 )
+{
+    nextToken();
+    if( token_.empty() ) {
+        fail( "empty expression" );
+    }
+    parseOr();
+    if( ! token_.empty() ) {
+        fail( "unexpected `" + token_ + "`" );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Tokenizer: numbers, names, and operators of one or two characters
+// ---------------------------------------------------------------------------------------------------------------------
+void Expression::nextToken()
+{
+    while( position_ < expression_.size() && isspace( expression_[position_] ) ) {
+        position_++;
+    }
+    token_ = "";
+    if( position_ >= expression_.size() ) {
+        return;
+    }
+    size_t start = position_;
+    char c = expression_[position_];
+    if( isdigit( c ) || ( c == '.' && position_+1 < expression_.size() && isdigit( expression_[position_+1] ) ) ) {
+        char *end;
+        strtod( expression_.c_str() + start, &end );
+        position_ = end - expression_.c_str();
+    } else if( isalpha( c ) || c == '_' ) {
+        while( position_ < expression_.size() && ( isalnum( expression_[position_] ) || expression_[position_] == '_' ) ) {
+            position_++;
+        }
+    } else {
+        string two = expression_.substr( position_, 2 );
+        if( two == "**" || two == "<=" || two == ">=" || two == "==" || two == "!=" ) {
+            position_ += 2;
+        } else {
+            position_++;
+        }
+    }
+    token_ = expression_.substr( start, position_-start );
+}
+
+bool Expression::accept( string token )
+{
+    if( token_ == token ) {
+        nextToken();
+        return true;
+    }
+    return false;
+}
+
+void Expression::expect( string token )
+{
+    if( ! accept( token ) ) {
+        fail( "expected `" + token + "`" + ( token_.empty() ? "" : " instead of `" + token_ + "`" ) );
+    }
+}
+
+void Expression::fail( string message )
+{
+    ERROR( errorPrefix_ << ": " << message << " in expression \"" << expression_ << "\"" );
+}
+
+void Expression::push( OpCode code, double value, unsigned int index )
+{
+    Operation op = { code, value, index };
+    program_.push_back( op );
+    if( code == CONSTANT || code == ARRAY || code == SCALAR ) {
+        depth_++;
+        max_depth_ = max( max_depth_, depth_ );
+    } else if( code == WHERE ) {
+        depth_ -= 2;
+    } else if( code >= ADD ) {
+        depth_--;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Parser, by increasing precedence
+// ---------------------------------------------------------------------------------------------------------------------
+void Expression::parseOr()
+{
+    parseAnd();
+    while( accept( "|" ) || accept( "or" ) ) {
+        parseAnd();
+        push( OR );
+    }
+}
+
+void Expression::parseAnd()
+{
+    parseNot();
+    while( accept( "&" ) || accept( "and" ) ) {
+        parseNot();
+        push( AND );
+    }
+}
+
+void Expression::parseNot()
+{
+    if( accept( "~" ) || accept( "not" ) ) {
+        parseNot();
+        push( NOT );
+    } else {
+        parseComparison();
+    }
+}
+
+void Expression::parseComparison()
+{
+    parseSum();
+    const string operators[6] = { "<", "<=", ">", ">=", "==", "!=" };
+    const OpCode codes[6] = { LT, LE, GT, GE, EQ, NE };
+    for( unsigned int i=0; i<6; i++ ) {
+        if( accept( operators[i] ) ) {
+            parseSum();
+            push( codes[i] );
+            return;
+        }
+    }
+}
+
+void Expression::parseSum()
+{
+    parseProduct();
+    while( true ) {
+        if( accept( "+" ) ) {
+            parseProduct();
+            push( ADD );
+        } else if( accept( "-" ) ) {
+            parseProduct();
+            push( SUB );
+        } else {
+            break;
+        }
+    }
+}
+
+void Expression::parseProduct()
+{
+    parseUnary();
+    while( true ) {
+        if( accept( "*" ) ) {
+            parseUnary();
+            push( MUL );
+        } else if( accept( "/" ) ) {
+            parseUnary();
+            push( DIV );
+        } else {
+            break;
+        }
+    }
+}
+
+void Expression::parseUnary()
+{
+    if( accept( "-" ) ) {
+        parseUnary();
+        push( NEG );
+    } else if( accept( "+" ) ) {
+        parseUnary();
+    } else {
+        parsePower();
+    }
+}
+
+void Expression::parsePower()
+{
+    parseAtom();
+    if( accept( "**" ) ) {
+        // Right-associative, and binds tighter than the unary minus on its left
+        parseUnary();
+        push( POW );
+    }
+}
+
+void Expression::parseAtom()
+{
+    if( token_.empty() ) {
+        fail( "unexpected end" );
+    }
+    
+    // Parentheses
+    if( accept( "(" ) ) {
+        parseOr();
+        expect( ")" );
+        return;
+    }
+    
+    // Numbers
+    if( isdigit( token_[0] ) || token_[0] == '.' ) {
+        push( CONSTANT, atof( token_.c_str() ) );
+        nextToken();
+        return;
+    }
+    
+    if( ! ( isalpha( token_[0] ) || token_[0] == '_' ) ) {
+        fail( "unexpected `" + token_ + "`" );
+    }
+    string name = token_;
+    nextToken();
+    
+    // Functions
+    if( accept( "(" ) ) {
+        const string unary_names[8] = { "abs", "sqrt", "exp", "log", "sin", "cos", "tan", "tanh" };
+        const OpCode unary_codes[8] = { ABS, SQRT, EXP, LOG, SIN, COS, TAN, TANH };
+        for( unsigned int i=0; i<8; i++ ) {
+            if( name == unary_names[i] ) {
+                parseOr();
+                expect( ")" );
+                push( unary_codes[i] );
+                return;
+            }
+        }
+        if( name == "min" || name == "max" ) {
+            parseOr();
+            expect( "," );
+            parseOr();
+            expect( ")" );
+            push( name == "min" ? MIN : MAX );
+            return;
+        }
+        if( name == "where" ) {
+            parseOr();
+            expect( "," );
+            parseOr();
+            expect( "," );
+            parseOr();
+            expect( ")" );
+            push( WHERE );
+            return;
+        }
+        fail( "unknown function `" + name + "`" );
+    }
+    
+    // Variables and constants
+    for( unsigned int i=0; i<array_variables_.size(); i++ ) {
+        if( name == array_variables_[i] ) {
+            uses_array_[i] = true;
+            push( ARRAY, 0., i );
+            return;
+        }
+    }
+    for( unsigned int i=0; i<scalar_variables_.size(); i++ ) {
+        if( name == scalar_variables_[i] ) {
+            push( SCALAR, 0., i );
+            return;
+        }
+    }
+    if( name == "pi" ) {
+        push( CONSTANT, M_PI );
+        return;
+    }
+    fail( "unknown variable `" + name + "`" );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Evaluation by blocks of points: each operation is a simple loop over the block
+// ---------------------------------------------------------------------------------------------------------------------
+void Expression::evaluate( unsigned int npoints, const double *const *arrays, const double *scalars, double *result ) const
+{
+    // Small evaluations (a single point) only need a small stack
+    unsigned int block = min( expression_block, npoints );
+    vector<double> stack( max_depth_ * block );
+    
+    for( unsigned int start=0; start<npoints; start+=block ) {
+        unsigned int n = min( block, npoints-start );
+        // Number of blocks in the stack
+        unsigned int level = 0;
+        
+        for( unsigned int iop=0; iop<program_.size(); iop++ ) {
+            const Operation &op = program_[iop];
+            // Top of the stack, and the operand below it for binary operations
+            double *top = level>0 ? &stack[( level-1 )*block] : &stack[0];
+            double *a = level>1 ? &stack[( level-2 )*block] : &stack[0];
+            switch( op.code ) {
+                case CONSTANT: {
+                    top = &stack[( level++ )*block];
+                    double v = op.value;
+                    for( unsigned int i=0; i<n; i++ ) {
+                        top[i] = v;
+                    }
+                    break;
+                }
+                case SCALAR: {
+                    top = &stack[( level++ )*block];
+                    double v = scalars[op.index];
+                    for( unsigned int i=0; i<n; i++ ) {
+                        top[i] = v;
+                    }
+                    break;
+                }
+                case ARRAY: {
+                    top = &stack[( level++ )*block];
+                    const double *v = arrays[op.index] + start;
+                    for( unsigned int i=0; i<n; i++ ) {
+                        top[i] = v[i];
+                    }
+                    break;
+                }
+#define EXPRESSION_UNARY( CODE, F ) \
+                case CODE: \
+                    _Pragma( "omp simd" ) \
+                    for( unsigned int i=0; i<n; i++ ) { double x = top[i]; top[i] = F; } \
+                    break;
+#define EXPRESSION_BINARY( CODE, F ) \
+                case CODE: \
+                    _Pragma( "omp simd" ) \
+                    for( unsigned int i=0; i<n; i++ ) { double x = a[i], y = top[i]; a[i] = F; } \
+                    level--; \
+                    break;
+                EXPRESSION_UNARY( NEG, -x )
+                EXPRESSION_UNARY( NOT, ( x == 0. ) ? 1. : 0. )
+                EXPRESSION_UNARY( ABS, std::abs( x ) )
+                EXPRESSION_UNARY( SQRT, std::sqrt( x ) )
+                EXPRESSION_UNARY( EXP, std::exp( x ) )
+                EXPRESSION_UNARY( LOG, std::log( x ) )
+                EXPRESSION_UNARY( SIN, std::sin( x ) )
+                EXPRESSION_UNARY( COS, std::cos( x ) )
+                EXPRESSION_UNARY( TAN, std::tan( x ) )
+                EXPRESSION_UNARY( TANH, std::tanh( x ) )
+                EXPRESSION_BINARY( ADD, x + y )
+                EXPRESSION_BINARY( SUB, x - y )
+                EXPRESSION_BINARY( MUL, x * y )
+                EXPRESSION_BINARY( DIV, x / y )
+                EXPRESSION_BINARY( POW, std::pow( x, y ) )
+                EXPRESSION_BINARY( MIN, std::min( x, y ) )
+                EXPRESSION_BINARY( MAX, std::max( x, y ) )
+                EXPRESSION_BINARY( LT, ( x <  y ) ? 1. : 0. )
+                EXPRESSION_BINARY( LE, ( x <= y ) ? 1. : 0. )
+                EXPRESSION_BINARY( GT, ( x >  y ) ? 1. : 0. )
+                EXPRESSION_BINARY( GE, ( x >= y ) ? 1. : 0. )
+                EXPRESSION_BINARY( EQ, ( x == y ) ? 1. : 0. )
+                EXPRESSION_BINARY( NE, ( x != y ) ? 1. : 0. )
+                EXPRESSION_BINARY( AND, ( x != 0. && y != 0. ) ? 1. : 0. )
+                EXPRESSION_BINARY( OR, ( x != 0. || y != 0. ) ? 1. : 0. )
+                case WHERE: {
+                    double *c = &stack[( level-3 )*block];
+                    #pragma omp simd
+                    for( unsigned int i=0; i<n; i++ ) {
+                        c[i] = ( c[i] != 0. ) ? a[i] : top[i];
+                    }
+                    level -= 2;
+                    break;
+                }
+#undef EXPRESSION_UNARY
+#undef EXPRESSION_BINARY
+            }
+        }
+        
+        for( unsigned int i=0; i<n; i++ ) {
+            result[start+i] = stack[i];
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <string>
+#include <vector>
+
+//  --------------------------------------------------------------------------------------------------------------------
+//! Class Expression
+//!   Small arithmetic expression language, compiled once into a list of operations that are evaluated
+//!   on arrays of points (vectorized, thread-safe, no python interpreter involved).
+//!   Syntax: numbers, variables, + - * / ** , comparisons < <= > >= == != ,
+//!   logical & | ~ (or `and`, `or`, `not`), parentheses, constant `pi`
+//!   and functions abs, sqrt, exp, log, sin, cos, tan, tanh, min, max, where.
+//!   Comparisons and logical operators give 1 (true) or 0 (false); where(c, a, b) gives a if c is true, b otherwise.
+//  --------------------------------------------------------------------------------------------------------------------
+class Expression
+{
+public:
+    //! Compile an expression. Variables are either arrays (one value per point) or scalars.
+    //! An ERROR is raised, prefixed by `errorPrefix`, if the expression is invalid.
+    Expression( std::string expression, std::vector<std::string> array_variables, std::vector<std::string> scalar_variables, std::string errorPrefix );
+    ~Expression() {};
+    
+    //! Evaluate the expression on `npoints` points.
+    //! `arrays[i]` contains the values of the array variable `i` (NULL if not used), `scalars[i]` those of the scalar variable `i`.
+    void evaluate( unsigned int npoints, const double *const *arrays, const double *scalars, double *result ) const;
+    
+    //! Whether the expression uses the array variable `i`
+    bool usesArray( unsigned int i ) const
+    {
+        return uses_array_[i];
+    }
+    
+    //! The expression as given
+    std::string str() const
+    {
+        return expression_;
+    }
+
+private:
+    //! Operation codes of the compiled program
+    enum OpCode {
+        CONSTANT, ARRAY, SCALAR,
+        NEG, NOT, ABS, SQRT, EXP, LOG, SIN, COS, TAN, TANH,
+        ADD, SUB, MUL, DIV, POW, MIN, MAX,
+        LT, LE, GT, GE, EQ, NE, AND, OR,
+        WHERE
+    };
+    struct Operation {
+        OpCode code;
+        double value;
+        unsigned int index;
+    };
+    
+    //! Recursive descent parser, each level pushes its operations on the program
+    void parseOr();
+    void parseAnd();
+    void parseNot();
+    void parseComparison();
+    void parseSum();
+    void parseProduct();
+    void parseUnary();
+    void parsePower();
+    void parseAtom();
+    
+    //! Tokenizer
+    void nextToken();
+    bool accept( std::string token );
+    void expect( std::string token );
+    void fail( std::string message );
+    
+    //! Add an operation and update the stack depth
+    void push( OpCode code, double value=0., unsigned int index=0 );
+    
+    std::string expression_, errorPrefix_;
+    std::vector<std::string> array_variables_, scalar_variables_;
+    std::vector<bool> uses_array_;
+    
+    //! Parser state
+    size_t position_;
+    std::string token_;
+    
+    //! Compiled program in postfix order
+    std::vector<Operation> program_;
+    
+    //! Size of the evaluation stack
+    unsigned int depth_, max_depth_;
+};
+
+#endif
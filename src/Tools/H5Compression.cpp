@@ -0,0 +1,200 @@
+#include "H5Compression.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include "PyTools.h"
+
+using namespace std;
+
+H5Compression::H5Compression() :
+    deflate_( 0 ),
+    shuffle_( true ),
+    filter_( 0 ),
+    single_precision_( false ),
+    mantissa_bits_( 0 )
+{
+}
+
+void H5Compression::extract( string block, int idiag, string errorPrefix )
+{
+    vector<unsigned int> chunks;
+    PyTools::extract( "chunks", chunks, block, idiag );
+    chunks_.assign( chunks.begin(), chunks.end() );
+    for( unsigned int i=0; i<chunks_.size(); i++ ) {
+        if( chunks_[i] == 0 ) {
+            ERROR( errorPrefix << ": `chunks` must be strictly positive" );
+        }
+    }
+    
+    PyTools::extract( "compression", deflate_, block, idiag );
+    if( deflate_ < 0 || deflate_ > 9 ) {
+        ERROR( errorPrefix << ": `compression` must be between 0 and 9" );
+    }
+    PyTools::extract( "shuffle", shuffle_, block, idiag );
+    PyTools::extract( "hdf5_filter", filter_, block, idiag );
+    PyTools::extract( "hdf5_filter_parameters", filter_parameters_, block, idiag );
+    
+    string precision = "double";
+    PyTools::extract( "precision", precision, block, idiag );
+    if( precision != "double" && precision != "single" ) {
+        ERROR( errorPrefix << ": `precision` must be \"double\" or \"single\"" );
+    }
+    single_precision_ = ( precision == "single" );
+    
+    PyTools::extract( "mantissa_bits", mantissa_bits_, block, idiag );
+    if( mantissa_bits_ >= ( single_precision_ ? 23 : 52 ) ) {
+        mantissa_bits_ = 0;
+    }
+    
+    if( filtered() ) {
+#if H5_VERS_MAJOR == 1 && ( H5_VERS_MINOR < 10 || ( H5_VERS_MINOR == 10 && H5_VERS_RELEASE < 2 ) )
+        ERROR( errorPrefix << ": compression requires HDF5 1.10.2 or newer (parallel writes of filtered datasets)" );
+#endif
+        if( deflate_ > 0 && H5Zfilter_avail( H5Z_FILTER_DEFLATE ) <= 0 ) {
+            ERROR( errorPrefix << ": the deflate filter is not available in this HDF5 library" );
+        }
+        if( filter_ > 0 && H5Zfilter_avail( ( H5Z_filter_t ) filter_ ) <= 0 ) {
+            ERROR( errorPrefix << ": HDF5 filter " << filter_ << " is not available (check HDF5_PLUGIN_PATH)" );
+        }
+    }
+}
+
+void H5Compression::setDatasetCreation( hid_t dcreate, unsigned int ndim, const hsize_t *dims, const hsize_t *chunks ) const
+{
+    if( ! filtered() && chunks_.size() == 0 ) {
+        return;
+    }
+    
+    // Empty datasets cannot be chunked
+    for( unsigned int i=0; i<ndim; i++ ) {
+        if( dims[i] == 0 ) {
+            return;
+        }
+    }
+    
+    vector<hsize_t> c( ndim, 1 );
+    if( chunks_.size() > 0 ) {
+        if( chunks_.size() != ndim ) {
+            ERROR( "`chunks` must have " << ndim << " elements for this diagnostic" );
+        }
+        for( unsigned int i=0; i<ndim; i++ ) {
+            c[i] = min( chunks_[i], dims[i] );
+        }
+    } else {
+        // Start from the proposed chunks, and grow them until they reach about 2 MB
+        const hsize_t target = 1<<18;
+        hsize_t size = 1;
+        for( unsigned int i=0; i<ndim; i++ ) {
+            c[i] = chunks ? max( ( hsize_t )1, min( chunks[i], dims[i] ) ) : 1;
+            size *= c[i];
+        }
+        bool grown = true;
+        while( size < target && grown ) {
+            grown = false;
+            for( int i=ndim-1; i>=0 && size < target; i-- ) {
+                if( c[i] < dims[i] ) {
+                    size /= c[i];
+                    c[i] = min( 2*c[i], dims[i] );
+                    size *= c[i];
+                    grown = true;
+                }
+            }
+        }
+    }
+    
+    // HDF5 chunks must be smaller than 4 GB
+    const hsize_t max_size = 4294967295/2/sizeof( double );
+    while( true ) {
+        hsize_t size = 1;
+        for( unsigned int i=0; i<ndim; i++ ) {
+            size *= c[i];
+        }
+        if( size <= max_size ) {
+            break;
+        }
+        unsigned int largest = max_element( c.begin(), c.end() ) - c.begin();
+        c[largest] = ( c[largest]+1 )/2;
+    }
+    
+    H5Pset_layout( dcreate, H5D_CHUNKED );
+    H5Pset_chunk( dcreate, ndim, &c[0] );
+    
+    if( filtered() ) {
+        // No need to write fill values, all the data is written at once
+        H5Pset_fill_time( dcreate, H5D_FILL_TIME_NEVER );
+        if( shuffle_ ) {
+            H5Pset_shuffle( dcreate );
+        }
+        if( deflate_ > 0 ) {
+            H5Pset_deflate( dcreate, deflate_ );
+        }
+        if( filter_ > 0 ) {
+            H5Pset_filter( dcreate, ( H5Z_filter_t ) filter_, H5Z_FLAG_MANDATORY, filter_parameters_.size(), filter_parameters_.size()>0 ? &filter_parameters_[0] : NULL );
+        }
+    }
+}
+
+void H5Compression::truncate( double *data, uint64_t size ) const
+{
+    if( mantissa_bits_ == 0 ) {
+        return;
+    }
+    
+    // Round to nearest on the kept bits, so that the dropped bits are zeros (well compressed)
+    const unsigned int dropped = 52 - mantissa_bits_;
+    const uint64_t half = ( uint64_t )1 << ( dropped-1 );
+    const uint64_t mask = ~( ( ( uint64_t )1 << dropped ) - 1 );
+    const uint64_t exponent = ( uint64_t )0x7FF << 52;
+    
+    #pragma omp simd
+    for( uint64_t i=0; i<size; i++ ) {
+        uint64_t bits;
+        memcpy( &bits, &data[i], sizeof( double ) );
+        // Infinities and NaNs are unchanged
+        if( ( bits & exponent ) != exponent ) {
+            bits = ( bits + half ) & mask;
+        }
+        memcpy( &data[i], &bits, sizeof( double ) );
+    }
+}
+
+double H5Compression::estimatedRatio() const
+{
+    double ratio = single_precision_ ? 0.5 : 1.;
+    if( filtered() ) {
+        // Sign and exponent are kept, dropped mantissa bits compress almost entirely,
+        // and the remaining bits are assumed to compress by about 20%
+        double total_bits = single_precision_ ? 32. : 64.;
+        double mantissa = mantissa_bits_ > 0 ? mantissa_bits_ : total_bits - ( single_precision_ ? 9. : 12. );
+        ratio *= 0.8 * ( total_bits - ( single_precision_ ? 23. : 52. ) + mantissa ) / total_bits;
+    }
+    return ratio;
+}
+
+string H5Compression::info() const
+{
+    ostringstream s( "" );
+    if( single_precision_ ) {
+        s << " single precision";
+    }
+    if( mantissa_bits_ > 0 ) {
+        s << " " << mantissa_bits_ << "-bit mantissa";
+    }
+    if( deflate_ > 0 ) {
+        s << " deflate " << deflate_;
+    }
+    if( filter_ > 0 ) {
+        s << " hdf5_filter " << filter_;
+    }
+    if( filtered() && shuffle_ ) {
+        s << " shuffle";
+    }
+    if( chunks_.size() > 0 ) {
+        s << " chunks";
+        for( unsigned int i=0; i<chunks_.size(); i++ ) {
+            s << ( i==0 ? " " : "x" ) << chunks_[i];
+        }
+    }
+    return s.str();
+}
@@ -0,0 +1,67 @@
+#ifndef H5COMPRESSION_H
+#define H5COMPRESSION_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "H5.h"
+
+//  --------------------------------------------------------------------------------------------------------------------
+//! Class H5Compression
+//!   Chunks, filters and precision of the datasets written by a diagnostic.
+//!   Filters with parallel HDF5 require collective writes (HDF5 >= 1.10.2).
+//  --------------------------------------------------------------------------------------------------------------------
+class H5Compression
+{
+public:
+    H5Compression();
+    
+    //! Read the options in a namelist block
+    void extract( std::string block, int idiag, std::string errorPrefix );
+    
+    //! True if the datasets are filtered (they must then be chunked and written collectively)
+    bool filtered() const
+    {
+        return deflate_>0 || filter_>0;
+    }
+    
+    //! Set the chunks and filters of a dataset of dimensions `dims`.
+    //! `chunks` proposes default chunk dimensions, and may be NULL
+    void setDatasetCreation( hid_t dcreate, unsigned int ndim, const hsize_t *dims, const hsize_t *chunks=NULL ) const;
+    
+    //! Type of the floating-point datasets in the file
+    hid_t fileType() const
+    {
+        return single_precision_ ? H5T_NATIVE_FLOAT : H5T_NATIVE_DOUBLE;
+    }
+    
+    //! Round the mantissa of the data to the requested number of bits, before writing
+    void truncate( double *data, uint64_t size ) const;
+    //! Other types are not truncated
+    template<typename T>
+    void truncate( T *, uint64_t ) const {};
+    
+    //! Rough estimate of the ratio between the size of the floating-point data in the file and their raw size
+    double estimatedRatio() const;
+    
+    //! Description for the log
+    std::string info() const;
+
+private:
+    //! User chunk dimensions (empty for automatic)
+    std::vector<hsize_t> chunks_;
+    //! Level of the deflate filter (0 for none)
+    int deflate_;
+    //! Whether the shuffle filter precedes the compression
+    bool shuffle_;
+    //! Id of an additional HDF5 filter (0 for none) and its parameters
+    int filter_;
+    std::vector<unsigned int> filter_parameters_;
+    //! Whether floating-point data are written in single precision
+    bool single_precision_;
+    //! Number of bits kept in the mantissa (0 to keep all)
+    unsigned int mantissa_bits_;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "HardwareCounters.h"
+
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Tools.h"
+
+using namespace std;
+
+const char *HardwareCounters::names[HardwareCounters::N_EVENTS] = {
+    "cycles", "instructions", "L1D_read_misses", "LLC_read_misses", "cache_misses"
+};
+
+bool HardwareCounters::enabled_ = false;
+vector<vector<int> > HardwareCounters::fds_;
+
+void HardwareCounters::enable()
+{
+#ifdef __linux__
+    if( enabled_ ) {
+        return;
+    }
+#ifdef _OPENMP
+    fds_.resize( omp_get_max_threads() );
+#else
+    fds_.resize( 1 );
+#endif
+    enabled_ = true;
+#else
+    WARNING( "Hardware counters are only available on Linux" );
+#endif
+}
+
+void HardwareCounters::read( double *values )
+{
+    for( unsigned int i=0; i<N_EVENTS; i++ ) {
+        values[i] = 0.;
+    }
+#ifdef __linux__
+#ifdef _OPENMP
+    vector<int> &fds = fds_[omp_get_thread_num()];
+#else
+    vector<int> &fds = fds_[0];
+#endif
+
+    // First read on this thread: open the counters
+    if( fds.empty() ) {
+        const uint64_t L1D_read_miss = PERF_COUNT_HW_CACHE_L1D
+                                       | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+        const uint64_t LLC_read_miss = PERF_COUNT_HW_CACHE_LL
+                                       | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+        uint32_t types  [N_EVENTS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+        uint64_t configs[N_EVENTS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, L1D_read_miss, LLC_read_miss, PERF_COUNT_HW_CACHE_MISSES };
+        fds.resize( N_EVENTS, -1 );
+        bool any = false;
+        for( unsigned int i=0; i<N_EVENTS; i++ ) {
+            struct perf_event_attr attr;
+            memset( &attr, 0, sizeof( attr ) );
+            attr.size = sizeof( attr );
+            attr.type = types[i];
+            attr.config = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            // pid 0 and cpu -1: the calling thread, on any cpu
+            fds[i] = syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+            any = any || fds[i] >= 0;
+        }
+        if( ! any && &fds == &fds_[0] ) {
+            WARNING( "Hardware counters could not be opened (check /proc/sys/kernel/perf_event_paranoid)" );
+        }
+    }
+
+    for( unsigned int i=0; i<N_EVENTS; i++ ) {
+        if( fds[i] < 0 ) {
+            continue;
+        }
+        // value, time enabled, time running: scale the value when the counters are multiplexed
+        uint64_t buffer[3];
+        if( ::read( fds[i], buffer, sizeof( buffer ) ) == sizeof( buffer ) && buffer[2] > 0 ) {
+            values[i] = ( double )buffer[0] * ( ( double )buffer[1] / ( double )buffer[2] );
+        }
+    }
+#endif
+}
+
+void HardwareCounters::close()
+{
+    for( unsigned int ithread=0; ithread<fds_.size(); ithread++ ) {
+        for( unsigned int i=0; i<fds_[ithread].size(); i++ ) {
+            if( fds_[ithread][i] >= 0 ) {
+                ::close( fds_[ithread][i] );
+            }
+        }
+        fds_[ithread].clear();
+    }
+    enabled_ = false;
+}
@@ -0,0 +1,47 @@
+#ifndef HARDWARECOUNTERS_H
+#define HARDWARECOUNTERS_H
+
+#include <string>
+#include <vector>
+
+//  --------------------------------------------------------------------------------------------------------------------
+//! Class HardwareCounters
+//!   Hardware performance counters of each thread, read through the Linux perf_event_open interface.
+//!   Each thread opens its own counters at its first read, so that only its own activity is counted.
+//!   Events not supported by the processor (or forbidden by perf_event_paranoid) always read zero.
+//  --------------------------------------------------------------------------------------------------------------------
+class HardwareCounters
+{
+public:
+    //! Counted events
+    enum Event { CYCLES, INSTRUCTIONS, L1D_READ_MISSES, LLC_READ_MISSES, CACHE_MISSES, N_EVENTS };
+
+    //! Names of the events, as written in the outputs
+    static const char *names[N_EVENTS];
+
+    //! Size of a cache line, used to estimate the memory traffic from CACHE_MISSES
+    static const unsigned int cache_line = 64;
+
+    //! Activate the counters (must be called outside of the parallel region)
+    static void enable();
+
+    //! Whether the counters are active
+    static bool enabled()
+    {
+        return enabled_;
+    }
+
+    //! Read the current values of the counters of the calling thread
+    static void read( double *values );
+
+    //! Close the counters of all threads
+    static void close();
+
+private:
+    static bool enabled_;
+
+    //! File descriptors of the counters of each thread (empty until the thread opens them)
+    static std::vector<std::vector<int> > fds_;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include "SharedMemoryRing.h"
+
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "PyTools.h"
+#include "Tools.h"
+
+using namespace std;
+
+// The layout of the segment is documented for the consumers
+static_assert( sizeof( SharedMemoryRing::Header ) <= 64 && sizeof( SharedMemoryRing::Record ) == 288, "Unexpected layout of the shared memory" );
+
+SharedMemoryRing *SharedMemoryRing::create( string block, unsigned int idiag, int rank, string errorPrefix, bool fixed_size )
+{
+    string output = "hdf5";
+    PyTools::extract( "output", output, block, idiag );
+    if( output == "hdf5" ) {
+        return NULL;
+    }
+    if( output != "shared_memory" ) {
+        ERROR( errorPrefix << ": `output` must be \"hdf5\" or \"shared_memory\"" );
+    }
+
+    int nslots = 0;
+    PyTools::extract( "shared_memory_slots", nslots, block, idiag );
+    if( nslots < 0 ) {
+        ERROR( errorPrefix << ": `shared_memory_slots` must be positive" );
+    }
+    double slot_size = 0.;
+    PyTools::extract( "shared_memory_slot_size", slot_size, block, idiag );
+    if( slot_size < 0. ) {
+        ERROR( errorPrefix << ": `shared_memory_slot_size` must be positive" );
+    }
+    if( slot_size == 0. && ! fixed_size ) {
+        ERROR( errorPrefix << ": `shared_memory_slot_size` is required, as the size of the arrays changes between outputs" );
+    }
+    string policy = "drop_oldest";
+    PyTools::extract( "shared_memory_policy", policy, block, idiag );
+    if( policy != "drop_oldest" && policy != "block" ) {
+        ERROR( errorPrefix << ": `shared_memory_policy` must be \"drop_oldest\" or \"block\"" );
+    }
+
+    // The process id keeps apart the segments of simultaneous simulations on the same node
+    ostringstream name( "" );
+    name << "/smilei_" << getpid() << "_" << block << idiag << "_" << rank;
+    return new SharedMemoryRing( name.str(), nslots, ( uint64_t )( slot_size * 1048576. ), policy == "block" ? BLOCK : DROP_OLDEST );
+}
+
+SharedMemoryRing::SharedMemoryRing( string name, unsigned int nslots, uint64_t slot_size, Policy policy ) :
+    name_( name ),
+    nslots_( nslots ),
+    slot_size_( slot_size ),
+    policy_( policy ),
+    header_( NULL ),
+    segment_size_( 0 ),
+    warned_too_large_( false ),
+    warned_blocked_( false )
+{
+}
+
+SharedMemoryRing::~SharedMemoryRing()
+{
+    // Consumers that have mapped the segment can still read it after it is unlinked
+    if( header_ ) {
+        munmap( header_, segment_size_ );
+        shm_unlink( name_.c_str() );
+    }
+}
+
+void SharedMemoryRing::map()
+{
+    int rank;
+    MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+    
+    // Automatic sizes: two dumps, each in slots fitting the largest array
+    if( nslots_ == 0 ) {
+        nslots_ = 2 * max( pending_.size(), ( size_t )1 );
+    } else if( nslots_ < pending_.size() ) {
+        __header( "WARNING proc " << rank, name_ << ": " << nslots_ << " slots for " << pending_.size()
+                  << " arrays per output, which overwrite each other (increase shared_memory_slots)" );
+    }
+    if( slot_size_ == 0 ) {
+        for( unsigned int i=0; i<pending_.size(); i++ ) {
+            slot_size_ = max( slot_size_, ( uint64_t )( sizeof( Record ) + pending_[i].data.size() ) );
+        }
+    }
+    // Keep slots aligned on cache lines
+    slot_size_ = ( ( slot_size_ + 63 ) / 64 ) * 64;
+    uint64_t header_size = ( ( sizeof( Header ) + 63 ) / 64 ) * 64;
+    segment_size_ = header_size + nslots_ * slot_size_;
+
+    // Remove a segment left by a terminated process which had the same id
+    shm_unlink( name_.c_str() );
+    int fd = shm_open( name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+    if( fd < 0 || ftruncate( fd, segment_size_ ) != 0 ) {
+        ERROR( "Could not create the shared memory segment " << name_ << " (" << strerror( errno ) << ")" );
+    }
+    void *segment = mmap( NULL, segment_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    if( segment == MAP_FAILED ) {
+        ERROR( "Could not map the shared memory segment " << name_ << " (" << strerror( errno ) << ")" );
+    }
+
+    header_ = static_cast<Header *>( segment );
+    header_->version = 1;
+    header_->policy = policy_;
+    header_->nslots = nslots_;
+    header_->slot_size = slot_size_;
+    header_->published.store( 0 );
+    header_->consumed.store( 0 );
+    // The magic is written last: consumers wait for it before reading the header
+    atomic_thread_fence( memory_order_release );
+    memcpy( header_->magic, "SMILEIRB", 8 );
+}
+
+void SharedMemoryRing::publishBytes( int timestep, string name, Type type, uint64_t type_size, const void *data,
+                                     vector<uint64_t> &shape, vector<uint64_t> &offset, vector<uint64_t> &global_shape )
+{
+    uint64_t nbytes = type_size;
+    for( unsigned int i=0; i<shape.size(); i++ ) {
+        nbytes *= shape[i];
+    }
+    
+    // The records of the first dump are kept until the segment exists
+    if( ! header_ ) {
+        Pending p;
+        p.timestep = timestep;
+        p.name = name;
+        p.type = type;
+        p.data.assign( static_cast<const char *>( data ), static_cast<const char *>( data ) + nbytes );
+        p.shape = shape;
+        p.offset = offset;
+        p.global_shape = global_shape;
+        pending_.push_back( p );
+        return;
+    }
+    
+    store( timestep, name, type, nbytes, data, shape, offset, global_shape );
+}
+
+void SharedMemoryRing::endDump()
+{
+    if( header_ ) {
+        return;
+    }
+    map();
+    for( unsigned int i=0; i<pending_.size(); i++ ) {
+        Pending &p = pending_[i];
+        store( p.timestep, p.name, p.type, p.data.size(), p.data.data(), p.shape, p.offset, p.global_shape );
+    }
+    vector<Pending>().swap( pending_ );
+}
+
+void SharedMemoryRing::store( int timestep, string &name, Type type, uint64_t nbytes, const void *data,
+                              vector<uint64_t> &shape, vector<uint64_t> &offset, vector<uint64_t> &global_shape )
+{
+    int rank;
+    MPI_Comm_rank( MPI_COMM_WORLD, &rank );
+    if( sizeof( Record ) + nbytes > slot_size_ ) {
+        if( ! warned_too_large_ ) {
+            __header( "WARNING proc " << rank, name_ << ": records too large for the slots are dropped (increase shared_memory_slot_size)" );
+            warned_too_large_ = true;
+        }
+        return;
+    }
+
+    uint64_t n = header_->published.load( memory_order_relaxed );
+
+    // Back-pressure: wait until the consumer has read the record that occupies the slot
+    if( policy_ == BLOCK ) {
+        auto start = chrono::steady_clock::now();
+        while( n - header_->consumed.load( memory_order_acquire ) >= nslots_ ) {
+            if( ! warned_blocked_ && chrono::steady_clock::now() - start > chrono::seconds( 10 ) ) {
+                __header( "WARNING proc " << rank, name_ << ": waiting for the consumer to read the shared memory" );
+                warned_blocked_ = true;
+            }
+            this_thread::sleep_for( chrono::microseconds( 100 ) );
+        }
+    }
+
+    char *slot = reinterpret_cast<char *>( header_ ) + ( ( sizeof( Header ) + 63 ) / 64 ) * 64 + ( n % nslots_ ) * slot_size_;
+    Record *record = reinterpret_cast<Record *>( slot );
+
+    record->sequence.store( 2*n+1, memory_order_relaxed );
+    atomic_thread_fence( memory_order_release );
+    record->timestep = timestep;
+    strncpy( record->name, name.c_str(), sizeof( record->name ) - 1 );
+    record->name[sizeof( record->name ) - 1] = '\0';
+    record->type = type;
+    record->ndims = shape.size();
+    for( unsigned int i=0; i<8; i++ ) {
+        record->shape[i] = i < shape.size() ? shape[i] : 1;
+        record->offset[i] = i < offset.size() ? offset[i] : 0;
+        record->global_shape[i] = i < global_shape.size() ? global_shape[i] : 1;
+    }
+    record->nbytes = nbytes;
+    if( nbytes > 0 ) {
+        memcpy( slot + sizeof( Record ), data, nbytes );
+    }
+    record->sequence.store( 2*n+2, memory_order_release );
+    header_->published.store( n+1, memory_order_release );
+}
@@ -0,0 +1,119 @@
+#ifndef SHAREDMEMORYRING_H
+#define SHAREDMEMORYRING_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+//  --------------------------------------------------------------------------------------------------------------------
+//! Class SharedMemoryRing
+//!   Ring buffer in a POSIX shared-memory segment (/dev/shm/smilei_<pid>_<diagnostic>_<process>), where a diagnostic
+//!   publishes its data instead of writing HDF5 files, for analysis programs running on the same node.
+//!   The segment starts with a Header, followed by `nslots` slots of `slot_size` bytes. Each slot holds
+//!   one Record (the metadata of an array) followed by the array itself.
+//!   The arrays of one output form a dump, closed by endDump(). The segment is created at the end of the
+//!   first dump, so that the automatic sizes account for all its arrays.
+//!   Record number n goes to slot n % nslots. Its `sequence` is odd while it is written, and equal to 2n+2
+//!   once it is complete: a consumer checks it before and after copying the array.
+//!   When the consumer is too slow, the policy "drop_oldest" overwrites the oldest records, while the
+//!   policy "block" waits until the consumer has increased `consumed` (back-pressure).
+//  --------------------------------------------------------------------------------------------------------------------
+class SharedMemoryRing
+{
+public:
+    enum Policy { DROP_OLDEST, BLOCK };
+    enum Type { FLOAT64, UINT64, INT16 };
+
+    struct Header {
+        char magic[8]; // "SMILEIRB"
+        uint32_t version;
+        uint32_t policy;
+        uint64_t nslots;
+        uint64_t slot_size;
+        //! Number of records published
+        std::atomic<uint64_t> published;
+        //! Number of records read, set by the consumer
+        std::atomic<uint64_t> consumed;
+    };
+
+    struct Record {
+        std::atomic<uint64_t> sequence;
+        int64_t timestep;
+        char name[64];
+        uint32_t type;
+        uint32_t ndims;
+        //! Shape of the array, and its position in the global array of all processes
+        uint64_t shape[8], offset[8], global_shape[8];
+        uint64_t nbytes;
+    };
+
+    //! Read the options `output`, `shared_memory_slots`, `shared_memory_slot_size` and `shared_memory_policy`
+    //! of the diagnostic `block` #`idiag`. Returns NULL when the output is "hdf5".
+    //! The slot size may be automatic only if the arrays keep the same size at every dump (`fixed_size`).
+    static SharedMemoryRing *create( std::string block, unsigned int idiag, int rank, std::string errorPrefix, bool fixed_size );
+
+    SharedMemoryRing( std::string name, unsigned int nslots, uint64_t slot_size, Policy policy );
+    ~SharedMemoryRing();
+
+    //! Publish an array of `shape`, located at `offset` in the global array of `global_shape`
+    template<typename T>
+    void publish( int timestep, std::string name, const T *data,
+                  std::vector<uint64_t> shape, std::vector<uint64_t> offset, std::vector<uint64_t> global_shape )
+    {
+        publishBytes( timestep, name, type( data ), sizeof( T ), data, shape, offset, global_shape );
+    }
+    
+    //! Tell that all the arrays of the current output have been published
+    void endDump();
+
+    //! Name of the segment
+    std::string name_;
+
+private:
+    static Type type( const double * )
+    {
+        return FLOAT64;
+    }
+    static Type type( const uint64_t * )
+    {
+        return UINT64;
+    }
+    static Type type( const short * )
+    {
+        return INT16;
+    }
+
+    void publishBytes( int timestep, std::string name, Type type, uint64_t type_size, const void *data,
+                       std::vector<uint64_t> &shape, std::vector<uint64_t> &offset, std::vector<uint64_t> &global_shape );
+
+    //! Copy a record in the next slot
+    void store( int timestep, std::string &name, Type type, uint64_t nbytes, const void *data,
+                std::vector<uint64_t> &shape, std::vector<uint64_t> &offset, std::vector<uint64_t> &global_shape );
+
+    //! Create the segment, sized from the records of the first dump when no sizes were given
+    void map();
+
+    //! Records of the first dump, kept until the segment is created
+    struct Pending {
+        int timestep;
+        std::string name;
+        Type type;
+        std::vector<char> data;
+        std::vector<uint64_t> shape, offset, global_shape;
+    };
+    std::vector<Pending> pending_;
+
+    unsigned int nslots_;
+    uint64_t slot_size_;
+    Policy policy_;
+
+    //! Mapped segment (NULL until the end of the first dump)
+    Header *header_;
+    uint64_t segment_size_;
+
+    //! Whether the user was already warned about dropped records or a blocked consumer
+    bool warned_too_large_, warned_blocked_;
+};
+
+#endif
@@ -8,6 +8,8 @@
 #include "SmileiMPI.h"
 #include "Tools.h"
 #include "VectorPatch.h"
+#include "HardwareCounters.h"
+#include "Tracer.h"
 
 using namespace std;
 
@@ -17,6 +19,7 @@ Timer::Timer( string name ) :
     smpi_( NULL )
 {
     register_timers.resize( 0, 0. );
+    counters_acc_.resize( HardwareCounters::N_EVENTS, 0. );
 }
 
 Timer::~Timer()
@@ -26,6 +29,11 @@ Timer::~Timer()
 void Timer::init( SmileiMPI *smpi )
 {
     smpi_ = smpi;
+#ifdef _OPENMP
+    counters_start_.resize( omp_get_max_threads() );
+#else
+    counters_start_.resize( 1 );
+#endif
     smpi_->barrier();
     last_start_ = MPI_Wtime();
 }
@@ -33,7 +41,15 @@ void Timer::init( SmileiMPI *smpi )
 //! Accumulate time couting from last init/restart
 void Timer::update( bool store )
 {
+    // The wait for the other threads is traced apart from the phase, to show the imbalance,
+    // and it is not accounted in the hardware counters of the phase
+    Tracer::end( name_.c_str() );
+    if( HardwareCounters::enabled() ) {
+        updateCounters( true );
+    }
+    Tracer::begin( "barrier" );
     #pragma omp barrier
+    Tracer::end( "barrier" );
     #pragma omp master
     {
         time_acc_ +=  MPI_Wtime()-last_start_;
@@ -43,6 +59,9 @@ void Timer::update( bool store )
             register_timers.push_back( time_acc_ );
         }
     }
+    if( HardwareCounters::enabled() ) {
+        updateCounters( false );
+    }
 }
 
 #ifdef __DETAILED_TIMERS
@@ -86,6 +105,28 @@ void Timer::restart()
     {
         last_start_ = MPI_Wtime();
     }
+    Tracer::begin( name_.c_str() );
+    if( HardwareCounters::enabled() ) {
+        updateCounters( false );
+    }
+}
+
+void Timer::updateCounters( bool accumulate )
+{
+    double values[HardwareCounters::N_EVENTS];
+    HardwareCounters::read( values );
+#ifdef _OPENMP
+    vector<double> &start = counters_start_[omp_get_thread_num()];
+#else
+    vector<double> &start = counters_start_[0];
+#endif
+    if( accumulate && ! start.empty() ) {
+        for( unsigned int i=0; i<HardwareCounters::N_EVENTS; i++ ) {
+            #pragma omp atomic
+            counters_acc_[i] += values[i] - start[i];
+        }
+    }
+    start.assign( values, values+HardwareCounters::N_EVENTS );
 }
 
 void Timer::reboot()
@@ -94,6 +135,10 @@ void Timer::reboot()
     last_start_ =  MPI_Wtime();
     time_acc_ = 0.;
     register_timers.clear();
+    counters_acc_.assign( HardwareCounters::N_EVENTS, 0. );
+    for( unsigned int ithread=0; ithread<counters_start_.size(); ithread++ ) {
+        counters_start_[ithread].clear();
+    }
 }
 
 void Timer::print( double tot )
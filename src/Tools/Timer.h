@@ -52,6 +52,9 @@ public:
     
     std::vector<double> register_timers;
     
+    //! Hardware counters accumulated by all the threads, when HardwareCounters are enabled
+    std::vector<double> counters_acc_;
+    
 #ifdef __DETAILED_TIMERS
     //! Id of the associated timer in the patch timer array
     unsigned int patch_timer_id;
@@ -63,6 +66,12 @@ private:
     //! MPI process timer synchronized through MPI
     SmileiMPI *smpi_;
     
+    //! Hardware counters of each thread at the last start (empty if not started)
+    std::vector<std::vector<double> > counters_start_;
+    
+    //! Accumulate the hardware counters of the calling thread since the last start, and restart them
+    void updateCounters( bool accumulate );
+    
 };
 
 
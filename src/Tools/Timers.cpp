@@ -5,6 +5,7 @@
 
 #include "SmileiMPI.h"
 #include "Tools.h"
+#include "HardwareCounters.h"
 
 using namespace std;
 
@@ -129,6 +130,21 @@ void Timers::profile( SmileiMPI *smpi )
 {
     std::vector<Timer *> avg_timers = consolidate( smpi, true );
     
+    // Hardware counters and times of the main timers, summed over all processes
+    unsigned int nevents = HardwareCounters::N_EVENTS;
+    std::vector<double> counters, times;
+    if( HardwareCounters::enabled() ) {
+        std::vector<double> local_counters, local_times;
+        for( unsigned int i=1 ; i<patch_timer_id_start+1 ; i++ ) {
+            local_counters.insert( local_counters.end(), timers[i]->counters_acc_.begin(), timers[i]->counters_acc_.end() );
+            local_times.push_back( timers[i]->getTime() );
+        }
+        counters.resize( local_counters.size() );
+        times.resize( local_times.size() );
+        MPI_Reduce( &local_counters[0], &counters[0], counters.size(), MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
+        MPI_Reduce( &local_times[0], &times[0], times.size(), MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD );
+    }
+    
     if( smpi->isMaster() ) {
         double coverage( 0. );
         // Computation of the coverage: it only takes into account
@@ -164,6 +180,24 @@ void Timers::profile( SmileiMPI *smpi )
         
 #endif
         
+        if( HardwareCounters::enabled() ) {
+            MESSAGE( "\n Hardware counters (summed over threads and processes):" );
+            MESSAGE( 0, "\t" << setw( 20 ) << "" << "\t  IPC   L1D miss/kinstr   LLC miss/kinstr   memory GB/s per process" );
+            for( unsigned int i=0 ; i<times.size() ; i++ ) {
+                double *c = &counters[i*nevents];
+                if( c[HardwareCounters::INSTRUCTIONS] <= 0. ) {
+                    continue;
+                }
+                double kinstr = c[HardwareCounters::INSTRUCTIONS] * 1.e-3;
+                MESSAGE( 0, "\t" << setw( 20 ) << timers[i+1]->name_ << "\t" << fixed << setprecision( 2 )
+                         << setw( 5 ) << ( c[HardwareCounters::CYCLES] > 0. ? c[HardwareCounters::INSTRUCTIONS] / c[HardwareCounters::CYCLES] : 0. )
+                         << setw( 18 ) << c[HardwareCounters::L1D_READ_MISSES] / kinstr
+                         << setw( 18 ) << c[HardwareCounters::LLC_READ_MISSES] / kinstr
+                         << setw( 18 ) << ( times[i] > 0. ? c[HardwareCounters::CACHE_MISSES] * HardwareCounters::cache_line / times[i] * 1.e-9 : 0. )
+                         << defaultfloat << setprecision( 6 ) );
+            }
+        }
+        
     }
     for( unsigned int i=0 ; i<avg_timers.size() ; i++ ) {
         delete avg_timers[i];
@@ -78,6 +78,36 @@ double Tools::getMemFootPrint()
     
 }
 
+double Tools::getMemPeak()
+{
+    char filename[80];
+    char sbuf[4096];
+    
+    sprintf( filename, "/proc/%ld/status", ( long )getpid() );
+    
+    if( ! file_exists( filename ) ) {
+        return 0;
+    }
+    
+    int fd = open( filename, O_RDONLY, 0 );
+    int num_read=read( fd, sbuf, ( sizeof sbuf )-1 );
+    close( fd );
+    
+    if( num_read <= 0 ) {
+        return 0;
+    }
+    sbuf[num_read] = '\0';
+    
+    // Peak resident set size
+    char *S = strstr( sbuf, "VmHWM:" );
+    if( ! S ) {
+        return 0;
+    }
+    
+    // Return the peak RSS in Gb
+    return ( double )atol( S+6 )/1024./1024.;
+}
+
 
 std::string Tools::printBytes( uint64_t nbytes )
 {
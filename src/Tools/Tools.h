@@ -110,6 +110,8 @@ class Tools
 public:
     static void printMemFootPrint( std::string tag );
     static double getMemFootPrint();
+    //! Peak resident memory of the process (VmHWM) in GB
+    static double getMemPeak();
     
     //! Converts a number of Bytes in a readable string in KiB, MiB, GiB or TiB
     static std::string printBytes( uint64_t nbytes );
@@ -0,0 +1,134 @@
+#include "Tracer.h"
+
+#include <mpi.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "SmileiMPI.h"
+#include "Tools.h"
+
+using namespace std;
+
+bool Tracer::active_ = false;
+bool Tracer::enabled_ = false;
+bool Tracer::written_ = false;
+int Tracer::first_ = 0;
+int Tracer::last_ = -1;
+double Tracer::t0_ = 0.;
+vector<Tracer::Buffer> Tracer::buffers_;
+
+void Tracer::init( SmileiMPI *smpi, int first, int last, unsigned int size )
+{
+    first_ = first;
+    last_ = last;
+#ifdef _OPENMP
+    buffers_.resize( omp_get_max_threads() );
+#else
+    buffers_.resize( 1 );
+#endif
+    for( unsigned int ithread=0; ithread<buffers_.size(); ithread++ ) {
+        buffers_[ithread].events.resize( size );
+        buffers_[ithread].count = 0;
+    }
+    enabled_ = size > 0 && last >= first;
+    written_ = false;
+    active_ = false;
+    smpi->barrier();
+    t0_ = MPI_Wtime();
+}
+
+void Tracer::step( int itime, SmileiMPI *smpi )
+{
+    if( ! enabled_ ) {
+        return;
+    }
+    active_ = itime >= first_ && itime <= last_;
+    if( itime > last_ ) {
+        write( smpi );
+    }
+}
+
+void Tracer::record( const char *name, char phase, int arg )
+{
+#ifdef _OPENMP
+    Buffer &buffer = buffers_[omp_get_thread_num()];
+#else
+    Buffer &buffer = buffers_[0];
+#endif
+    Event &event = buffer.events[buffer.count % buffer.events.size()];
+    event.name = name;
+    event.time = MPI_Wtime();
+    event.arg = arg;
+    event.phase = phase;
+    buffer.count++;
+}
+
+void Tracer::write( SmileiMPI *smpi )
+{
+    if( ! enabled_ || written_ ) {
+        return;
+    }
+    written_ = true;
+    active_ = false;
+
+    // Events of this process, in JSON
+    int rank = smpi->getRank();
+    ostringstream json;
+    json << fixed << setprecision( 3 );
+    json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank << ",\"args\":{\"name\":\"MPI " << rank << "\"}}";
+    bool lost = false;
+    for( unsigned int ithread=0; ithread<buffers_.size(); ithread++ ) {
+        Buffer &buffer = buffers_[ithread];
+        uint64_t size = buffer.events.size();
+        uint64_t start = buffer.count > size ? buffer.count - size : 0;
+        lost = lost || start > 0;
+        for( uint64_t i=start; i<buffer.count; i++ ) {
+            Event &event = buffer.events[i % size];
+            json << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase
+                 << "\",\"ts\":" << ( event.time - t0_ ) * 1.e6
+                 << ",\"pid\":" << rank << ",\"tid\":" << ithread;
+            if( event.arg >= 0 ) {
+                json << ",\"args\":{\"patch\":" << event.arg << "}";
+            }
+            json << "}";
+        }
+        buffer.events.clear();
+    }
+    int lost_any = lost;
+    MPI_Allreduce( MPI_IN_PLACE, &lost_any, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD );
+    if( lost_any ) {
+        WARNING( "Trace buffers full: only the latest events are written (increase trace_events)" );
+    }
+    string local = json.str();
+
+    // Gather on the master
+    int size = local.size(), nproc = smpi->getSize();
+    vector<int> sizes( nproc ), displs( nproc, 0 );
+    MPI_Gather( &size, 1, MPI_INT, &sizes[0], 1, MPI_INT, 0, MPI_COMM_WORLD );
+    vector<char> all;
+    if( smpi->isMaster() ) {
+        for( int i=1; i<nproc; i++ ) {
+            displs[i] = displs[i-1] + sizes[i-1];
+        }
+        all.resize( displs[nproc-1] + sizes[nproc-1] );
+    }
+    MPI_Gatherv( &local[0], size, MPI_CHAR, all.data(), &sizes[0], &displs[0], MPI_CHAR, 0, MPI_COMM_WORLD );
+
+    if( smpi->isMaster() ) {
+        ofstream fout( "trace.json" );
+        fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        for( int i=0; i<nproc; i++ ) {
+            if( i > 0 ) {
+                fout << ",\n";
+            }
+            fout.write( &all[displs[i]], sizes[i] );
+        }
+        fout << "\n]}\n";
+        fout.close();
+        MESSAGE( 1, "Trace of timesteps " << first_ << " to " << last_ << " written in trace.json" );
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <vector>
+#include <cstdint>
+
+class SmileiMPI;
+
+//  --------------------------------------------------------------------------------------------------------------------
+//! Class Tracer
+//!   Timeline of the phases of the time loop, recorded per thread and per MPI process during a window
+//!   of timesteps, then written as a Chrome / Perfetto trace (trace.json).
+//!   Each thread keeps its events in a ring buffer of fixed size: only the latest events are kept.
+//!   When the tracer is off, begin() and end() only test a boolean.
+//  --------------------------------------------------------------------------------------------------------------------
+class Tracer
+{
+public:
+    //! Trace the timesteps `first` to `last`, keeping at most `size` events per thread
+    //! (must be called outside of the parallel region)
+    static void init( SmileiMPI *smpi, int first, int last, unsigned int size );
+
+    //! Start a new timestep: switch the recording on or off, and write the trace after the window
+    //! (must be called by one thread per process, while the other threads wait)
+    static void step( int itime, SmileiMPI *smpi );
+
+    //! Write the trace, if not done yet (collective)
+    static void write( SmileiMPI *smpi );
+
+    //! Record the beginning of a phase in the calling thread (`arg` is an optional patch number)
+    static inline void begin( const char *name, int arg=-1 )
+    {
+        if( active_ ) {
+            record( name, 'B', arg );
+        }
+    }
+
+    //! Record the end of a phase in the calling thread
+    static inline void end( const char *name, int arg=-1 )
+    {
+        if( active_ ) {
+            record( name, 'E', arg );
+        }
+    }
+
+private:
+    struct Event {
+        const char *name;
+        double time;
+        int arg;
+        char phase;
+    };
+
+    //! Ring buffer of one thread, padded to avoid false sharing
+    struct Buffer {
+        std::vector<Event> events;
+        uint64_t count;
+        char padding[64];
+    };
+
+    static void record( const char *name, char phase, int arg );
+
+    //! Whether events are currently recorded
+    static bool active_;
+
+    //! Whether the tracer was initialized, and the trace written
+    static bool enabled_, written_;
+
+    //! Window of timesteps
+    static int first_, last_;
+
+    //! Time origin of the trace
+    static double t0_;
+
+    static std::vector<Buffer> buffers_;
+};
+
+#endif
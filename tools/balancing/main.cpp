@@ -0,0 +1,526 @@
+// ---------------------------------------------------------------------------------------------------------------------
+//
+//! \file main.cpp
+//
+//! \brief Offline replay of the dynamic load balancing
+//
+//! The patch loads recorded by DiagPerformances (with patch_information = True) in Performances.h5 are
+//! redistributed with the same algorithm as SmileiMPI::recompute_patch_count, for other numbers of MPI ranks,
+//! patch sizes, cell_load coefficients and balancing periods. The predicted imbalance, migration volume and
+//! ghost-cell exchanges are printed for each combination.
+//
+// ---------------------------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "H5.h"
+#include "Tools.h"
+#include "Hilbert_functions.h"
+#include "LoadBalancing_functions.h"
+
+using namespace std;
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Patch quantities recorded at one iteration, indexed by the Hilbert index of the patches
+// ---------------------------------------------------------------------------------------------------------------------
+struct Snapshot {
+    unsigned int itime;
+    vector<double> particles, frozen_particles, compute_time;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Patch grid and recorded loads
+// ---------------------------------------------------------------------------------------------------------------------
+struct Recording {
+    unsigned int ndim;
+    vector<unsigned int> number_of_patches, n_space, oversize;
+    //! Coordinates of each patch, indexed by Hilbert index
+    vector<vector<unsigned int> > coordinates;
+    vector<Snapshot> snapshots;
+    double cell_load, frozen_particle_load;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Options of the replay
+// ---------------------------------------------------------------------------------------------------------------------
+struct Options {
+    string filename;
+    vector<unsigned int> ranks, every;
+    double cell_load, frozen_particle_load;
+    unsigned int merge, max_patches_moved;
+    string load_model;
+    bool initial_balance, verbose;
+};
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Hilbert index of a patch (same ordering as HilbertDomainDecomposition)
+// ---------------------------------------------------------------------------------------------------------------------
+unsigned int hilbertIndex( const vector<unsigned int> &m, const vector<unsigned int> &x )
+{
+    if( m.size() == 1 ) {
+        return generalhilbertindex( m[0], 0, x[0], 0 );
+    } else if( m.size() == 2 ) {
+        return generalhilbertindex( m[0], m[1], x[0], x[1] );
+    } else {
+        return generalhilbertindex( m[0], m[1], m[2], x[0], x[1], x[2] );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Split a comma-separated list of positive integers
+// ---------------------------------------------------------------------------------------------------------------------
+vector<unsigned int> parseList( string s )
+{
+    vector<unsigned int> list;
+    stringstream ss( s );
+    string item;
+    while( getline( ss, item, ',' ) ) {
+        int value = atoi( item.c_str() );
+        if( value <= 0 ) {
+            ERROR( "Invalid value `" << item << "` in list `" << s << "`" );
+        }
+        list.push_back( value );
+    }
+    return list;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Read the patch information of all iterations of a Performances.h5 file
+// ---------------------------------------------------------------------------------------------------------------------
+void readRecording( string filename, Recording &rec )
+{
+    if( ! Tools::file_exists( filename ) ) {
+        ERROR( "Cannot find file " << filename );
+    }
+    hid_t fid = H5Fopen( filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT );
+
+    string arrangement;
+    H5::getAttr( fid, "patch_arrangement", arrangement );
+    if( arrangement.compare( 0, 7, "hilbert" ) != 0 ) {
+        ERROR( "Load balancing requires patch_arrangement = \"hilbertian\" (found `" << arrangement << "`)" );
+    }
+    if( ! H5::hasAttr( fid, "number_of_patches" ) ) {
+        ERROR( filename << " does not contain the patch grid. It was written by an older version of Smilei" );
+    }
+    H5::getAttr( fid, "number_of_patches", rec.number_of_patches, H5T_NATIVE_UINT );
+    H5::getAttr( fid, "n_space", rec.n_space, H5T_NATIVE_UINT );
+    H5::getAttr( fid, "oversize", rec.oversize, H5T_NATIVE_UINT );
+    H5::getAttr( fid, "cell_load", rec.cell_load );
+    H5::getAttr( fid, "frozen_particle_load", rec.frozen_particle_load );
+    rec.ndim = rec.number_of_patches.size();
+
+    unsigned int npatches = 1;
+    for( unsigned int idim=0; idim<rec.ndim; idim++ ) {
+        npatches *= rec.number_of_patches[idim];
+    }
+
+    // Loop over the iteration groups (their names are the zero-padded iteration numbers, thus sorted)
+    H5G_info_t info;
+    H5Gget_info( fid, &info );
+    const char *axes[3] = {"x", "y", "z"};
+    for( hsize_t i=0; i<info.nlinks; i++ ) {
+        char name[32];
+        H5Lget_name_by_idx( fid, ".", H5_INDEX_NAME, H5_ITER_INC, i, name, 32, H5P_DEFAULT );
+        hid_t gid = H5Gopen( fid, name, H5P_DEFAULT );
+        if( H5Lexists( gid, "patches", H5P_DEFAULT ) <= 0 ) {
+            H5Gclose( gid );
+            continue;
+        }
+        hid_t pid = H5Gopen( gid, "patches", H5P_DEFAULT );
+        if( H5Lexists( pid, "number_of_particles", H5P_DEFAULT ) <= 0 ) {
+            ERROR( "Iteration " << name << " does not contain the number of particles per patch" );
+        }
+
+        Snapshot snap;
+        snap.itime = atoi( name );
+        snap.particles.resize( npatches );
+        snap.frozen_particles.resize( npatches );
+        snap.compute_time.resize( npatches );
+        vector<unsigned int> buffer( npatches );
+        H5::getVect( pid, "number_of_particles", buffer );
+        snap.particles.assign( buffer.begin(), buffer.end() );
+        H5::getVect( pid, "number_of_frozen_particles", buffer );
+        snap.frozen_particles.assign( buffer.begin(), buffer.end() );
+        H5::getVect( pid, "compute_time", snap.compute_time );
+
+        // Patch coordinates (identical at all iterations)
+        if( rec.coordinates.size() == 0 ) {
+            rec.coordinates.resize( npatches, vector<unsigned int>( rec.ndim ) );
+            for( unsigned int idim=0; idim<rec.ndim; idim++ ) {
+                H5::getVect( pid, axes[idim], buffer );
+                for( unsigned int h=0; h<npatches; h++ ) {
+                    rec.coordinates[h][idim] = buffer[h];
+                }
+            }
+        }
+
+        rec.snapshots.push_back( snap );
+        H5Gclose( pid );
+        H5Gclose( gid );
+    }
+    H5Fclose( fid );
+
+    if( rec.snapshots.size() == 0 ) {
+        ERROR( filename << " contains no patch information. Set `patch_information = True` in DiagPerformances" );
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Merge the patches by groups of `merge` patches in each direction (the new patches are reordered along the new
+//! Hilbert curve)
+// ---------------------------------------------------------------------------------------------------------------------
+void mergePatches( Recording &rec, unsigned int merge )
+{
+    if( merge == 1 ) {
+        return;
+    }
+    vector<unsigned int> m( rec.ndim ), number_of_patches( rec.ndim );
+    unsigned int npatches = 1;
+    for( unsigned int idim=0; idim<rec.ndim; idim++ ) {
+        if( rec.number_of_patches[idim] % merge != 0 ) {
+            ERROR( "Cannot merge patches by " << merge << ": only " << rec.number_of_patches[idim] << " patches along axis " << idim );
+        }
+        number_of_patches[idim] = rec.number_of_patches[idim] / merge;
+        m[idim] = round( log2( number_of_patches[idim] ) );
+        npatches *= number_of_patches[idim];
+    }
+
+    // New index of each old patch
+    vector<unsigned int> new_index( rec.coordinates.size() );
+    vector<vector<unsigned int> > coordinates( npatches, vector<unsigned int>( rec.ndim ) );
+    for( unsigned int h=0; h<rec.coordinates.size(); h++ ) {
+        vector<unsigned int> x( rec.ndim );
+        for( unsigned int idim=0; idim<rec.ndim; idim++ ) {
+            x[idim] = rec.coordinates[h][idim] / merge;
+        }
+        new_index[h] = hilbertIndex( m, x );
+        coordinates[new_index[h]] = x;
+    }
+
+    // Sum the quantities of the merged patches
+    for( unsigned int s=0; s<rec.snapshots.size(); s++ ) {
+        Snapshot &snap = rec.snapshots[s];
+        vector<double> particles( npatches, 0. ), frozen_particles( npatches, 0. ), compute_time( npatches, 0. );
+        for( unsigned int h=0; h<new_index.size(); h++ ) {
+            particles       [new_index[h]] += snap.particles       [h];
+            frozen_particles[new_index[h]] += snap.frozen_particles[h];
+            compute_time    [new_index[h]] += snap.compute_time    [h];
+        }
+        snap.particles        = particles;
+        snap.frozen_particles = frozen_particles;
+        snap.compute_time     = compute_time;
+    }
+
+    rec.coordinates = coordinates;
+    rec.number_of_patches = number_of_patches;
+    for( unsigned int idim=0; idim<rec.ndim; idim++ ) {
+        rec.n_space[idim] *= merge;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Load of each patch at one iteration, in the units of recompute_patch_count
+// ---------------------------------------------------------------------------------------------------------------------
+void computeLoads( const Recording &rec, const Snapshot &snap, const Options &opt, double cell_load, vector<double> &loads )
+{
+    unsigned int ncells_perpatch = 1;
+    for( unsigned int idim=0; idim<rec.ndim; idim++ ) {
+        ncells_perpatch *= rec.n_space[idim]+2*rec.oversize[idim];
+    }
+
+    unsigned int npatches = snap.particles.size();
+    loads.resize( npatches );
+    for( unsigned int h=0; h<npatches; h++ ) {
+        loads[h] = snap.particles[h] + snap.frozen_particles[h] * opt.frozen_particle_load;
+    }
+
+    // Measured model: compute times converted in particle loads with the ratio over all measured patches
+    if( opt.load_model == "measured" ) {
+        double measured_time = 0., measured_load = 0.;
+        for( unsigned int h=0; h<npatches; h++ ) {
+            if( snap.compute_time[h] > 0. ) {
+                measured_time += snap.compute_time[h];
+                measured_load += loads[h];
+            }
+        }
+        if( measured_time > 0. && measured_load > 0. ) {
+            for( unsigned int h=0; h<npatches; h++ ) {
+                if( snap.compute_time[h] > 0. ) {
+                    loads[h] = snap.compute_time[h] * measured_load / measured_time;
+                }
+            }
+        }
+    }
+
+    for( unsigned int h=0; h<npatches; h++ ) {
+        loads[h] += ncells_perpatch * cell_load;
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Number of ghost cells exchanged between different ranks at each synchronization (only first neighbours, no periodicity)
+// ---------------------------------------------------------------------------------------------------------------------
+double ghostCells( const Recording &rec, const vector<int> &owner )
+{
+    vector<unsigned int> m( rec.ndim );
+    for( unsigned int idim=0; idim<rec.ndim; idim++ ) {
+        m[idim] = round( log2( rec.number_of_patches[idim] ) );
+    }
+    double cells = 0.;
+    for( unsigned int h=0; h<owner.size(); h++ ) {
+        for( unsigned int idim=0; idim<rec.ndim; idim++ ) {
+            if( rec.coordinates[h][idim]+1 >= rec.number_of_patches[idim] ) {
+                continue;
+            }
+            vector<unsigned int> x( rec.coordinates[h] );
+            x[idim]++;
+            if( owner[hilbertIndex( m, x )] != owner[h] ) {
+                double face = 2. * rec.oversize[idim];
+                for( unsigned int jdim=0; jdim<rec.ndim; jdim++ ) {
+                    if( jdim != idim ) {
+                        face *= rec.n_space[jdim];
+                    }
+                }
+                cells += face;
+            }
+        }
+    }
+    return cells;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Owner rank of each patch
+// ---------------------------------------------------------------------------------------------------------------------
+void owners( const vector<int> &patch_count, vector<int> &owner )
+{
+    unsigned int h = 0;
+    for( unsigned int rk=0; rk<patch_count.size(); rk++ ) {
+        for( int i=0; i<patch_count[rk]; i++ ) {
+            owner[h++] = rk;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+//! Replay the balancing for one number of ranks and one balancing period
+// ---------------------------------------------------------------------------------------------------------------------
+void replay( const Recording &rec, const Options &opt, unsigned int nranks, unsigned int every )
+{
+    unsigned int npatches = rec.coordinates.size();
+    if( npatches < 2*nranks ) {
+        MESSAGE( setw( 7 ) << nranks << setw( 8 ) << every << "   skipped: less than 2 patches per rank" );
+        return;
+    }
+    double cell_load = opt.cell_load;
+    vector<double> loads;
+    vector<int> owner( npatches );
+
+    // Initial distribution: patches evenly distributed, then balanced
+    vector<int> patch_count( nranks, npatches / nranks );
+    for( unsigned int rk=0; rk < npatches % nranks; rk++ ) {
+        patch_count[rk]++;
+    }
+    computeLoads( rec, rec.snapshots[0], opt, cell_load, loads );
+    for( unsigned int i=0; opt.initial_balance && i<nranks; i++ ) {
+        vector<int> previous( patch_count );
+        balancePatchCount( loads, patch_count, 0 );
+        if( patch_count == previous ) {
+            break;
+        }
+    }
+
+    double imbalance_sum = 0., imbalance_max = 0., ghost_sum = 0., moved_particles = 0., slowest_time_sum = 0.;
+    unsigned int moved_patches = 0, last_balancing = rec.snapshots[0].itime;
+    for( unsigned int s=0; s<rec.snapshots.size(); s++ ) {
+        const Snapshot &snap = rec.snapshots[s];
+        computeLoads( rec, snap, opt, cell_load, loads );
+
+        // Balance if the period has elapsed since the last balancing
+        if( s > 0 && snap.itime >= last_balancing + every ) {
+            last_balancing = snap.itime;
+            // Same protection as recompute_patch_count against patches heavier than the target load
+            while( true ) {
+                double Tload = 0., largest_patch = 0.;
+                for( unsigned int h=0; h<npatches; h++ ) {
+                    Tload += loads[h];
+                    largest_patch = max( largest_patch, loads[h] );
+                }
+                if( largest_patch < Tload / nranks ) {
+                    break;
+                }
+                cell_load *= 2.;
+                computeLoads( rec, snap, opt, cell_load, loads );
+                if( opt.verbose ) {
+                    MESSAGE( 2, "t = " << setw( 10 ) << snap.itime << "  cell load increased to " << cell_load );
+                }
+            }
+            // Migrations limited by max_patches_moved continue at the next iterations, counted together here
+            vector<int> previous( patch_count );
+            bool incomplete = true;
+            for( unsigned int i=0; incomplete && i<npatches; i++ ) {
+                incomplete = balancePatchCount( loads, patch_count, opt.max_patches_moved );
+            }
+            unsigned int first_old = 0, first_new = 0;
+            for( unsigned int rk=1; rk<nranks; rk++ ) {
+                first_old += previous[rk-1];
+                first_new += patch_count[rk-1];
+                unsigned int hmin = min( first_old, first_new ), hmax = max( first_old, first_new );
+                moved_patches += hmax - hmin;
+                for( unsigned int h=hmin; h<hmax; h++ ) {
+                    moved_particles += snap.particles[h] + snap.frozen_particles[h];
+                }
+            }
+        }
+
+        // Load and compute time of each rank
+        owners( patch_count, owner );
+        vector<double> rank_load( nranks, 0. ), rank_time( nranks, 0. );
+        double Tload = 0.;
+        for( unsigned int h=0; h<npatches; h++ ) {
+            rank_load[owner[h]] += loads[h];
+            rank_time[owner[h]] += snap.compute_time[h];
+            Tload += loads[h];
+        }
+        double imbalance = *max_element( rank_load.begin(), rank_load.end() ) / ( Tload / nranks );
+        double slowest_time = *max_element( rank_time.begin(), rank_time.end() );
+        double ghost = ghostCells( rec, owner );
+        imbalance_sum += imbalance;
+        imbalance_max = max( imbalance_max, imbalance );
+        ghost_sum += ghost;
+        slowest_time_sum += slowest_time;
+
+        if( opt.verbose ) {
+            MESSAGE( 2, "t = " << setw( 10 ) << snap.itime
+                     << "  imbalance = " << setprecision( 3 ) << imbalance
+                     << "  slowest rank particle time = " << setprecision( 6 ) << slowest_time << " s"
+                     << "  ghost cells = " << ( uint64_t ) ghost );
+        }
+    }
+
+    unsigned int n = rec.snapshots.size();
+    MESSAGE( setw( 7 ) << nranks << setw( 8 ) << every
+             << setw( 13 ) << setprecision( 3 ) << imbalance_sum / n
+             << setw( 13 ) << setprecision( 3 ) << imbalance_max
+             << setw( 13 ) << setprecision( 6 ) << slowest_time_sum / n
+             << setw( 13 ) << moved_patches
+             << setw( 16 ) << ( uint64_t ) moved_particles
+             << setw( 16 ) << ( uint64_t )( ghost_sum / n ) );
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+//                                                   MAIN CODE
+// ---------------------------------------------------------------------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+    MPI_Init( &argc, &argv );
+    cout.setf( ios::fixed,  ios::floatfield );
+
+    Options opt;
+    opt.filename = "Performances.h5";
+    opt.cell_load = -1.;
+    opt.frozen_particle_load = -1.;
+    opt.merge = 1;
+    opt.max_patches_moved = 0;
+    opt.load_model = "particles";
+    opt.initial_balance = true;
+    opt.verbose = false;
+
+    for( int i=1; i<argc; i++ ) {
+        string arg( argv[i] );
+        if( arg == "-h" || arg == "--help" ) {
+            MESSAGE( "Usage: smilei_balancing [options] [Performances.h5]" );
+            MESSAGE( 1, "-r N1,N2,...       numbers of MPI ranks (default: the MPI size of the recorded run)" );
+            MESSAGE( 1, "-e E1,E2,...       balancing periods in iterations (default: every recorded iteration)" );
+            MESSAGE( 1, "-c CELL_LOAD       cell load coefficient (default: from the file)" );
+            MESSAGE( 1, "-f FROZEN_LOAD     frozen particle load coefficient (default: from the file)" );
+            MESSAGE( 1, "-p MERGE           merge patches by groups of MERGE in each direction (power of 2)" );
+            MESSAGE( 1, "-m MODEL           load model: particles or measured (default: particles)" );
+            MESSAGE( 1, "-n MAX_MOVED       maximum number of patches moved across each boundary (default: 0, no limit)" );
+            MESSAGE( 1, "-u                 start from an uniform distribution instead of a balanced one" );
+            MESSAGE( 1, "-v                 print the prediction at each recorded iteration" );
+            MPI_Finalize();
+            return 0;
+        } else if( arg == "-u" ) {
+            opt.initial_balance = false;
+        } else if( arg == "-v" ) {
+            opt.verbose = true;
+        } else if( arg[0] == '-' ) {
+            if( i+1 >= argc ) {
+                ERROR( "Missing value after option " << arg );
+            }
+            string value( argv[++i] );
+            if( arg == "-r" ) {
+                opt.ranks = parseList( value );
+            } else if( arg == "-e" ) {
+                opt.every = parseList( value );
+            } else if( arg == "-c" ) {
+                opt.cell_load = atof( value.c_str() );
+            } else if( arg == "-f" ) {
+                opt.frozen_particle_load = atof( value.c_str() );
+            } else if( arg == "-p" ) {
+                opt.merge = atoi( value.c_str() );
+                if( opt.merge == 0 || ( opt.merge & ( opt.merge-1 ) ) != 0 ) {
+                    ERROR( "Option -p must be a power of 2" );
+                }
+            } else if( arg == "-m" ) {
+                opt.load_model = value;
+                if( opt.load_model != "particles" && opt.load_model != "measured" ) {
+                    ERROR( "Option -m must be `particles` or `measured`" );
+                }
+            } else if( arg == "-n" ) {
+                opt.max_patches_moved = atoi( value.c_str() );
+            } else {
+                ERROR( "Unknown option " << arg );
+            }
+        } else {
+            opt.filename = arg;
+        }
+    }
+
+    Recording rec;
+    readRecording( opt.filename, rec );
+    mergePatches( rec, opt.merge );
+
+    if( opt.cell_load < 0. ) {
+        opt.cell_load = rec.cell_load;
+    }
+    if( opt.frozen_particle_load < 0. ) {
+        opt.frozen_particle_load = rec.frozen_particle_load;
+    }
+    if( opt.ranks.size() == 0 ) {
+        hid_t fid = H5Fopen( opt.filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT );
+        unsigned int mpi_size = 1;
+        H5::getAttr( fid, "MPI_SIZE", mpi_size );
+        H5Fclose( fid );
+        opt.ranks.push_back( mpi_size );
+    }
+    if( opt.every.size() == 0 ) {
+        opt.every.push_back( 1 );
+    }
+
+    TITLE( "Load balancing replay of " << opt.filename );
+    MESSAGE( 1, rec.snapshots.size() << " recorded iterations, " << rec.coordinates.size() << " patches of " << rec.n_space[0]
+             << ( rec.ndim>1 ? "x" + to_string( rec.n_space[1] ) : "" ) << ( rec.ndim>2 ? "x" + to_string( rec.n_space[2] ) : "" ) << " cells" );
+    MESSAGE( 1, "Load model: " << opt.load_model << ", cell_load = " << opt.cell_load << ", frozen_particle_load = " << opt.frozen_particle_load );
+    if( opt.max_patches_moved > 0 ) {
+        MESSAGE( 1, "At most " << opt.max_patches_moved << " patches moved across each boundary per iteration" );
+    }
+    MESSAGE( "" );
+    MESSAGE( "  ranks   every  mean_imbal.   max_imbal.  slowest_time  moved_patches  moved_particles  ghost_cells" );
+    for( unsigned int ir=0; ir<opt.ranks.size(); ir++ ) {
+        for( unsigned int ie=0; ie<opt.every.size(); ie++ ) {
+            replay( rec, opt, opt.ranks[ir], opt.every[ie] );
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}
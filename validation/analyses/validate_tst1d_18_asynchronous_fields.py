@@ -0,0 +1,23 @@
+import os, re, numpy as np
+import happi
+
+S = happi.Open(["./restart*"], verbose=False)
+
+# Each asynchronous diagnostic must match the same diagnostic written synchronously
+for async_diag, sync_diag in [(0, 2), (1, 3)]:
+	timesteps = list(S.Field(async_diag).getAvailableTimesteps())
+	Validate("Field%d has the timesteps of Field%d"%(async_diag, sync_diag), timesteps == list(S.Field(sync_diag).getAvailableTimesteps()) )
+	
+	identical = True
+	for field in S.Field(async_diag).getFields():
+		for t in timesteps:
+			a = S.Field(async_diag, field, timesteps=t).getData()[0]
+			b = S.Field(sync_diag , field, timesteps=t).getData()[0]
+			identical = identical and np.array_equal(a, b)
+	Validate("Field%d is identical to Field%d"%(async_diag, sync_diag), identical )
+
+# The time-averaged outputs are written at the end of each averaging window
+average = S.namelist.DiagFields[1].time_average
+every = S.namelist.DiagFields[1].every
+timesteps = S.Field(1).getAvailableTimesteps()
+Validate("Field1 is written at the end of each averaging window", len(timesteps)>0 and all( t % every == average-1 for t in timesteps ) )
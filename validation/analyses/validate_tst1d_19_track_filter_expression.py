@@ -0,0 +1,22 @@
+import os, re, numpy as np
+import happi
+
+S = happi.Open(["./restart*"], verbose=False)
+
+# The compiled filter and the python filter select the same particles at each output
+compiled = S.TrackParticles("eon_compiled", axes=["x","px"]).getData()
+python   = S.TrackParticles("eon_python"  , axes=["x","px"]).getData()
+
+Validate("Same output timesteps", list(compiled["times"]) == list(python["times"]) )
+
+identical = True
+for axis in ["x", "px"]:
+	for a, b in zip(compiled[axis], python[axis]):
+		a = np.sort(a[~np.isnan(a)])
+		b = np.sort(b[~np.isnan(b)])
+		identical = identical and np.array_equal(a, b)
+Validate("Same tracked particles", identical )
+
+# Particles were selected, but not all of them
+n_compiled = np.count_nonzero(~np.isnan(compiled["x"][-1]))
+Validate("The filter selects part of the particles", 0 < n_compiled < S.namelist.Main.grid_length[0]/S.namelist.Main.cell_length[0]*4 )
@@ -0,0 +1,29 @@
+import os, re, numpy as np
+import happi
+
+S = happi.Open(["./restart*"], verbose=False)
+
+# The three densities are the same
+rho_numpy = S.Field(0, "Rho_eon_numpy", timesteps=0).getData()[0]
+for name in ["eon_expression", "eon_shim"]:
+	rho = S.Field(0, "Rho_"+name, timesteps=0).getData()[0]
+	Validate("Density of "+name, np.allclose(rho, rho_numpy, rtol=1e-12, atol=0.) )
+Validate("The density is not uniform", rho_numpy.min() != rho_numpy.max() )
+
+# The current of the compiled antenna (around x=2.5) is that of the python antenna (around x=17.5)
+dx = S.namelist.Main.cell_length[0]
+shift = int(round(15./dx))
+left = slice(int(round(1./dx)), int(round(4./dx)))
+right = slice(left.start+shift, left.stop+shift)
+identical = True
+amplitude = 0.
+for t in S.Field(0, "Jz").getAvailableTimesteps():
+	Jz = S.Field(0, "Jz", timesteps=t).getData()[0]
+	identical = identical and np.allclose(Jz[left], Jz[right], rtol=1e-10, atol=1e-14)
+	amplitude = max(amplitude, np.abs(Jz[left]).max())
+Validate("Same antenna current", identical )
+Validate("The antenna current is not zero", amplitude > 0. )
+
+# The python equivalent of the time expression matches the python function
+t = np.linspace(0., S.namelist.Main.simulation_time, 301)
+Validate("Python equivalent of texpression", all( abs(S.namelist.time_expression(ti) - S.namelist.time_python(ti)) < 1e-14 for ti in t ) )
@@ -0,0 +1,37 @@
+import os, re, glob, time, pickle, numpy as np
+import happi
+
+S = happi.Open(["./restart*"], verbose=False)
+
+# Each process wrote the records read from its segment (the readers may finish after the simulation)
+expected = len(glob.glob("./restart*"+os.sep)) * S.namelist.smilei_mpi_size
+for i in range(600):
+	if len(glob.glob("./restart*/shared_memory_*.pickle")) >= expected:
+		break
+	time.sleep(0.1)
+results = [pickle.load(open(f, "rb")) for f in sorted(glob.glob("./restart*/shared_memory_*.pickle"))]
+Validate("One reader per process", len(results) == expected )
+Validate("Valid headers", all( r["header"] is not None and r["header"]["version"] == 1 and r["header"]["policy"] == "block" for r in results ) )
+Validate("No errors in the segments", all( len(r["errors"]) == 0 for r in results ) )
+Validate("No dropped records", all( r["dropped"] == 0 for r in results ) )
+Validate("Sequence numbers 2n+2", all( [rec["sequence"] for rec in r["records"]] == [2*n+2 for n in range(len(r["records"]))] for r in results ) )
+
+# Gather the arrays of all processes
+gathered = {}
+for r in results:
+	for rec in r["records"]:
+		key = (rec["timestep"], rec["name"])
+		if key not in gathered:
+			gathered[key] = np.zeros(rec["global_shape"])
+		data = np.frombuffer(rec["data"], dtype=rec["type"]).reshape(rec["shape"])
+		gathered[key][rec["offset"][0]:rec["offset"][0]+rec["shape"][0]] = data
+
+# They are identical to the HDF5 output
+timesteps = list(S.Field(1).getAvailableTimesteps())
+fields = S.Field(1).getFields()
+Validate("Same outputs", sorted(gathered.keys()) == sorted([(t, f) for t in timesteps for f in fields]) )
+identical = True
+for t in timesteps:
+	for field in fields:
+		identical = identical and np.array_equal( gathered[(t, field)], S.Field(1, field, timesteps=t).getData()[0] )
+Validate("Same data as the HDF5 output", identical )
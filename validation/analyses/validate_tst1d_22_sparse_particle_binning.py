@@ -0,0 +1,25 @@
+import os, re, numpy as np
+import happi
+
+S = happi.Open(["./restart*"], verbose=False)
+
+# The sparse diagnostics, in both output formats, match the usual diagnostic
+timesteps = list(S.ParticleBinning(0).getAvailableTimesteps())
+Validate("Timesteps available", len(timesteps) > 1 )
+for diag, name in [(1, "sparse"), (2, "dense")]:
+	Validate("Same timesteps with sparse_output="+name, list(S.ParticleBinning(diag).getAvailableTimesteps()) == timesteps )
+	for label, kwargs in [
+		("full array"    , {}),
+		("sum over x"    , {"sum":{"x":"all"}}),
+		("subset of px"  , {"subset":{"px":[-0.2, 0.2]}}),
+	]:
+		identical = True
+		for t in timesteps:
+			a = np.array(S.ParticleBinning(0   , timesteps=t, **kwargs).getData()[0])
+			b = np.array(S.ParticleBinning(diag, timesteps=t, **kwargs).getData()[0])
+			identical = identical and a.shape == b.shape and np.allclose(a, b, rtol=1e-12, atol=0.)
+		Validate("Same "+label+" with sparse_output="+name, identical )
+
+# Most bins are empty
+data = np.array(S.ParticleBinning(0, timesteps=timesteps[-1]).getData()[0])
+Validate("Mostly empty bins", 0 < np.count_nonzero(data) < data.size/2 )
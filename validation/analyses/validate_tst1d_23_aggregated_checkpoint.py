@@ -0,0 +1,34 @@
+import os, re, glob, numpy as np
+import happi
+
+S = happi.Open(["./restart*"], verbose=False)
+
+# Each restart read the aggregated files of the previous run
+restarts = sorted(glob.glob("./restart*"))
+aggregated = True
+for previous in restarts[:-1]:
+	dumps = glob.glob(previous+"/checkpoints/dump-*")
+	aggregated = aggregated and len(dumps) > 0 and all("-aggregated-" in d for d in dumps)
+Validate("Restarts from aggregated checkpoints", aggregated )
+
+# The laser moves by one cell per timestep, across the restarts
+timesteps = list(S.Field(0, "Ey").getAvailableTimesteps())
+Validate("Field timesteps", timesteps == list(range(0, 385, 32)) )
+Ey = [np.array(S.Field(0, "Ey", timesteps=t).getData()[0]) for t in timesteps]
+amplitude = np.abs(Ey[-1]).max()
+Validate("The laser is in the box", amplitude > 0.05 )
+translated = True
+for i in range(1, len(timesteps)):
+	shift = timesteps[i] - timesteps[i-1]
+	translated = translated and np.allclose(Ey[i][shift:], Ey[i-1][:-shift], rtol=0., atol=1e-6*amplitude)
+Validate("Same fields as an uninterrupted run", translated )
+
+# The same particles are tracked at every output, and they moved ballistically
+track = S.TrackParticles("neutral", axes=["Id", "x"]).getData()
+Validate("Track timesteps", list(track["times"]) == timesteps )
+Id = np.array(track["Id"])
+x  = np.array(track["x"])
+Validate("Particles are tracked", Id.shape[1] > 0 )
+Validate("Same track IDs as an uninterrupted run", bool((Id > 0).all() and (Id == Id[0]).all() and len(np.unique(Id[0])) == Id.shape[1]) )
+t = np.array(timesteps) * S.namelist.Main.timestep
+Validate("Same positions as an uninterrupted run", np.allclose(x - x[0], 0.1*t[:,None], rtol=0., atol=1e-8) )